@@ -72,6 +72,15 @@ function delete_dependencies_from() {
 delete_controllers_from $cmake_file
 delete_dependencies_from $cmake_file
 
+# robot of conversion tables, see make_conversion_tables.py
+if [[ $(grep ">>> add robot" $cmake_file) != "" ]]
+then
+    delete_section_from "robot" $cmake_file
+    write_to_line=$(grep -n -m 1 ">>> add robot" $cmake_file | cut -d ':' -f1)
+    write_to_line=$(($write_to_line + 1))
+    echof "set(AERO_ROBOT_DIR $(rospack find aero_description)/${robot})" ${write_to_line} $cmake_file
+fi
+
 
 ## GENERATE
 
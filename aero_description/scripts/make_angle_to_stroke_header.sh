@@ -42,140 +42,149 @@ replace_meta_in_output_file() {
     done < /tmp/aero_ros_order_lower
 }
 
-create_table_func_from_csv() {
-    joint_name=$1
-    offset=$2
-    output_file=$3
-    function_name=$4
-    template_file=$5
-    parts_dir=$6
-
-    # parse joint_name
-    file="${parts_dir}/csv/${joint_name}.csv"
-
-    # load csv
-    code=''
-    previdx=''
-    code_offset=0
-    while read line
-    do
-        idx=$(echo "$line" | cut -d ',' -f1)
-        if [[ $previdx != '' ]]
-        then
-            if [[ $(($idx - $previdx)) -gt 1 ]]
-            then
-                expidx=$(($previdx + 1))
-                echo "   detected idx jump in ${function_name} expecting ${expidx}, got ${idx}"
-            fi
-        else
-            code_offset=$idx
-        fi
-        previdx=$idx
-	e=$(echo "$line" | cut -d ',' -f4)
-        val=$(echo "$offset + $e" | bc)
-	interval=$(echo "$line" | cut -d ',' -f3)
-        code="${code}{${val}, ${interval}},"
-    done < $file
-    code=${code::-1}
+create_table_func() {
+    output_file=$1
+    function_name=$2
+    template_file=$3
 
     awk "/float TableTemplate/,/};/" $template_file > /tmp/mjointsstrokehh
+    echo " " >> /tmp/mjointsstrokehh
+    awk "/ConversionJet TableTemplate/,/};/" $template_file >> /tmp/mjointsstrokehh
     sed -i "s/TableTemplate/${function_name}/g" /tmp/mjointsstrokehh
 
     write_to_line=$(grep -n -m 1 "void Angle2Stroke" $output_file | cut -d ':' -f1)
     write_to_line=$(($write_to_line - 1))
     write_to_top_line=$write_to_line
 
-    IFS=''
-    while read line
-    do
-	echo "${line}" | xargs -0 -I{} sed -i "${write_to_line}i\{}" $output_file
-	write_to_line=$(($write_to_line + 1))
-    done < /tmp/mjointsstrokehh
-
-    write_declare_map=$(grep -n -m 1 "};" $output_file | cut -d ':' -f1)
-    write_declare_map=$(($write_declare_map + 1))
-    sed -i "${write_declare_map}i\    static const int Array${function_name}Offset = ${code_offset};" $output_file
-    sed -i "${write_declare_map}i\    static const std::vector<std::pair<float, float>> ${function_name}Map = {${code}};" $output_file
+    # tables are in ConversionTables.hh, see make_conversion_tables.py
+    sed -i "$(($write_to_line - 1))r /tmp/mjointsstrokehh" $output_file
 
     sed -i "${write_to_top_line}i\    //////////////////////////////////////////////////" $output_file
     sed -i "${write_to_top_line}i\ " $output_file
 }
 
-create_rp_table_func_from_csv() {
-    joint_name_a=$1
-    joint_name_b=$2
-    output_file=$3
-    function_name=$4
-    offset_p=$5
-    offset_r=$6
-    template_file=$7
-    parts_dir=$8
-
-    # parse joint_name_a
-    file="${parts_dir}/csv/${joint_name_a}.csv"
-
-    # load roll csv
-    code1=''
-    code1_offset=0
-    while read line
-    do
-	e=$(echo "$line" | cut -d ',' -f4)
-	e=$(echo "$offset_r + $e" | bc)
-	interval=$(echo "$line" | cut -d ',' -f3)
-        code1="${code1}{${e},${interval}}, "
-    done < $file
-    code1_offset=$(head -n 1 $file | cut -d ',' -f1)
-    code1="${code1}"
-    code1=${code1::-2}
-
-    # parse joint_name_b
-    file="${parts_dir}/csv/${joint_name_b}.csv"
-
-    # load pitch csv
-    code2=''
-    code2_offset=0
-    while read line
-    do
-	e=$(echo "$line" | cut -d ',' -f4)
-	e=$(echo "$offset_p + $e" | bc)
-	interval=$(echo "$line" | cut -d ',' -f3)
-        code2="${code2}{${e},${interval}}, "
-    done < $file
-    code2_offset=$(head -n 1 $file | cut -d ',' -f1)
-    code2="${code2}"
-    code2=${code2::-2}
+create_rp_table_func() {
+    output_file=$1
+    function_name=$2
+    template_file=$3
 
     awk "/dualJoint TableTemplate/,/};/" $template_file > /tmp/mjointsstrokehh
+    echo " " >> /tmp/mjointsstrokehh
+    awk "/dualJointJet TableTemplate/,/};/" $template_file >> /tmp/mjointsstrokehh
     sed -i "s/TableTemplate/${function_name}/g" /tmp/mjointsstrokehh
 
     write_to_line=$(grep -n -m 1 "void Angle2Stroke" $output_file | cut -d ':' -f1)
     write_to_line=$(($write_to_line - 1))
     write_to_top_line=$write_to_line
 
-    IFS=''
-    while read line
-    do
-	echo "${line}" | xargs -0 -I{} sed -i "${write_to_line}i\{}" $output_file
-	write_to_line=$(($write_to_line + 1))
-    done < /tmp/mjointsstrokehh
-
-    write_declare_map=$(grep -n -m 1 "};" $output_file | cut -d ':' -f1)
-    write_declare_map=$(($write_declare_map + 1))
-    sed -i "${write_declare_map}i\    static const int Array${function_name}Offset1 = ${code1_offset};" $output_file
-    sed -i "${write_declare_map}i\    static const int Array${function_name}Offset2 = ${code2_offset};" $output_file
-    sed -i "${write_declare_map}i\    static const std::vector<std::pair<float, float>> ${function_name}Map1 = {${code1}};" $output_file
-    sed -i "${write_declare_map}i\    static const std::vector<std::pair<float, float>> ${function_name}Map2 = {${code2}};" $output_file
+    # tables are in ConversionTables.hh, see make_conversion_tables.py
+    sed -i "$(($write_to_line - 1))r /tmp/mjointsstrokehh" $output_file
 
     sed -i "${write_to_top_line}i\    //////////////////////////////////////////////////" $output_file
     sed -i "${write_to_top_line}i\ " $output_file
 }
 
+## @brief Angle2Stroke of all points of a trajectory (TrajectoryBlock),
+##   each statement of Angle2Stroke in its own loop over points,
+##   so one table is looked up in each loop,
+##   buffers of coupled joints are kept between calls
+create_block_func() {
+    output_file=$1
+
+    awk "/void Angle2Stroke$/,/};/" $output_file > /tmp/mjointsstrokeblock
+    strokes=$(grep -o "_strokes\[" /tmp/mjointsstrokeblock | wc -l)
+    dual_joints=$(grep -o "dualJoint [a-z_]* =" /tmp/mjointsstrokeblock | cut -d ' ' -f2)
+
+    awk '
+NR <= 3 || /^    };/ { print; next }
+{
+  statement = statement $0 "\n"
+  if (index($0, ";") == 0) {
+    if (open == 0 && ($0 ~ /^ *$/ || $0 ~ /^ *\/\//)) {
+      printf "%s", statement
+      statement = ""
+    } else {
+      open = 1
+    }
+    next
+  }
+  if (statement ~ /_angles\[|_strokes\[|dualJoint/) {
+    if (statement ~ /^ *dualJoint /) {
+      name = statement
+      sub(/^ *dualJoint /, "", name)
+      sub(/ .*/, "", name)
+      if (scratch++ == 0)
+        print "      // kept between calls, allocated only when n grows"
+      print "      static thread_local std::vector<dualJoint> " name ";"
+      print "      " name ".resize(n);"
+      sub(/dualJoint [a-z_]* =/, name "[p] =", statement)
+    }
+    gsub(/\n/, "\n  ", statement)
+    sub(/  $/, "", statement)
+    print "      for (size_t p = 0; p < n; ++p)"
+    printf "  %s", statement
+  } else {
+    printf "%s", statement
+  }
+  statement = ""
+  open = 0
+}' /tmp/mjointsstrokeblock > /tmp/mjointsstrokeblock_loops
+    mv /tmp/mjointsstrokeblock_loops /tmp/mjointsstrokeblock
+
+    # angles and strokes are joint major
+    sed -i "s/(std::vector<int16_t>& _strokes, const std::vector<double>& _angles)/(TrajectoryBlock<int16_t>\& _strokes, const TrajectoryBlock<double>\& _angles)/" /tmp/mjointsstrokeblock
+    sed -i "s/_angles\[\([0-9]*\)\]/angles[\1 * n + p]/g" /tmp/mjointsstrokeblock
+    sed -i "s/_strokes\[\([0-9]*\)\]/strokes[\1 * n + p]/g" /tmp/mjointsstrokeblock
+    for name in $dual_joints
+    do
+        sed -i "s/\b${name}\.\(one\|two\)/${name}[p].\1/g" /tmp/mjointsstrokeblock
+    done
+    sed -i "3 a\      size_t n = _angles.points;\n      _strokes.resize(${strokes}, n);\n      const double* angles = _angles.data.data();\n      int16_t* strokes = _strokes.data.data();" /tmp/mjointsstrokeblock
+    sed -i '1 i\ \n    //////////////////////////////////////////////////' /tmp/mjointsstrokeblock
+
+    write_to_line=$(grep -n -m 1 "void Angle2Stroke" $output_file | cut -d ':' -f1)
+    end_line=$(tail -n +$write_to_line $output_file | grep -n -m 1 "};" | cut -d ':' -f1)
+    sed -i "$(($write_to_line + $end_line - 1))r /tmp/mjointsstrokeblock" $output_file
+}
+
+## @brief stroke velocities of joint velocities, Angle2Stroke with
+##   ConversionJet instead of float, see make_stroke_to_angle_header.sh
+create_velocity_func() {
+    output_file=$1
+
+    awk "/void Angle2Stroke$/,/};/" $output_file > /tmp/mjointsstrokevel
+    awk '
+/_strokes\[[0-9]*\] =/ {
+  sub(/_strokes\[/, "_stroke_velocities[")
+  sub(/ = */, " = JetRate(")
+  open = 1
+}
+open && /;$/ {
+  sub(/;$/, ");")
+  open = 0
+}
+{ print }' /tmp/mjointsstrokevel > /tmp/mjointsstrokevel_rates
+    mv /tmp/mjointsstrokevel_rates /tmp/mjointsstrokevel
+
+    sed -i "s/void Angle2Stroke/void Angle2StrokeVelocity/" /tmp/mjointsstrokevel
+    sed -i "s/(std::vector<int16_t>& _strokes, const std::vector<double>& _angles)/(std::vector<double>\& _stroke_velocities, const std::vector<double>\& _angles,\n     const std::vector<double>\& _velocities)/" /tmp/mjointsstrokevel
+    sed -i "s/\bfloat /ConversionJet /g" /tmp/mjointsstrokevel
+    sed -i "s/\bdualJoint /dualJointJet /g" /tmp/mjointsstrokevel
+    sed -i "s/_angles\[\([0-9]*\)\]/ConversionJet(_angles[\1], _velocities[\1])/g" /tmp/mjointsstrokevel
+    sed -i '1 i\ \n    //////////////////////////////////////////////////' /tmp/mjointsstrokevel
+
+    write_to_line=$(grep -n -m 1 "void Angle2Stroke$" $output_file | cut -d ':' -f1)
+    end_line=$(tail -n +$write_to_line $output_file | grep -n -m 1 "};" | cut -d ':' -f1)
+    sed -i "$(($write_to_line + $end_line - 1))r /tmp/mjointsstrokevel" $output_file
+}
+
 cp $input_file $output_file
 replace_meta_in_output_file $output_file
+create_velocity_func $output_file
+create_block_func $output_file
 
-read_csv_config() { 
+read_csv_config() {
     csv_file=$1
-    parts_dir=$2
     total_tables=$(wc -l $csv_file | awk '{print $1}')
     for (( table_number=1; table_number<=${total_tables}; table_number++ ))
     do
@@ -184,15 +193,9 @@ read_csv_config() {
         func=$(echo "${line}" | awk '{print $1}')
         if [[ $table_type == '' ]]
         then
-	    csv=$(echo "${line}" | awk '{print $3}')
-	    offset=$(echo "${line}" | awk '{print $5}')
-	    create_table_func_from_csv $csv $offset $output_file $func $template_file $parts_dir
+	    create_table_func $output_file $func $template_file
         else
-	    csv1=$(echo "${line}" | awk '{print $3}')
-	    csv2=$(echo "${line}" | awk '{print $4}')
-	    offset_p=$(echo "${line}" | awk '{print $6}')
-	    offset_r=$(echo "${line}" | awk '{print $8}')
-	    create_rp_table_func_from_csv $csv1 $csv2 $output_file $func $offset_p $offset_r $template_file $parts_dir
+	    create_rp_table_func $output_file $func $template_file
         fi
     done
 }
@@ -227,7 +230,7 @@ do
     fi
 
     csv_file="${parts_dir}/csv/Angle2Stroke.cfg"
-    read_csv_config $csv_file $parts_dir
+    read_csv_config $csv_file
 done < $robot_file
 
 # write warnings
@@ -246,12 +249,14 @@ sed -i "/#ifndef/d" $output_source
 sed -i "/#define/d" $output_source
 sed -i "/#endif/d" $output_source
 sed -i "s/};/}/g" $output_source
-sed -i "/static const int Array/ d" $output_source
-sed -i "/static const std::vector<std::pair<float, float>>/ d" $output_source
+sed -i "/#include \"aero_hardware_interface\/Angle2Stroke.hh\"/a #include \"aero_hardware_interface\/ConversionTables.hh\"" $output_source
 
 edit_start=$(grep -n -m 1 "//////" $output_file | cut -d ':' -f1)
 tail -n +$edit_start $output_file > /tmp/aero_modify_header
 sed -i "/{/,/};/ d" /tmp/aero_modify_header
+# table functions are local to source, inlined into Angle2Stroke
+sed -i "/static inline/ d" /tmp/aero_modify_header
+sed -i "/^ $/ d" /tmp/aero_modify_header
 sed -i "s/)/);/g" /tmp/aero_modify_header
 head -n $edit_start $output_file > /tmp/aero_modify_header_head
 cat /tmp/aero_modify_header_head > $output_file
@@ -0,0 +1,339 @@
+#!/usr/bin/env python
+
+# prerequisites : {my_robot}/robot.cfg
+# prerequisites : {parts}/csv/Angle2Stroke.cfg
+# prerequisites : {parts}/csv/Stroke2Angle.cfg
+
+# generates : ConversionTables.hh (path given by --output)
+
+# Angle2Stroke and Stroke2Angle tables of all parts as constexpr arrays,
+# with monotone cubic splines of the same csv files for derivatives.
+# Called by the build (aero_startup/CMakeLists.txt), so tables follow
+# csv files without running setup.sh again.
+#
+#   make_conversion_tables.py {robot_dir} --output {file}
+#   make_conversion_tables.py {robot_dir} --depends
+#
+# --pairs adds ConversionPairs, tables of each csv for tests
+# (aero_startup/test/test_conversion_tables.cc).
+
+import argparse
+import math
+import os
+import subprocess
+import sys
+from decimal import Decimal
+
+script_dir = os.path.dirname(os.path.abspath(__file__))
+aero_description = os.path.dirname(script_dir)
+
+
+def find_package(name):
+    return subprocess.check_output(['rospack', 'find', name]).decode().strip()
+
+
+def parts_dirs(robot_dir):
+    """directories of parts in robot.cfg which have csv files"""
+    dirs = []
+    with open(os.path.join(robot_dir, 'robot.cfg')) as f:
+        for line in f:
+            words = line.split()
+            if not words or words[0] in ('#', ':'):
+                continue
+            # shop_dir: aero_shop or your pkg path
+            path = words[0].split('/')
+            if path[0] == 'aero_shop':  # use relative path
+                shop_dir = os.path.join(aero_description, '..', 'aero_shop')
+            else:
+                shop_dir = find_package(path[0])
+            parts_dir = os.path.normpath(os.path.join(shop_dir, *path[1:]))
+            if os.path.isdir(os.path.join(parts_dir, 'csv')):
+                dirs.append(parts_dir)
+    return dirs
+
+
+def read_config(parts_dir, name):
+    """lines of csv/{name}, split into words"""
+    path = os.path.join(parts_dir, 'csv', name)
+    if not os.path.exists(path):
+        return []
+    with open(path) as f:
+        return [line.split() for line in f if line.split()]
+
+
+def read_csv(parts_dir, joint_name):
+    """rows of angle, absolute, interval, stroke, ..."""
+    with open(os.path.join(parts_dir, 'csv', joint_name + '.csv')) as f:
+        return [[c.strip() for c in line.split(',')]
+                for line in f if line.strip()]
+
+
+def angle_to_stroke_map(rows, offset):
+    """one point per degree, stroke is offset + csv stroke"""
+    points = ['{%s, %s}' % (Decimal(offset) + Decimal(row[3]), row[2])
+              for row in rows]
+    return points, int(rows[0][0])
+
+
+def stroke_head(stroke):
+    """integral part of stroke, rounded down"""
+    return int(math.floor(stroke))
+
+
+def stroke_to_angle_buckets(rows, offset, function_name):
+    """points organized by integral stroke, see S2ALookup
+
+    A point is the end of its segment from the previous point
+    (previous angle and stroke to its angle and stroke),
+    a bucket has every point whose segment overlaps [head, head + 1).
+    Buckets are dense from the least to the greatest stroke.
+    """
+    strokes = [Decimal(offset) + Decimal(row[3]) for row in rows]
+    points = ['{%s, %s, %s}' % (row[0], val, row[2])
+              for row, val in zip(rows, strokes)]
+    first = stroke_head(min(strokes))
+    last = stroke_head(max(strokes))
+
+    data = []
+    buckets = []
+    for head in range(first, last + 1):
+        begin = len(data)
+        for i in range(1, len(rows)):
+            low = min(strokes[i - 1], strokes[i])
+            high = max(strokes[i - 1], strokes[i])
+            if low < head + 1 and high >= head:
+                data.append(points[i])
+        if len(data) == begin:
+            sys.stderr.write('   detected empty table in %d of %s\n'
+                             % (head, function_name))
+        buckets.append('{%d, %d}' % (begin, len(data) - begin))
+
+    return data, buckets, first
+
+
+def pchip_slopes(xs, ys):
+    """slopes of monotone cubic Hermite spline (Fritsch-Carlson)"""
+    n = len(xs)
+    h = [xs[k + 1] - xs[k] for k in range(n - 1)]
+    d = [(ys[k + 1] - ys[k]) / h[k] for k in range(n - 1)]
+    if n == 2:
+        return [d[0], d[0]]
+    m = [0.0] * n
+    for k in range(1, n - 1):
+        if d[k - 1] * d[k] > 0:
+            w1 = 2 * h[k] + h[k - 1]
+            w2 = h[k] + 2 * h[k - 1]
+            m[k] = (w1 + w2) / (w1 / d[k - 1] + w2 / d[k])
+
+    def edge(h0, h1, d0, d1):
+        # one sided three point, kept monotone
+        slope = ((2 * h0 + h1) * d0 - h0 * d1) / (h0 + h1)
+        if slope * d0 <= 0:
+            return 0.0
+        if d0 * d1 <= 0 and abs(slope) > abs(3 * d0):
+            return 3 * d0
+        return slope
+
+    m[0] = edge(h[0], h[1], d[0], d[1])
+    m[-1] = edge(h[-1], h[-2], d[-1], d[-2])
+    return m
+
+
+def spline(xs, ys, name):
+    """knots of spline y(x), x ascending, non monotone points dropped"""
+    points = sorted(zip(xs, ys))
+    increasing = points[-1][1] > points[0][1]
+    knots = [points[0]]
+    for x, y in points[1:]:
+        if x > knots[-1][0] and (y > knots[-1][1]) == increasing \
+                and y != knots[-1][1]:
+            knots.append((x, y))
+        else:
+            sys.stderr.write('   dropped non monotone point %s of %s\n'
+                             % (x, name))
+    xs = [float(x) for x, y in knots]
+    ys = [float(y) for x, y in knots]
+    return ['{%.9g, %.9g, %.9g}' % knot
+            for knot in zip(xs, ys, pchip_slopes(xs, ys))]
+
+
+def angle_to_stroke_spline(rows, offset, name):
+    """stroke(angle) through points of Angle2Stroke map"""
+    return spline([int(row[0]) for row in rows],
+                  [Decimal(offset) + Decimal(row[3]) for row in rows], name)
+
+
+def stroke_to_angle_spline(rows, offset, name):
+    """angle(stroke) through the same points"""
+    return spline([Decimal(offset) + Decimal(row[3]) for row in rows],
+                  [int(row[0]) for row in rows], name)
+
+
+def array(align, type_name, name, values):
+    return '    %sconstexpr std::array<%s, %d> %s = {{%s}};\n' % (
+        align, type_name, len(values), name, ', '.join(values))
+
+
+def offset(name, value):
+    return '    constexpr int Array%s = %d;\n' % (name, value)
+
+
+def conversion_pairs(maps, inverses):
+    """Angle2Stroke and Stroke2Angle tables of the same csv and offset"""
+    code = ('    /// @brief tables of a csv file, for tests\n'
+            '    struct ConversionPair\n'
+            '    {\n'
+            '      const char* name;\n'
+            '      const A2SData* map;\n'
+            '      int map_size;\n'
+            '      int map_offset;\n'
+            '      const S2AData* data;\n'
+            '      const S2ABucket* buckets;\n'
+            '      int buckets_size;\n'
+            '      int offset;\n'
+            '      const SplineKnot* spline;\n'
+            '      int spline_size;\n'
+            '      const SplineKnot* inverse_spline;\n'
+            '      int inverse_spline_size;\n'
+            '      /// @brief index of pair coupled by dualJoint, -1 if none,\n'
+            '      ///   strokes are coupled + this and coupled - this\n'
+            '      int coupled;\n'
+            '    };\n'
+            '\n')
+    pairs = []
+    index = {}
+    for csv, value, map_name, offset_name, spline_name, coupled in maps:
+        if (csv, value) not in inverses:
+            sys.stderr.write('   no Stroke2Angle table of %s offset %s\n'
+                             % (csv, value))
+            continue
+        index[map_name] = len(pairs)
+        pairs.append([csv, map_name, offset_name, spline_name,
+                      inverses[(csv, value)], coupled])
+    items = []
+    for csv, map_name, offset_name, spline_name, func, coupled in pairs:
+        items.append('{"%s", %s.data(), %s.size(), Array%s, '
+                     '%sData.data(), %sBuckets.data(), %sBuckets.size(), '
+                     'Array%sOffset, %s.data(), %s.size(), '
+                     '%sSpline.data(), %sSpline.size(), %d}'
+                     % (csv, map_name, map_name, offset_name,
+                        func, func, func, func, spline_name, spline_name,
+                        func, func, index.get(coupled, -1)))
+    code += ('    static const ConversionPair ConversionPairs[] = {\n'
+             '      %s\n'
+             '    };\n') % (',\n      '.join(items))
+    return code
+
+
+def generate(robot_dir, pairs=False):
+    code = ''
+    # (csv, offset, map, offset, spline, map coupled by dualJoint)
+    maps = []
+    # Stroke2Angle table of (csv, offset)
+    inverses = {}
+    for parts_dir in parts_dirs(robot_dir):
+        for words in read_config(parts_dir, 'Angle2Stroke.cfg'):
+            func = words[0]
+            if len(words) < 6:
+                points, first = angle_to_stroke_map(
+                    read_csv(parts_dir, words[2]), words[4])
+                code += array('', 'A2SData', func + 'Map', points)
+                code += offset(func + 'Offset', first)
+                code += array('', 'SplineKnot', func + 'Spline',
+                              angle_to_stroke_spline(
+                                  read_csv(parts_dir, words[2]), words[4],
+                                  func))
+                maps.append((words[2], Decimal(words[4]), func + 'Map',
+                             func + 'Offset', func + 'Spline', None))
+            else:
+                # first table has offset_r, second has offset_p
+                points, first = angle_to_stroke_map(
+                    read_csv(parts_dir, words[2]), words[7])
+                code += array('', 'A2SData', func + 'Map1', points)
+                code += offset(func + 'Offset1', first)
+                code += array('', 'SplineKnot', func + 'Spline1',
+                              angle_to_stroke_spline(
+                                  read_csv(parts_dir, words[2]), words[7],
+                                  func))
+                points, first = angle_to_stroke_map(
+                    read_csv(parts_dir, words[3]), words[5])
+                code += array('', 'A2SData', func + 'Map2', points)
+                code += offset(func + 'Offset2', first)
+                code += array('', 'SplineKnot', func + 'Spline2',
+                              angle_to_stroke_spline(
+                                  read_csv(parts_dir, words[3]), words[5],
+                                  func))
+                maps.append((words[2], Decimal(words[7]), func + 'Map1',
+                             func + 'Offset1', func + 'Spline1',
+                             func + 'Map2'))
+                maps.append((words[3], Decimal(words[5]), func + 'Map2',
+                             func + 'Offset2', func + 'Spline2', None))
+        for words in read_config(parts_dir, 'Stroke2Angle.cfg'):
+            func = words[0]
+            data, buckets, array_offset = stroke_to_angle_buckets(
+                read_csv(parts_dir, words[2]), words[4], func)
+            code += array('alignas(64) ', 'S2AData', func + 'Data', data)
+            code += array('', 'S2ABucket', func + 'Buckets', buckets)
+            code += offset(func + 'Offset', array_offset)
+            code += array('', 'SplineKnot', func + 'Spline',
+                          stroke_to_angle_spline(
+                              read_csv(parts_dir, words[2]), words[4], func))
+            inverses[(words[2], Decimal(words[4]))] = func
+
+    if pairs:
+        code += '\n' + conversion_pairs(maps, inverses)
+
+    return ('/*\n'
+            ' * This file auto-generated from script. Do not Edit!\n'
+            ' * Original : aero_description/scripts/make_conversion_tables.py\n'
+            ' * Original : csv files of parts in %s/robot.cfg\n'
+            '*/\n'
+            '#ifndef AERO_COMMON_CONVERSION_TABLES_H_\n'
+            '#define AERO_COMMON_CONVERSION_TABLES_H_\n'
+            '\n'
+            '#include <array>\n'
+            '\n'
+            '#include "aero_hardware_interface/ConversionTable.hh"\n'
+            '\n'
+            'namespace aero\n'
+            '{\n'
+            '  namespace common\n'
+            '  {\n'
+            '%s'
+            '  }\n'
+            '}\n'
+            '\n'
+            '#endif\n') % (os.path.basename(os.path.normpath(robot_dir)), code)
+
+
+def depends(robot_dir):
+    """robot.cfg, configs and csv files used by tables"""
+    files = [os.path.abspath(os.path.join(robot_dir, 'robot.cfg'))]
+    for parts_dir in parts_dirs(robot_dir):
+        csv_dir = os.path.join(parts_dir, 'csv')
+        for name in sorted(os.listdir(csv_dir)):
+            if name.endswith('.cfg') or name.endswith('.csv'):
+                files.append(os.path.join(csv_dir, name))
+    return files
+
+
+if __name__ == '__main__':
+    parser = argparse.ArgumentParser()
+    parser.add_argument('robot_dir')
+    parser.add_argument('--output')
+    parser.add_argument('--depends', action='store_true',
+                        help='print files of tables as cmake list')
+    parser.add_argument('--pairs', action='store_true',
+                        help='add tables of each csv for tests')
+    args = parser.parse_args()
+
+    if args.depends:
+        sys.stdout.write(';'.join(depends(args.robot_dir)))
+    elif args.output:
+        code = generate(args.robot_dir, args.pairs)
+        if not os.path.isdir(os.path.dirname(os.path.abspath(args.output))):
+            os.makedirs(os.path.dirname(os.path.abspath(args.output)))
+        with open(args.output, 'w') as f:
+            f.write(code)
+    else:
+        sys.stdout.write(generate(args.robot_dir, args.pairs))
@@ -33,166 +33,22 @@ replace_meta_in_output_file() {
     done < /tmp/aero_CAN_order
 }
 
-create_table_func_from_csv() {
-    joint_name=$1
-    # offset=$2
-    output_file=$3
-    function_name=$4
-    template_file=$5
-    parts_dir=$6
-
-    # parse joint_name
-    file="${parts_dir}/csv/${joint_name}.csv"
-
-    # load csv
-    csv=()
-    csv_interval=()
-    j=0
-    while read line
-    do
-        Angle[j]=$(echo "$line" | cut -d ',' -f1)
-	csv[j]=$(echo "$line" | cut -d ',' -f4)
-	csv_interval[j]=$(echo "$line" | cut -d ',' -f3)
-	j=$(($j + 1))
-    done < $file
-
-    # preparation for stroke-angle-table : organize csv according to integral
-    table=()
-    ntable=()
-    ntable[0]=""
-    idx=0
-    bef_head=""
-    for e in "${csv[@]}"
-    do
-	val=$(echo "$2 + $e" | bc)
-	head=$(echo "${val}" | sed s/\.[0-9,]*$//g)
-
-	# getting rid of possible bugs
-	if [[ $head == "-" ]]
-	then
-	    head=0
-	elif [[ $head == "" ]]
-	then
-	    head=0
-	fi
-
-	if [[ $head -lt 0 ]] # when stroke is negative
-	then
-	    head=$(echo "-1 * $head" | bc)
-	    # if +1 degree results to more than +1 stroke
-	    if [[ ${bef_head} != ""  ]]
-	    then
-		if [[ $(echo "$head - $bef_head" | bc ) -gt 1 ]]
-		then
-		    ntable[$(($head - 1))]=""
-		fi
-	    fi
-	    bef_head=$head
-	    ntable[$head]="${ntable[$head]}{${Angle[${idx}]},${val},${csv_interval[${idx}]}},"
-	else # when stroke is positive
-	    # if +1 degree results to more than +1 stroke
-	    if [[ ${bef_head} != ""  ]]
-	    then
-		if [[ $(echo "$head - $bef_head" | bc ) -gt 1 ]]
-		then
-		    table[$(($head - 1))]=""
-		fi
-	    fi
-	    bef_head=$head
-
-	    table[$head]="${table[$head]}{${Angle[${idx}]},${val},${csv_interval[${idx}]}},"
-	fi
-	idx=$(($idx + 1))
-    done
-
-    code=''
-    array_offset=0
-
-    # negative stroke value case
-    if [[ ${#ntable[@]} -gt 0 ]]
-    then
-        idx=$((${#ntable[@]} - 1))
-        e=${ntable[$idx]}
-        if [[ $e != "" ]]
-        then
-            code="${code}{{${e::-1}},{}}, "
-            array_offset="-$idx"
-        elif [[ ${#ntable[@]} -gt 1 ]]
-        then
-            idx=$(($idx - 1))
-            array_offset="-$idx"
-        fi
-    fi
-    for (( idx=${#ntable[@]}-2 ; idx>=0 ; idx-- ))
-    do
-        e=${ntable[$idx]}
-	if [[ $e != "" ]]
-	then
-            code="${code}{{${e::-1}},"
-	    j=1
-	    if [[ ${ntable[$(($idx + $j))]} == "" ]]
-	    then
-		j=2
-	    fi
-	    appendix=$(echo -e "${ntable[$(($idx + $j))]}")
-            if [[ "$appendix" = "" ]]
-            then
-                code="${code}{}}, "
-            else
-		code="${code}{${appendix::-1}}}, "
-            fi
-        elif [[ $idx != 0 ]]
-        then
-            echo "   detected empty table in -${idx} of ${function_name}"
-            code="${code}{{{0,0.0f,0.0f}}, {}}, "
-	fi
-    done
-
-    # positive stroke value case
-    idx=0
-    for e in "${table[@]}"
-    do
-	if [[ $e != "" ]]
-	then
-            code="${code}{{${e::-1}},"
-	    if [[ $idx -lt $((${#table[@]} - 1)) ]]
-	    then
-		appendix=$(echo -e "${table[$(($idx + 1))]}")
-                if [[ "$appendix" = "" ]]
-                then
-                    code="${code}{}}, "
-                else
-		    code="${code}{${appendix::-1}}}, "
-                fi
-            else
-                code="${code}{}}, "
-	    fi
-        else
-            echo "   detected empty table in ${idx} of ${function_name}"
-            code="${code}{{{0,0.0f,0.0f}}, {}}, "
-	fi
-	idx=$(($idx + 1))
-    done
-    code="${code::-2}"
+create_table_func() {
+    output_file=$1
+    function_name=$2
+    template_file=$3
 
     awk "/float TableTemplate/,/};/" $template_file > /tmp/mjointsanglehh
+    echo " " >> /tmp/mjointsanglehh
+    awk "/ConversionJet TableTemplate/,/};/" $template_file >> /tmp/mjointsanglehh
     sed -i "s/TableTemplate/${function_name}/g" /tmp/mjointsanglehh
 
     write_to_line=$(grep -n -m 1 "void Stroke2Angle" $output_file | cut -d ':' -f1)
     write_to_line=$(($write_to_line - 1))
     write_to_top_line=$write_to_line
 
-    IFS=''
-    while read line
-    do
-    	echo "${line}" | xargs -0 -I{} sed -i "${write_to_line}i\{}" $output_file
-	write_to_line=$(($write_to_line + 1))
-    done < /tmp/mjointsanglehh
-
-    write_declare_map=$(grep -n -m 1 "};" $output_file | cut -d ':' -f1)
-    write_declare_map=$(($write_declare_map + 1))
-    sed -i "${write_declare_map}i\    static const int Array${function_name}Offset = ${array_offset};" $output_file
-    sed -i "${write_declare_map}i\    static const std::vector<std::pair<std::vector<S2AData>, std::vector<S2AData>>> ${function_name}Candidates = {${code}};" $output_file
+    # tables are in ConversionTables.hh, see make_conversion_tables.py
+    sed -i "$(($write_to_line - 1))r /tmp/mjointsanglehh" $output_file
 
     sed -i "${write_to_top_line}i\    //////////////////////////////////////////////////" $output_file
     sed -i "${write_to_top_line}i\ " $output_file
@@ -200,20 +56,49 @@ create_table_func_from_csv() {
     echo -e "created ${function_name}"
 }
 
+## @brief joint velocities of stroke velocities, Stroke2Angle with
+##   ConversionJet instead of float, so table functions are evaluated
+##   with their splines and derivatives are chained through Stroke2Angle
+create_velocity_func() {
+    output_file=$1
+
+    awk "/void Stroke2Angle/,/};/" $output_file > /tmp/mjointsanglevel
+    awk '
+/_angles\[[0-9]*\] =/ {
+  sub(/_angles\[/, "_velocities[")
+  sub(/ = */, " = JetRate(")
+  open = 1
+}
+open && /;$/ {
+  sub(/;$/, ");")
+  open = 0
+}
+{ print }' /tmp/mjointsanglevel > /tmp/mjointsanglevel_rates
+    mv /tmp/mjointsanglevel_rates /tmp/mjointsanglevel
+
+    sed -i "s/void Stroke2Angle/void Stroke2AngleVelocity/" /tmp/mjointsanglevel
+    sed -i "s/(std::vector<double>& _angles, const std::vector<int16_t>& _strokes)/(std::vector<double>\& _velocities, const std::vector<int16_t>\& _strokes,\n     const std::vector<double>\& _stroke_velocities)/" /tmp/mjointsanglevel
+    sed -i "s/\bfloat /ConversionJet /g" /tmp/mjointsanglevel
+    sed -i "s/_strokes\[\([0-9]*\)\]/ConversionJet(_strokes[\1], _stroke_velocities[\1])/g" /tmp/mjointsanglevel
+    sed -i '1 i\ \n    //////////////////////////////////////////////////' /tmp/mjointsanglevel
+
+    write_to_line=$(grep -n -m 1 "void Stroke2Angle" $output_file | cut -d ':' -f1)
+    end_line=$(tail -n +$write_to_line $output_file | grep -n -m 1 "};" | cut -d ':' -f1)
+    sed -i "$(($write_to_line + $end_line - 1))r /tmp/mjointsanglevel" $output_file
+}
+
 cp $input_file $output_file
 replace_meta_in_output_file $output_file
+create_velocity_func $output_file
 
 read_csv_config() {
     csv_file=$1
-    parts_dir=$2
     total_tables=$(wc -l $csv_file | awk '{print $1}')
     for (( table_number=1; table_number<=${total_tables}; table_number++ ))
     do
         line=$(sed -n "${table_number} p" $csv_file)
-        csv=$(echo "${line}" | awk '{print $3}')
         func=$(echo "${line}" | awk '{print $1}')
-        offset=$(echo "${line}" | awk '{print $5}')
-        create_table_func_from_csv $csv $offset $output_file $func $template_file $parts_dir
+        create_table_func $output_file $func $template_file
     done
 }
 
@@ -247,7 +132,7 @@ do
     fi
 
     csv_file="${parts_dir}/csv/Stroke2Angle.cfg"
-    read_csv_config $csv_file $parts_dir
+    read_csv_config $csv_file
 done < $robot_file
 
 # write warnings
@@ -266,8 +151,7 @@ sed -i "/#ifndef/d" $output_source
 sed -i "/#define/d" $output_source
 sed -i "/#endif/d" $output_source
 sed -i "s/};/}/g" $output_source
-sed -i "/static const int Array/ d" $output_source
-sed -i "/static const std::vector<std::pair<std::vector<S2AData>, std::vector<S2AData>>>/ d" $output_source
+sed -i "/#include \"aero_hardware_interface\/Stroke2Angle.hh\"/a #include \"aero_hardware_interface\/ConversionTables.hh\"" $output_source
 
 edit_start=$(grep -n -m 1 "//////" $output_file | cut -d ':' -f1)
 tail -n +$edit_start $output_file > /tmp/aero_modify_header
@@ -5,6 +5,7 @@
 #include <algorithm>
 #include <stdint.h>
 #include <math.h> // for M_PI
+#include "aero_hardware_interface/ConversionTable.hh"
 #include "aero_hardware_interface/Angle2Stroke.hh"
 
 namespace aero
@@ -20,7 +21,7 @@ namespace aero
 
     //////////////////////////////////////////////////
     void Angle2Stroke
-    (std::vector<int16_t>& _strokes, const std::vector<double> _angles)
+    (std::vector<int16_t>& _strokes, const std::vector<double>& _angles)
     {
       float rad2Deg = 180.0 / M_PI;
       float scale = 100.0;
@@ -5,6 +5,7 @@
 #include <algorithm>
 #include <stdint.h>
 #include <math.h> // for M_PI
+#include "aero_hardware_interface/ConversionTable.hh"
 #include "aero_hardware_interface/Stroke2Angle.hh"
 
 namespace aero
@@ -12,16 +13,9 @@ namespace aero
   namespace common
   {
 
-    struct S2AData
-    {
-      int angle;
-      float stroke;
-      float range;
-    };
-
     //////////////////////////////////////////////////
     void Stroke2Angle
-    (std::vector<double>& _angles, const std::vector<int16_t> _strokes)
+    (std::vector<double>& _angles, const std::vector<int16_t>& _strokes)
     {
       float scale = 0.01;
       float left_wrist_roll_stroke =
@@ -42,7 +36,7 @@ namespace aero
       meta =
         deg2Rad * WaistPitchInvTable(waist_pitch_stroke);
       meta =
-        deg2Rad * WaistRollInvTable(scale * can_waist_right - waist_pitch_stroke);
+        -deg2Rad * WaistRollInvTable(waist_pitch_stroke - scale * can_waist_right);
 
       meta =
         -deg2Rad * ShoulderPitchInvTable(scale * can_l_shoulder_p);
@@ -70,7 +64,7 @@ namespace aero
       meta =
         deg2Rad * NeckPitchInvTable(neck_pitch_stroke);
       meta =
-        -deg2Rad * NeckRollInvTable(scale * can_neck_right - neck_pitch_stroke);
+        deg2Rad * NeckRollInvTable(scale * can_neck_right - neck_pitch_stroke);
 
       meta =
         -deg2Rad * ShoulderPitchInvTable(scale * can_r_shoulder_p);
@@ -39,9 +39,13 @@
 
 #include "aero_robot_hardware.h"
 #include <urdf/model.h>
+#include <chrono>
+#include <cmath>
+#include <limits>
 #include "std_msgs/Float32.h"
-
-#include <thread>
+#include <diagnostic_msgs/DiagnosticArray.h>
+#include "aero_hardware_interface/SEEDBusDiagnostics.hh"
+#include "aero_hardware_interface/AeroBusConfig.hh"
 
 namespace aero_robot_hardware
 {
@@ -72,26 +76,85 @@ bool AeroRobotHW::init(ros::NodeHandle& root_nh, ros::NodeHandle &robot_hw_nh)//
   }  else {
     OVERLAP_SCALE_    = 2.8;     //
   }
+  // poll step out status in the same bus cycle as position command
+  POLL_STATUS_ = false;
+  if (robot_hw_nh.hasParam("poll_status")) {
+    robot_hw_nh.getParam("poll_status", POLL_STATUS_);
+  }
+  // cpu and SCHED_FIFO priority of bus threads, -1 and 0 to keep default
+  int cpu_upper = -1, cpu_lower = -1, io_priority = 0;
+  robot_hw_nh.param("cpu_upper", cpu_upper, -1);
+  robot_hw_nh.param("cpu_lower", cpu_lower, -1);
+  robot_hw_nh.param("io_priority", io_priority, 0);
+  // lock pages in memory, no page fault in control and bus threads
+  bool lock_memory;
+  robot_hw_nh.param("lock_memory", lock_memory, false);
+  // fraction of bus time for current/temperature/voltage queries
+  double telemetry_budget;
+  robot_hw_nh.param("telemetry_budget", telemetry_budget, 0.05);
+  // joint velocity from stroke readings, low pass cutoff 0 for none
+  double velocity_cutoff, velocity_timeout;
+  robot_hw_nh.param("velocity_cutoff", velocity_cutoff, 5.0);
+  robot_hw_nh.param("velocity_timeout", velocity_timeout, 0.5);
+  // actuator force per unit of current, effort is J^T force
+  robot_hw_nh.param("current_force_scale", CURRENT_FORCE_SCALE_, 1.0);
+  // record bus traffic for seed_replay, empty for no capture
+  std::string capture_upper, capture_lower;
+  robot_hw_nh.param("capture_upper", capture_upper, std::string(""));
+  robot_hw_nh.param("capture_lower", capture_lower, std::string(""));
+
+  // boards, upper and lower by default
+  std::vector<AeroBoardConfig> boards =
+    AeroBus::default_config(port_upper, port_lower);
+  boards[0].cpu = cpu_upper;
+  boards[0].capture = capture_upper;
+  boards[1].cpu = cpu_lower;
+  boards[1].capture = capture_lower;
+  if (!load_board_config(robot_hw_nh, "boards", boards)) {
+    return false;
+  }
 
-  ROS_INFO("upper_port: %s", port_upper.c_str());
-  ROS_INFO("lower_port: %s", port_lower.c_str());
+  for (size_t b = 0; b < boards.size(); ++b) {
+    ROS_INFO("%s_port: %s", boards[b].name.c_str(), boards[b].port.c_str());
+  }
   ROS_INFO("cycle: %f [ms], overlap_scale %f", CONTROL_PERIOD_US_*0.001, OVERLAP_SCALE_);
 
-  // create controllersd
-  controller_upper_.reset(new AeroUpperController(port_upper));
-  controller_lower_.reset(new AeroLowerController(port_lower));
+  // create controllers, one long-lived worker per board
+  if (!bus_.open(boards)) {
+    ROS_ERROR("invalid board list");
+    return false;
+  }
+  upper_index_ = bus_.find("upper");
+  lower_index_ = bus_.find("lower");
+  if (upper_index_ < 0 || lower_index_ < 0) {
+    ROS_ERROR("boards must have upper and lower");
+    return false;
+  }
+  controller_upper_ =
+    std::static_pointer_cast<AeroUpperController>(bus_.board(upper_index_));
+  controller_lower_ =
+    std::static_pointer_cast<AeroLowerController>(bus_.board(lower_index_));
+  if (lock_memory && !aero::controller::lock_memory()) {
+    ROS_WARN("failed to lock memory");
+  }
+  if (!bus_.set_scheduling(io_priority)) {
+    ROS_WARN("failed to set cpu affinity or priority of bus threads");
+  }
+  bus_.set_telemetry(telemetry_budget, CONTROL_PERIOD_US_ * 1e-6);
+  last_bus_stats_.resize(bus_.size());
 
   // joint list
-  number_of_angles_ =
-    controller_upper_->get_number_of_angle_joints() +
-    controller_lower_->get_number_of_angle_joints();
+  number_of_angles_ = 0;
+  for (size_t b = 0; b < bus_.size(); ++b) {
+    number_of_angles_ += bus_.board(b)->get_number_of_angle_joints();
+  }
 
   joint_list_.resize(number_of_angles_);
   for(int i = 0; i < number_of_angles_; i++) {
     std::string name;
-    if(controller_upper_->get_joint_name(i, name)) {
-      joint_list_[i] = name;
-    } else if (controller_lower_->get_joint_name(i, name)) {
+    size_t b = 0;
+    while (b < bus_.size() && !bus_.board(b)->get_joint_name(i, name)) ++b;
+    if (b < bus_.size()) {
       joint_list_[i] = name;
     } else {
       ROS_WARN_STREAM("name of joint " << i << "can not find!");
@@ -116,6 +179,17 @@ bool AeroRobotHW::init(ros::NodeHandle& root_nh, ros::NodeHandle &robot_hw_nh)//
   prev_ref_positions_.resize(number_of_angles_);
   initialized_flag_ = false;
 
+  act_strokes_.resize(AERO_DOF);
+  act_stamps_.resize(AERO_DOF);
+  act_positions_.resize(number_of_angles_);
+  act_velocities_.resize(number_of_angles_);
+  stroke_velocity_.configure(velocity_cutoff, velocity_timeout);
+  stroke_velocity_.resize(AERO_DOF);
+  currents_.resize(AERO_DOF);
+  current_stamp_ = 0;
+  stroke_column_.resize(AERO_DOF);
+  initEffort();
+
   std::string model_str;
   if (!root_nh.getParam("robot_description", model_str)) {
     ROS_ERROR("Failed to get model from robot_description");
@@ -191,10 +265,11 @@ bool AeroRobotHW::init(ros::NodeHandle& root_nh, ros::NodeHandle &robot_hw_nh)//
   //registerInterface(&vj_interface_);
   //registerInterface(&ej_interface_);
 
-  upper_send_enable_ = true;
   // lower_send_enable_ = true;
 
   voltage_pub_ = robot_hw_nh.advertise<std_msgs::Float32>("voltage", 1);
+  diagnostics_pub_ =
+    root_nh.advertise<diagnostic_msgs::DiagnosticArray>("diagnostics", 1);
 
   return true;
 }
@@ -204,69 +279,33 @@ void AeroRobotHW::readPos(const ros::Time& time, const ros::Duration& period, bo
   /////
   ROS_DEBUG("read %d", update);
 
+  // whole body strokes, 0 when port is not activated
   mutex_lower_.lock();
   mutex_upper_.lock();
-  // TODO: thrading?? or making no wait
+  // all boards in parallel, stopped upper is not read
   if (update) {
-#if 0 // NO_THREAD
-    controller_upper_->update_position();
-    controller_lower_->update_position();
-#else
-    std::thread t1([&](){
-        if(upper_send_enable_) {
-          controller_upper_->update_position();
-        }
-      });
-    std::thread t2([&](){
-        controller_lower_->update_position();
-      });
-    t1.join();
-    t2.join();
-#endif
+    bus_.update_position();
   }
-  // get upper actual positions
-  std::vector<int16_t> upper_act_strokes =
-    controller_upper_->get_actual_stroke_vector();
-  // get lower actual positions
-  std::vector<int16_t> lower_act_strokes =
-    controller_lower_->get_actual_stroke_vector();
+  bus_.get_actual_stroke_vector(act_strokes_, act_stamps_);
   mutex_upper_.unlock();
   mutex_lower_.unlock();
-
-  // whole body strokes
-  std::vector<int16_t> act_strokes (AERO_DOF_UPPER + AERO_DOF_LOWER);
-  if (upper_act_strokes.size() < AERO_DOF_UPPER) {
-    for (size_t i = 0; i < AERO_DOF_UPPER; ++i) {
-      act_strokes[i] = 0;
-    }
-  } else { // usually should enter else, enters if when port is not activated
-    for (size_t i = 0; i < AERO_DOF_UPPER; ++i) {
-      act_strokes[i] = upper_act_strokes[i];
-    }
-  }
-  if ( lower_act_strokes.size() < AERO_DOF_LOWER ) {
-    for (size_t i = 0; i < AERO_DOF_LOWER; ++i) {
-      act_strokes[i + AERO_DOF_UPPER] = 0; //??
-    }
-  } else { // usually should enter else, enters if when port is not activated
-    for (size_t i = 0; i < AERO_DOF_LOWER; ++i) {
-      act_strokes[i + AERO_DOF_UPPER] = lower_act_strokes[i];
-    }
-  }
   // whole body positions from strokes
-  std::vector<double> act_positions;
-  act_positions.resize(number_of_angles_);
-  common::Stroke2Angle(act_positions, act_strokes);
+  common::Stroke2Angle(act_positions_, act_strokes_);
+
+  // velocities of strokes between readings, through Jacobian of Stroke2Angle
+  int64_t now = std::chrono::duration_cast<std::chrono::nanoseconds>(
+      std::chrono::steady_clock::now().time_since_epoch()).count();
+  stroke_velocity_.update(act_strokes_, act_stamps_, now);
+  common::Stroke2AngleVelocity(act_velocities_, act_strokes_,
+                               stroke_velocity_.velocities());
 
   // DEBUG
   // act_strokes
   // act_positions
   //
 
-  double tm = period.toSec();
   for(unsigned int j=0; j < number_of_angles_; j++) {
-    float position = act_positions[j];
-    float velocity = 0.0;
+    float position = act_positions_[j];
 
     if (joint_types_[j] == PRISMATIC) {
       joint_position_[j] = position;
@@ -274,9 +313,9 @@ void AeroRobotHW::readPos(const ros::Time& time, const ros::Duration& period, bo
       //joint_position_[j] += angles::shortest_angular_distance(joint_position_[j], position);
       joint_position_[j] = position;
     }
-    joint_velocity_[j] = velocity; // read velocity from HW
-    joint_effort_[j]   = 0;        // read effort   from HW
+    joint_velocity_[j] = act_velocities_[j]; // estimated from strokes
   }
+  readEffort();
 
   if (!initialized_flag_) {
     for(unsigned int j = 0; j < number_of_angles_; j++) {
@@ -287,6 +326,67 @@ void AeroRobotHW::readPos(const ros::Time& time, const ros::Duration& period, bo
   }
 }
 
+void AeroRobotHW::initEffort()
+{
+  // strokes depending on each joint, a NaN rate goes through
+  // every stroke of the joint, even where its table is flat
+  std::vector<double> angles(number_of_angles_, 0.0);
+  std::vector<double> velocities(number_of_angles_, 0.0);
+  std::vector<std::vector<bool> > used;
+  effort_groups_.clear();
+  effort_joints_.clear();
+  for(unsigned int j = 0; j < number_of_angles_; j++) {
+    velocities[j] = std::numeric_limits<double>::quiet_NaN();
+    common::Angle2StrokeVelocity(stroke_column_, angles, velocities);
+    velocities[j] = 0.0;
+
+    // first group without these strokes, coupled joints get two groups
+    size_t g = 0;
+    for (; g < used.size(); ++g) {
+      bool shared = false;
+      for (size_t s = 0; s < stroke_column_.size(); ++s)
+        shared = shared || (std::isnan(stroke_column_[s]) && used[g][s]);
+      if (!shared) break;
+    }
+    if (g == used.size()) {
+      used.push_back(std::vector<bool>(AERO_DOF, false));
+      effort_groups_.push_back(std::vector<double>(number_of_angles_, 0.0));
+      effort_joints_.push_back(std::vector<int>(AERO_DOF, -1));
+    }
+    for (size_t s = 0; s < stroke_column_.size(); ++s) {
+      if (!std::isnan(stroke_column_[s])) continue;
+      used[g][s] = true;
+      effort_joints_[g][s] = j;
+    }
+    effort_groups_[g][j] = 1.0;
+  }
+}
+
+void AeroRobotHW::readEffort()
+{
+  // currents are queried by telemetry, slower than positions
+  int64_t stamp = bus_.get_current_vector(currents_);
+  if (stamp == current_stamp_) return;
+  current_stamp_ = stamp;
+
+  // effort of joint j is force . ds/dq_j, column j of Jacobian of
+  // Angle2Stroke at current positions [0.01 mm/rad],
+  // one Angle2StrokeVelocity per group instead of per joint
+  for(unsigned int j = 0; j < number_of_angles_; j++) {
+    joint_effort_[j] = 0.0;
+  }
+  for (size_t g = 0; g < effort_groups_.size(); ++g) {
+    common::Angle2StrokeVelocity(stroke_column_, joint_position_,
+                                 effort_groups_[g]);
+    for (size_t s = 0; s < stroke_column_.size(); ++s) {
+      int j = effort_joints_[g][s];
+      if (j < 0) continue;
+      joint_effort_[j] +=
+        CURRENT_FORCE_SCALE_ * currents_[s] * stroke_column_[s] * 1e-5;
+    }
+  }
+}
+
 void AeroRobotHW::read(const ros::Time& time, const ros::Duration& period)
 {
   //
@@ -359,30 +459,15 @@ void AeroRobotHW::write(const ros::Time& time, const ros::Duration& period)
   std::vector<int16_t> snt_strokes(ref_strokes);
   common::UnusedAngle2Stroke(snt_strokes, mask_positions);
 
-  // split strokes into upper and lower
-  std::vector<int16_t> upper_strokes(snt_strokes.begin(), snt_strokes.begin() + AERO_DOF_UPPER);
-  std::vector<int16_t> lower_strokes(snt_strokes.begin() + AERO_DOF_UPPER, snt_strokes.end());
-
   uint16_t time_csec = static_cast<uint16_t>((OVERLAP_SCALE_ * CONTROL_PERIOD_US_)/(1000*10));
 
   mutex_lower_.lock();
   mutex_upper_.lock();
   {
-#if 0 // NO_THREAD
-    controller_upper_->set_position(upper_strokes, time_csec);
-    controller_lower_->set_position(lower_strokes, time_csec);
-#else
-    std::thread t1([&](){
-        controller_upper_->set_position(upper_strokes, time_csec);
-      });
-    std::thread t2([&](){
-        controller_lower_->set_position(lower_strokes, time_csec);
-      });
-    t1.join();
-    t2.join();
+    // split to boards, cycle takes as long as the slowest bus
+    bus_.set_position(snt_strokes, time_csec, POLL_STATUS_);
     //usleep( 1000 * 2 ); // why needed?
   }
-#endif
   mutex_upper_.unlock();
   mutex_lower_.unlock();
 
@@ -435,11 +520,54 @@ void AeroRobotHW::stopWheelServo() {
 void AeroRobotHW::readVoltage(const ros::TimerEvent& _event) {
   ROS_DEBUG("read voltage");
 
-  mutex_lower_.lock();
+  // queried by telemetry in idle bus time, no bus access here
   std_msgs::Float32 voltage;
-  voltage.data = controller_lower_->get_voltage();
+  voltage.data = bus_.worker(lower_index_)->telemetry().voltage;
   voltage_pub_.publish(voltage);
-  mutex_lower_.unlock();
+}
+
+static void addTelemetry(diagnostic_msgs::DiagnosticArray& _array,
+                         const std::string& _name,
+                         std::shared_ptr<AeroControllerProto> _controller,
+                         const AeroTelemetry& _telemetry)
+{
+  diagnostic_msgs::DiagnosticStatus status;
+  status.name = "aero: " + _name;
+  status.hardware_id = _name;
+  status.level = diagnostic_msgs::DiagnosticStatus::OK;
+  status.message = "OK";
+  if (_telemetry.voltage_stamp == 0 && _telemetry.current_stamp == 0) {
+    status.level = diagnostic_msgs::DiagnosticStatus::STALE;
+    status.message = "no telemetry";
+  }
+
+  diagnostic_msgs::KeyValue kv;
+  kv.key = "voltage";
+  kv.value = std::to_string(_telemetry.voltage);
+  status.values.push_back(kv);
+  for (size_t i = 0; i < _telemetry.size; ++i) {
+    std::string joint = _controller->get_stroke_joint_name(i);
+    kv.key = joint + " current";
+    kv.value = std::to_string(_telemetry.current[i]);
+    status.values.push_back(kv);
+    kv.key = joint + " temperature";
+    kv.value = std::to_string(_telemetry.temperature[i]);
+    status.values.push_back(kv);
+  }
+  _array.status.push_back(status);
+}
+
+void AeroRobotHW::publishDiagnostics(const ros::TimerEvent& _event) {
+  diagnostic_msgs::DiagnosticArray array;
+  array.header.stamp = ros::Time::now();
+  for (size_t b = 0; b < bus_.size(); ++b) {
+    addTelemetry(array, bus_.name(b), bus_.board(b), bus_.worker(b)->telemetry());
+
+    SEEDBusStats stats = bus_.board(b)->get_bus_stats();
+    array.status.push_back(bus_diagnostics(bus_.name(b), stats, last_bus_stats_[b]));
+    last_bus_stats_[b] = stats;
+  }
+  diagnostics_pub_.publish(array);
 }
 
 }
@@ -60,6 +60,8 @@
 #include "aero_hardware_interface/Constants.hh"
 #include "aero_hardware_interface/CommandList.hh"
 #include "aero_hardware_interface/AeroControllers.hh"
+#include "aero_hardware_interface/AeroBus.hh"
+#include "aero_hardware_interface/StrokeVelocityEstimator.hh"
 
 #include "aero_hardware_interface/AngleJointNames.hh"
 #include "aero_hardware_interface/Stroke2Angle.hh"
@@ -80,7 +82,10 @@ class AeroRobotHW : public hardware_interface::RobotHW
 public:
   AeroRobotHW() { }
 
-  virtual ~AeroRobotHW() {}
+  virtual ~AeroRobotHW() {
+    // workers use controllers
+    bus_.close();
+  }
 
   /** \brief The init function is called to initialize the RobotHW from a
    * non-realtime thread.
@@ -136,10 +141,13 @@ public:
 
   ///
   void readPos(const ros::Time& time, const ros::Duration& period, bool update);
+  void readEffort();
+  void initEffort();
   void writeWheel(const std::vector< std::string> &_names, const std::vector<int16_t> &_vel, double _tm_sec);
   void startWheelServo();
   void stopWheelServo();
   void readVoltage(const ros::TimerEvent& _event);
+  void publishDiagnostics(const ros::TimerEvent& _event);
 
   std::string getVersion() {
     mutex_upper_.lock();
@@ -159,12 +167,12 @@ public:
   }
   void stopUpper() {
     mutex_upper_.lock();
-    upper_send_enable_ = false;
+    bus_.set_enabled(upper_index_, false);
     mutex_upper_.unlock();
   }
   void startUpper() {
     mutex_upper_.lock();
-    upper_send_enable_ = true;
+    bus_.set_enabled(upper_index_, true);
     mutex_upper_.unlock();
   }
   void servo(uint16_t _sendnum) { // send servo on command
@@ -211,17 +219,42 @@ protected:
 
   std::vector<double> prev_ref_positions_;
 
-  boost::shared_ptr<AeroUpperController > controller_upper_;
-  boost::shared_ptr<AeroLowerController > controller_lower_;
+  // buffers of readPos, allocated in init
+  std::vector<int16_t> act_strokes_;
+  std::vector<int64_t> act_stamps_;
+  std::vector<double>  act_positions_;
+  std::vector<double>  act_velocities_;
+  // joint velocities from differences of stroke readings
+  StrokeVelocityEstimator stroke_velocity_;
+  // efforts from telemetry currents through Jacobian of Angle2Stroke,
+  // columns of joints sharing no stroke are computed together:
+  // unit velocities of each group, joint of each stroke in it (-1 if none)
+  std::vector<int16_t> currents_;
+  int64_t current_stamp_;
+  double  CURRENT_FORCE_SCALE_;
+  std::vector<std::vector<double> > effort_groups_;
+  std::vector<std::vector<int> > effort_joints_;
+  std::vector<double> stroke_column_;
+
+  // all boards, each with its own worker
+  AeroBus bus_;
+  // boards of bus_ with upper and lower body commands
+  std::shared_ptr<AeroUpperController > controller_upper_;
+  std::shared_ptr<AeroLowerController > controller_lower_;
+  int upper_index_;
+  int lower_index_;
 
   bool initialized_flag_;
-  bool upper_send_enable_;
 
   int   CONTROL_PERIOD_US_;
   float OVERLAP_SCALE_;
+  bool  POLL_STATUS_;
   int   BASE_COMMAND_PERIOD_MS_;
 
   ros::Publisher voltage_pub_;
+  ros::Publisher diagnostics_pub_;
+  // bus counters of each board at last publishDiagnostics
+  std::vector<SEEDBusStats> last_bus_stats_;
 
   std::mutex mutex_lower_;
   std::mutex mutex_upper_;
@@ -20,6 +20,7 @@ AeroUpperController::AeroUpperController(const std::string& _port) :
   get_command(CMD_GET_POS, stroke_cur_vector_);
   stroke_ref_vector_.assign(stroke_cur_vector_.begin(),
                             stroke_cur_vector_.end());
+  publish_strokes_(false);
 }
 
 //////////////////////////////////////////////////
@@ -93,6 +94,7 @@ AeroLowerController::AeroLowerController(const std::string& _port) :
   get_command(CMD_GET_POS, stroke_cur_vector_);
   stroke_ref_vector_.assign(stroke_cur_vector_.begin(),
                             stroke_cur_vector_.end());
+  publish_strokes_(false);
 }
 
 //////////////////////////////////////////////////
@@ -128,6 +130,8 @@ void AeroLowerController::wheel_only_off()
 void AeroLowerController::servo_command(int16_t _d0, int16_t _d1)
 {
   boost::mutex::scoped_lock lock(ctrl_mtx_);
+  // for restore_ after reconnect, wheels stay off
+  if (_d0 != 0x7fff) servo_state_ = _d0;
 
   std::vector<int16_t> stroke_vector(stroke_joint_indices_.size(), _d0);
   std::vector<uint8_t> dat(RAW_DATA_LENGTH);
@@ -156,13 +160,13 @@ void AeroLowerController::set_wheel_velocity(
     encode_short_(_wheel_vector[aji.stroke_index],
                   &dat[RAW_HEADER_OFFSET + aji.raw_index * 2]);
   }
-  seed_.send_command(CMD_MOVE_SPD, _time, dat);
-
   // MoveAbs returns current stroke
   // MOVE_SPD also returns data, it is different behavior from Aero Command List ???
-  std::vector<uint8_t> dummy;
-  dummy.resize(RAW_DATA_LENGTH);
-  seed_.read(dummy);
+  std::shared_ptr<std::promise<void> > done(new std::promise<void>());
+  std::future<void> replied = done->get_future();
+  seed_.send_command(CMD_MOVE_SPD, 0x00, _time, dat,
+                     [done](const SEEDFrame*) { done->set_value(); });
+  replied.wait();
 }
 
 //////////////////////////////////////////////////
@@ -3,35 +3,36 @@ namespace aero
   namespace common
   {
 
-    float TableTemplate (float _angle)
+    static inline float TableTemplate (float _angle)
     {
-      int roundedAngle = static_cast<int>(_angle);
-      if (_angle > roundedAngle + 0.001) ++roundedAngle;
-      int roundedAngleIndex = roundedAngle - ArrayTableTemplateOffset;
-      auto ref = TableTemplateMap.at(roundedAngleIndex);
-      float stroke = ref.first;
-      float interval = ref.second;
-
-      return stroke - (roundedAngle - _angle) * interval;
+      return A2SLookup(TableTemplateMap.data(), TableTemplateMap.size(),
+                       ArrayTableTemplateOffset, _angle);
     };
 
-    dualJoint TableTemplate (float _angle1, float _angle2)
+    static inline dualJoint TableTemplate (float _angle1, float _angle2)
     {
-      int roundedAngle1 = static_cast<int>(_angle1);
-      if (_angle1 > roundedAngle1 + 0.001) ++roundedAngle1;
+      float stroke1 = A2SLookup(TableTemplateMap1.data(),
+                                TableTemplateMap1.size(),
+                                ArrayTableTemplateOffset1, _angle1);
+      float stroke2 = A2SLookup(TableTemplateMap2.data(),
+                                TableTemplateMap2.size(),
+                                ArrayTableTemplateOffset2, _angle2);
 
-      int roundedAngle2 = static_cast<int>(_angle2);
-      if (_angle2 > roundedAngle2 + 0.001) ++roundedAngle2;
+      return {stroke2 + stroke1, stroke2 - stroke1} ;
+    };
 
-      int roundedAngleIndex1 = roundedAngle1 - ArrayTableTemplateOffset1;
-      int roundedAngleIndex2 = roundedAngle2 - ArrayTableTemplateOffset2;
-      auto ref1 = TableTemplateMap1.at(roundedAngleIndex1);
-      auto ref2 = TableTemplateMap2.at(roundedAngleIndex2);
-      float stroke1 = ref1.first, stroke2 = ref2.first;
-      float interval1 = ref1.second, interval2 = ref2.second;
+    static inline ConversionJet TableTemplate (ConversionJet _angle)
+    {
+      return SplineJet(TableTemplateSpline.data(), TableTemplateSpline.size(),
+                       _angle);
+    };
 
-      stroke1 -= (roundedAngle1 - _angle1) * interval1;
-      stroke2 -= (roundedAngle2 - _angle2) * interval2;
+    static inline dualJointJet TableTemplate (ConversionJet _angle1, ConversionJet _angle2)
+    {
+      ConversionJet stroke1 = SplineJet(TableTemplateSpline1.data(),
+                                        TableTemplateSpline1.size(), _angle1);
+      ConversionJet stroke2 = SplineJet(TableTemplateSpline2.data(),
+                                        TableTemplateSpline2.size(), _angle2);
 
       return {stroke2 + stroke1, stroke2 - stroke1} ;
     };
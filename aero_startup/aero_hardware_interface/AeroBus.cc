@@ -0,0 +1,236 @@
+#include "aero_hardware_interface/AeroBus.hh"
+
+using namespace aero;
+using namespace controller;
+
+//////////////////////////////////////////////////
+AeroBoardController::AeroBoardController(const std::string& _port,
+                                         uint8_t _id) :
+  AeroControllerProto(_port, _id)
+{
+}
+
+//////////////////////////////////////////////////
+AeroBus::AeroBus()
+{
+}
+
+//////////////////////////////////////////////////
+AeroBus::~AeroBus()
+{
+  close();
+}
+
+//////////////////////////////////////////////////
+std::vector<AeroBoardConfig> AeroBus::default_config(
+    const std::string& _port_upper, const std::string& _port_lower)
+{
+  std::vector<AeroBoardConfig> config(2);
+  config[0].name = "upper";
+  config[0].port = _port_upper;
+  config[1].name = "lower";
+  config[1].port = _port_lower;
+  return config;
+}
+
+//////////////////////////////////////////////////
+bool AeroBus::open(const std::vector<AeroBoardConfig>& _config)
+{
+  close();
+
+  // each whole body stroke is sent by one board only
+  std::vector<bool> used(AERO_DOF, false);
+
+  for (size_t b = 0; b < _config.size(); ++b) {
+    const AeroBoardConfig& config = _config[b];
+    std::shared_ptr<AeroControllerProto> board;
+    size_t offset = 0;
+
+    if (config.name == "upper") {
+      board.reset(new AeroUpperController(config.port));
+    } else if (config.name == "lower") {
+      board.reset(new AeroLowerController(config.port));
+      offset = AERO_DOF_UPPER;
+    } else if (config.joints.empty() || config.id == 0) {
+      std::cerr << "Bus: ERROR: board " << config.name
+                << " needs id and joints" << std::endl;
+      close();
+      return false;
+    } else {
+      board.reset(new AeroBoardController(config.port, config.id));
+    }
+
+    std::vector<size_t> strokes;
+    if (config.joints.empty()) {
+      for (int i = 0; i < board->get_number_of_strokes(); ++i)
+        strokes.push_back(offset + i);
+    } else {
+      std::vector<AJointIndex> indices;
+      uint8_t id = config.id != 0 ? config.id :
+        (config.name == "lower" ? ID_LOWER : ID_UPPER);
+      for (size_t i = 0; i < config.joints.size(); ++i) {
+        const AeroBoardJoint& joint = config.joints[i];
+        if (joint.raw >= AERO_BOARD_MAX_STROKES) {
+          std::cerr << "Bus: ERROR: raw index of " << joint.name
+                    << " out of frame" << std::endl;
+          close();
+          return false;
+        }
+        indices.push_back(AJointIndex(id, i, joint.raw, joint.name));
+        strokes.push_back(joint.stroke);
+      }
+      board->set_stroke_joint_indices(indices);
+    }
+
+    for (size_t i = 0; i < strokes.size(); ++i) {
+      if (strokes[i] >= AERO_DOF || used[strokes[i]]) {
+        std::cerr << "Bus: ERROR: stroke " << strokes[i] << " of board "
+                  << config.name << " out of range or used twice" << std::endl;
+        close();
+        return false;
+      }
+      used[strokes[i]] = true;
+    }
+
+    if (config.capture != "" && !board->start_capture(config.capture))
+      std::cerr << "Bus: ERROR: could not capture " << config.name << std::endl;
+
+    names_.push_back(config.name);
+    boards_.push_back(board);
+    workers_.push_back(std::shared_ptr<AeroBusWorker>(
+        new AeroBusWorker(board.get())));
+    cpus_.push_back(config.cpu);
+    enabled_.push_back(true);
+    strokes_.push_back(strokes);
+    board_strokes_.push_back(std::vector<int16_t>(strokes.size()));
+  }
+
+  return true;
+}
+
+//////////////////////////////////////////////////
+void AeroBus::close()
+{
+  // workers use boards
+  workers_.clear();
+  boards_.clear();
+  names_.clear();
+  cpus_.clear();
+  enabled_.clear();
+  strokes_.clear();
+  board_strokes_.clear();
+}
+
+//////////////////////////////////////////////////
+int AeroBus::find(const std::string& _name)
+{
+  for (size_t b = 0; b < names_.size(); ++b)
+    if (names_[b] == _name) return static_cast<int>(b);
+  return -1;
+}
+
+//////////////////////////////////////////////////
+bool AeroBus::set_scheduling(int _priority)
+{
+  bool ok = true;
+  for (size_t b = 0; b < workers_.size(); ++b)
+    ok = workers_[b]->set_scheduling(cpus_[b], _priority) && ok;
+  return ok;
+}
+
+//////////////////////////////////////////////////
+void AeroBus::set_telemetry(double _budget, double _period)
+{
+  for (size_t b = 0; b < workers_.size(); ++b)
+    workers_[b]->set_telemetry(_budget, _period);
+}
+
+//////////////////////////////////////////////////
+void AeroBus::set_enabled(size_t _board, bool _enabled)
+{
+  enabled_[_board] = _enabled;
+}
+
+//////////////////////////////////////////////////
+bool AeroBus::set_position(const std::vector<int16_t>& _stroke_vector,
+                           uint16_t _time, bool _poll_status)
+{
+  for (size_t b = 0; b < boards_.size(); ++b) {
+    std::vector<int16_t>& strokes = board_strokes_[b];
+    for (size_t i = 0; i < strokes.size(); ++i)
+      strokes[i] = _stroke_vector[strokes_[b][i]];
+    workers_[b]->post_set_position(strokes, _time, _poll_status);
+  }
+
+  bool ok = true;
+  for (size_t b = 0; b < workers_.size(); ++b)
+    ok = workers_[b]->wait() && ok;
+  return ok;
+}
+
+//////////////////////////////////////////////////
+bool AeroBus::update_position()
+{
+  for (size_t b = 0; b < workers_.size(); ++b)
+    if (enabled_[b]) workers_[b]->post_update_position();
+
+  bool ok = true;
+  for (size_t b = 0; b < workers_.size(); ++b)
+    if (enabled_[b]) ok = workers_[b]->wait() && ok;
+  return ok;
+}
+
+//////////////////////////////////////////////////
+void AeroBus::get_actual_stroke_vector(std::vector<int16_t>& _stroke_vector)
+{
+  gather_(true, _stroke_vector, NULL);
+}
+
+//////////////////////////////////////////////////
+void AeroBus::get_actual_stroke_vector(std::vector<int16_t>& _stroke_vector,
+                                       std::vector<int64_t>& _stamps)
+{
+  gather_(true, _stroke_vector, &_stamps);
+}
+
+//////////////////////////////////////////////////
+void AeroBus::get_reference_stroke_vector(std::vector<int16_t>& _stroke_vector)
+{
+  gather_(false, _stroke_vector, NULL);
+}
+
+//////////////////////////////////////////////////
+int64_t AeroBus::get_current_vector(std::vector<int16_t>& _current_vector)
+{
+  _current_vector.assign(AERO_DOF, 0);
+  int64_t stamp = 0;
+  for (size_t b = 0; b < workers_.size(); ++b) {
+    AeroTelemetry telemetry = workers_[b]->telemetry();
+    if (telemetry.current_stamp == 0) continue;
+    size_t n = std::min(telemetry.size, strokes_[b].size());
+    for (size_t i = 0; i < n; ++i)
+      _current_vector[strokes_[b][i]] = telemetry.current[i];
+    stamp = std::max(stamp, telemetry.current_stamp);
+  }
+  return stamp;
+}
+
+//////////////////////////////////////////////////
+void AeroBus::gather_(bool _actual, std::vector<int16_t>& _stroke_vector,
+                      std::vector<int64_t>* _stamps)
+{
+  // capacity stays, no allocation after first call
+  _stroke_vector.assign(AERO_DOF, 0);
+  if (_stamps) _stamps->assign(AERO_DOF, 0);
+  AeroStrokeSnapshot strokes;
+  for (size_t b = 0; b < boards_.size(); ++b) {
+    boards_[b]->get_stroke_snapshot(strokes);
+    const int16_t* values = _actual ? strokes.actual : strokes.reference;
+    // empty when port is not open
+    size_t n = std::min(strokes.size, strokes_[b].size());
+    for (size_t i = 0; i < n; ++i) {
+      _stroke_vector[strokes_[b][i]] = values[i];
+      if (_stamps) (*_stamps)[strokes_[b][i]] = strokes.actual_stamp;
+    }
+  }
+}
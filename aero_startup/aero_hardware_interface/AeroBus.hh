@@ -0,0 +1,162 @@
+#ifndef AERO_CONTROLLER_AERO_BUS_H_
+#define AERO_CONTROLLER_AERO_BUS_H_
+
+#include <vector>
+#include <string>
+#include <memory>
+#include <stdint.h>
+
+#include "aero_hardware_interface/AeroControllers.hh"
+#include "aero_hardware_interface/AeroBusWorker.hh"
+
+namespace aero
+{
+  namespace controller
+  {
+    // strokes in one 68 bytes frame
+    const static size_t AERO_BOARD_MAX_STROKES = RAW_AXES;
+
+    /// @brief joint of a board given by config
+    struct AeroBoardJoint
+    {
+      std::string name;
+
+      /// @brief index in whole body stroke vector (Angle2Stroke)
+      size_t stroke;
+
+      /// @brief index in raw data of board
+      size_t raw;
+    };
+
+    /// @brief one SEED board and its port
+    struct AeroBoardConfig
+    {
+      AeroBoardConfig() : id(0), cpu(-1)
+      {
+      }
+
+      /// @brief "upper" and "lower" are AeroUpperController and
+      ///   AeroLowerController with generated joint tables,
+      ///   other names are AeroBoardController
+      std::string name;
+
+      std::string port;
+
+      /// @brief CAN bus ID, 0 for ID_UPPER / ID_LOWER
+      uint8_t id;
+
+      /// @brief joint table, replaces generated one if not empty
+      std::vector<AeroBoardJoint> joints;
+
+      /// @brief capture file of bus traffic, empty for none
+      std::string capture;
+
+      /// @brief cpu of worker and io thread, -1 to keep current affinity
+      int cpu;
+    };
+
+    /// @brief board without generated code, joint table from config
+    class AeroBoardController : public AeroControllerProto
+    {
+     public: AeroBoardController(const std::string& _port, uint8_t _id);
+    };
+
+    /// @brief all SEED boards of the robot
+    ///
+    /// Each board has its own port, joint table and AeroBusWorker.
+    /// Whole body stroke vectors (Angle2Stroke, Stroke2Angle) are split
+    /// to boards and commands are posted to all workers before waiting,
+    /// so a cycle takes as long as the slowest bus.
+    class AeroBus
+    {
+     public: AeroBus();
+
+     public: ~AeroBus();
+
+      /// @brief upper and lower boards with generated joint tables
+     public: static std::vector<AeroBoardConfig> default_config(
+         const std::string& _port_upper, const std::string& _port_lower);
+
+      /// @brief create boards and workers, previous ones are closed
+      /// @return false if a joint table is invalid
+     public: bool open(const std::vector<AeroBoardConfig>& _config);
+
+     public: void close();
+
+     public: size_t size() {return boards_.size();}
+
+     public: const std::string& name(size_t _board) {return names_[_board];}
+
+      /// @return index of board, -1 if not found
+     public: int find(const std::string& _name);
+
+     public: std::shared_ptr<AeroControllerProto> board(size_t _board)
+      {return boards_[_board];}
+
+     public: std::shared_ptr<AeroBusWorker> worker(size_t _board)
+      {return workers_[_board];}
+
+      /// @brief set priority of all boards, cpu is taken from config
+      /// @return false if not permitted
+     public: bool set_scheduling(int _priority);
+
+      /// @brief enable telemetry of all boards, see AeroBusWorker
+     public: void set_telemetry(double _budget, double _period);
+
+      /// @brief board is read by update_position only if enabled
+     public: void set_enabled(size_t _board, bool _enabled);
+
+      /// @brief send whole body strokes to all boards
+      /// @param _stroke_vector AERO_DOF strokes
+      /// @param _time time[csec]
+      /// @param _poll_status also poll status in the same bus cycle
+      /// @return false if a board did not reply
+     public: bool set_position(const std::vector<int16_t>& _stroke_vector,
+                               uint16_t _time, bool _poll_status=false);
+
+      /// @brief read positions of enabled boards
+      /// @return false if a board did not reply
+     public: bool update_position();
+
+      /// @brief whole body strokes read by last update_position,
+      ///   strokes of no board are 0, never blocks
+      /// @param _stroke_vector resized to AERO_DOF
+     public: void get_actual_stroke_vector(std::vector<int16_t>& _stroke_vector);
+
+      /// @brief get_actual_stroke_vector with time of reading
+      /// @param _stamps resized to AERO_DOF, steady clock time[ns]
+      ///   of board of each stroke, 0 if never read
+     public: void get_actual_stroke_vector(std::vector<int16_t>& _stroke_vector,
+                                           std::vector<int64_t>& _stamps);
+
+     public: void get_reference_stroke_vector(
+         std::vector<int16_t>& _stroke_vector);
+
+      /// @brief latest currents of telemetry of all boards, never blocks
+      /// @param _current_vector resized to AERO_DOF, 0 for no telemetry
+      /// @return time of newest current[ns], 0 if none
+     public: int64_t get_current_vector(std::vector<int16_t>& _current_vector);
+
+     private: void gather_(bool _actual, std::vector<int16_t>& _stroke_vector,
+                           std::vector<int64_t>* _stamps);
+
+     private: std::vector<std::string> names_;
+
+     private: std::vector<std::shared_ptr<AeroControllerProto> > boards_;
+
+     private: std::vector<std::shared_ptr<AeroBusWorker> > workers_;
+
+     private: std::vector<int> cpus_;
+
+     private: std::vector<bool> enabled_;
+
+      /// @brief whole body stroke index of each stroke of each board
+     private: std::vector<std::vector<size_t> > strokes_;
+
+      /// @brief board strokes of set_position, allocated at open
+     private: std::vector<std::vector<int16_t> > board_strokes_;
+    };
+  }
+}
+
+#endif
@@ -0,0 +1,84 @@
+#ifndef AERO_CONTROLLER_AERO_BUS_CONFIG_H_
+#define AERO_CONTROLLER_AERO_BUS_CONFIG_H_
+
+#include <string>
+#include <vector>
+
+#include <ros/ros.h>
+#include <XmlRpcValue.h>
+
+#include "aero_hardware_interface/AeroBus.hh"
+
+namespace aero
+{
+  namespace controller
+  {
+    /// @brief read board list from parameter
+    ///
+    /// boards:
+    ///   - {name: upper, port: /dev/aero_upper, cpu: 2}
+    ///   - {name: lower, port: /dev/aero_lower, capture: /tmp/lower.bin}
+    ///   - name: hands
+    ///     port: /dev/aero_hands
+    ///     id: 3
+    ///     joints:
+    ///       - {name: r_hand, stroke: 10, raw: 11}
+    ///
+    /// @param _nh node handle
+    /// @param _param parameter name
+    /// @param _config boards, not changed if parameter is not set
+    /// @return false if parameter is set but malformed or out of range
+    inline bool load_board_config(const ros::NodeHandle& _nh,
+                                  const std::string& _param,
+                                  std::vector<AeroBoardConfig>& _config)
+    {
+      XmlRpc::XmlRpcValue list;
+      if (!_nh.getParam(_param, list)) return true;
+
+      try {
+        if (list.getType() != XmlRpc::XmlRpcValue::TypeArray)
+          throw XmlRpc::XmlRpcException(_param + " is not a list");
+
+        std::vector<AeroBoardConfig> config(list.size());
+        for (int b = 0; b < list.size(); ++b) {
+          XmlRpc::XmlRpcValue& board = list[b];
+          config[b].name = static_cast<std::string>(board["name"]);
+          config[b].port = static_cast<std::string>(board["port"]);
+          if (board.hasMember("id")) {
+            int id = static_cast<int>(board["id"]);
+            if (id < 0 || id > 0xff)
+              throw XmlRpc::XmlRpcException(
+                  "id of " + config[b].name + " out of range");
+            config[b].id = static_cast<uint8_t>(id);
+          }
+          if (board.hasMember("cpu"))
+            config[b].cpu = static_cast<int>(board["cpu"]);
+          if (board.hasMember("capture"))
+            config[b].capture = static_cast<std::string>(board["capture"]);
+          if (!board.hasMember("joints")) continue;
+
+          XmlRpc::XmlRpcValue& joints = board["joints"];
+          for (int j = 0; j < joints.size(); ++j) {
+            AeroBoardJoint joint;
+            joint.name = static_cast<std::string>(joints[j]["name"]);
+            int stroke = static_cast<int>(joints[j]["stroke"]);
+            int raw = static_cast<int>(joints[j]["raw"]);
+            if (stroke < 0 || raw < 0)
+              throw XmlRpc::XmlRpcException(
+                  "stroke or raw of " + joint.name + " out of range");
+            joint.stroke = stroke;
+            joint.raw = raw;
+            config[b].joints.push_back(joint);
+          }
+        }
+        _config.swap(config);
+      } catch (XmlRpc::XmlRpcException& e) {
+        ROS_ERROR("malformed %s: %s", _param.c_str(), e.getMessage().c_str());
+        return false;
+      }
+      return true;
+    }
+  }
+}
+
+#endif
@@ -0,0 +1,289 @@
+#include "aero_hardware_interface/AeroBusWorker.hh"
+
+#include <cerrno>
+#include <ctime>
+
+using namespace aero;
+using namespace controller;
+
+//////////////////////////////////////////////////
+static int64_t steady_ns(AeroBusWorker::bus_clock::time_point _time)
+{
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+      _time.time_since_epoch()).count();
+}
+
+//////////////////////////////////////////////////
+static void sem_wait_retry(sem_t* _sem)
+{
+  while (sem_wait(_sem) != 0 && errno == EINTR);
+}
+
+//////////////////////////////////////////////////
+AeroBusWorker::AeroBusWorker(AeroControllerProto* _controller) :
+  controller_(_controller), outstanding_(0), running_(true), failed_(false),
+  telemetry_budget_(0.0), period_(0), last_position_(0),
+  telemetry_reset_(false), allowance_(0.0), query_cost_(0.002),
+  next_query_(0), telemetry_preempted_(false), telemetry_voltage_(0.0f)
+{
+  sem_init(&wake_, 0, 0);
+  sem_init(&done_, 0, 0);
+  stroke_vector_.reserve(RAW_AXES);
+  telemetry_vector_.reserve(controller_->get_number_of_strokes());
+  thread_ = boost::thread(&AeroBusWorker::run_, this);
+}
+
+//////////////////////////////////////////////////
+AeroBusWorker::~AeroBusWorker()
+{
+  // posted commands are finished before worker stops
+  running_ = false;
+  sem_post(&wake_);
+  thread_.join();
+  sem_destroy(&wake_);
+  sem_destroy(&done_);
+}
+
+//////////////////////////////////////////////////
+bool AeroBusWorker::set_scheduling(int _cpu, int _priority)
+{
+  bool ok = set_thread_scheduling(thread_.native_handle(), _cpu, _priority);
+  return controller_->set_io_scheduling(_cpu, _priority) && ok;
+}
+
+//////////////////////////////////////////////////
+void AeroBusWorker::post_update_position()
+{
+  Slot* slot = prepare_();
+  slot->command = UPDATE_POSITION;
+  stamp_position_();
+  commit_();
+}
+
+//////////////////////////////////////////////////
+void AeroBusWorker::post_set_position(
+    const std::vector<int16_t>& _stroke_vector, uint16_t _time,
+    bool _poll_status)
+{
+  Slot* slot = prepare_();
+  slot->command = SET_POSITION;
+  slot->size = std::min(_stroke_vector.size(), RAW_AXES);
+  std::copy(_stroke_vector.begin(), _stroke_vector.begin() + slot->size,
+            slot->strokes);
+  slot->time = _time;
+  slot->poll_status = _poll_status;
+  stamp_position_();
+  commit_();
+}
+
+//////////////////////////////////////////////////
+void AeroBusWorker::stamp_position_()
+{
+  last_position_.store(steady_ns(bus_clock::now()), std::memory_order_relaxed);
+}
+
+//////////////////////////////////////////////////
+bool AeroBusWorker::wait()
+{
+  while (outstanding_ > 0) {
+    sem_wait_retry(&done_);
+    --outstanding_;
+  }
+  return !failed_.exchange(false);
+}
+
+//////////////////////////////////////////////////
+void AeroBusWorker::set_telemetry(double _budget, double _period)
+{
+  telemetry_budget_ = std::max(0.0, std::min(_budget, 1.0));
+  period_ = static_cast<int64_t>(_period * 1e9);
+  telemetry_reset_ = true;
+  sem_post(&wake_);
+}
+
+//////////////////////////////////////////////////
+AeroBusWorker::Slot* AeroBusWorker::prepare_()
+{
+  Slot* slot;
+  while ((slot = commands_.prepare()) == NULL) {
+    // ring is full, oldest command is finished first
+    sem_wait_retry(&done_);
+    --outstanding_;
+  }
+  return slot;
+}
+
+//////////////////////////////////////////////////
+void AeroBusWorker::commit_()
+{
+  commands_.commit();
+  ++outstanding_;
+  sem_post(&wake_);
+}
+
+//////////////////////////////////////////////////
+void AeroBusWorker::run_()
+{
+  // touch stack now, page faults are not taken in a bus cycle
+  volatile uint8_t stack[64 * 1024];
+  for (size_t i = 0; i < sizeof(stack); i += 4096) stack[i] = 0;
+
+  while (true) {
+    Slot* slot = commands_.front();
+    if (!slot) {
+      if (!running_) {
+        // reply writes into telemetry_vector_, wait for it or timeout
+        collect_telemetry_(true);
+        break;
+      }
+
+      if (telemetry_reset_.exchange(false)) {
+        allowance_ = 0.0;
+        last_refill_ = bus_clock::now();
+      }
+
+      collect_telemetry_(false);
+      if (telemetry_budget_ <= 0.0 && !telemetry_pending_.valid()) {
+        sem_wait_retry(&wake_);
+      } else if (!telemetry_pending_.valid()
+                 && telemetry_due_(bus_clock::now())) {
+        query_telemetry_();
+      } else {
+        // check again when reply comes or more budget is earned,
+        // a posted command wakes up at once
+        struct timespec until;
+        clock_gettime(CLOCK_REALTIME, &until);
+        until.tv_nsec += telemetry_pending_.valid() ? 500000 : 5000000;
+        if (until.tv_nsec >= 1000000000) {
+          until.tv_nsec -= 1000000000;
+          ++until.tv_sec;
+        }
+        sem_timedwait(&wake_, &until);
+      }
+      continue;
+    }
+
+    if (telemetry_pending_.valid()) telemetry_preempted_ = true;
+
+    bool result = true;
+    switch (slot->command) {
+    case UPDATE_POSITION:
+      result = controller_->update_position();
+      break;
+    case SET_POSITION:
+      {
+        // capacity is reserved, no allocation
+        stroke_vector_.assign(slot->strokes, slot->strokes + slot->size);
+        // status poll is pipelined behind position command
+        std::shared_future<bool> pos =
+          controller_->set_position_async(stroke_vector_, slot->time);
+        if (slot->poll_status)
+          result = controller_->update_status_async().get();
+        result = pos.get() && result;
+      }
+      break;
+    default:
+      break;
+    }
+
+    commands_.pop();
+    if (!result) failed_ = true;
+    sem_post(&done_);
+  }
+}
+
+//////////////////////////////////////////////////
+bool AeroBusWorker::telemetry_due_(bus_clock::time_point _now)
+{
+  // earn budget for elapsed time, keep at most one query in reserve
+  double elapsed = std::chrono::duration<double>(_now - last_refill_).count();
+  last_refill_ = _now;
+  allowance_ = std::min(allowance_ + telemetry_budget_.load() * elapsed,
+                        2.0 * query_cost_);
+  if (allowance_ < query_cost_) return false;
+
+  // never overlap with next position command
+  bus_clock::duration period(
+      std::chrono::nanoseconds(period_.load(std::memory_order_relaxed)));
+  int64_t last = last_position_.load(std::memory_order_relaxed);
+  if (period > bus_clock::duration::zero() && last != 0) {
+    bus_clock::time_point next =
+      bus_clock::time_point(std::chrono::nanoseconds(last)) + period;
+    while (next < _now) next += period;
+    if (_now + std::chrono::duration_cast<bus_clock::duration>(
+            std::chrono::duration<double>(2.0 * query_cost_)) > next)
+      return false;
+  }
+
+  return true;
+}
+
+//////////////////////////////////////////////////
+void AeroBusWorker::query_telemetry_()
+{
+  telemetry_start_ = bus_clock::now();
+  telemetry_preempted_ = false;
+
+  switch (next_query_) {
+  case 0:
+    telemetry_pending_ = controller_->get_current_async(&telemetry_vector_);
+    break;
+  case 1:
+    telemetry_pending_ =
+      controller_->get_temperature_async(&telemetry_vector_);
+    break;
+  default:
+    telemetry_pending_ = controller_->get_voltage_async(&telemetry_voltage_);
+    break;
+  }
+}
+
+//////////////////////////////////////////////////
+void AeroBusWorker::collect_telemetry_(bool _wait)
+{
+  if (!telemetry_pending_.valid()) return;
+  if (!_wait && telemetry_pending_.wait_for(std::chrono::seconds(0))
+      != std::future_status::ready)
+    return;
+
+  bool ok = telemetry_pending_.get();
+  telemetry_pending_ = std::shared_future<bool>();
+
+  int64_t stamp = steady_ns(telemetry_start_);
+  if (ok) {
+    switch (next_query_) {
+    case 0:
+      telemetry_value_.size =
+        std::min(telemetry_vector_.size(), AERO_TELEMETRY_MAX_STROKES);
+      std::copy(telemetry_vector_.begin(),
+                telemetry_vector_.begin() + telemetry_value_.size,
+                telemetry_value_.current);
+      telemetry_value_.current_stamp = stamp;
+      break;
+    case 1:
+      telemetry_value_.size =
+        std::min(telemetry_vector_.size(), AERO_TELEMETRY_MAX_STROKES);
+      std::copy(telemetry_vector_.begin(),
+                telemetry_vector_.begin() + telemetry_value_.size,
+                telemetry_value_.temperature);
+      telemetry_value_.temperature_stamp = stamp;
+      break;
+    default:
+      telemetry_value_.voltage = telemetry_voltage_;
+      telemetry_value_.voltage_stamp = stamp;
+      break;
+    }
+    telemetry_.store(telemetry_value_);
+  }
+  next_query_ = (next_query_ + 1) % 3;
+
+  // reply is noticed within the poll interval, when a position command
+  // ran meanwhile the elapsed time is not the query's, charge the estimate
+  double cost = query_cost_;
+  if (!telemetry_preempted_) {
+    cost = std::chrono::duration<double>(
+        bus_clock::now() - telemetry_start_).count();
+    query_cost_ = 0.8 * query_cost_ + 0.2 * cost;
+  }
+  allowance_ -= cost;
+}
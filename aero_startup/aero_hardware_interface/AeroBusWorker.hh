@@ -0,0 +1,188 @@
+#ifndef AERO_CONTROLLER_AERO_BUS_WORKER_H_
+#define AERO_CONTROLLER_AERO_BUS_WORKER_H_
+
+#include <vector>
+#include <string>
+#include <chrono>
+#include <atomic>
+#include <future>
+#include <stdint.h>
+#include <semaphore.h>
+
+#include <boost/thread.hpp>
+
+#include "aero_hardware_interface/AeroControllerProto.hh"
+#include "aero_hardware_interface/AeroTelemetry.hh"
+#include "aero_hardware_interface/SPSCRing.hh"
+
+namespace aero
+{
+  namespace controller
+  {
+    // commands posted before wait()
+    const static size_t AERO_BUS_QUEUE = 4;
+
+    /// @brief long-lived thread sending commands to one SEED board
+    ///
+    /// The control thread posts commands into a preallocated single
+    /// producer ring and collects their results with wait(),
+    /// no thread is created and no mutex is taken per cycle.
+    /// Only one thread may post and wait.
+    ///
+    /// When telemetry is enabled, current, temperature and voltage
+    /// are queried while the worker is idle, only if the query fits
+    /// before the next expected position command and within the budget.
+    /// The worker does not wait for the telemetry reply, a position
+    /// command posted meanwhile is sent at once in the position lane,
+    /// ahead of the telemetry lane, and the reply is collected later.
+    class AeroBusWorker
+    {
+     public: typedef std::chrono::steady_clock bus_clock;
+
+      /// @brief kind of command in slot
+     public: enum Command {
+        NONE,
+        UPDATE_POSITION,
+        SET_POSITION
+      };
+
+      /// @brief command in ring
+     public: struct Slot
+      {
+        Command command;
+
+        size_t size;
+
+        int16_t strokes[RAW_AXES];
+
+        uint16_t time;
+
+        bool poll_status;
+      };
+
+      /// @brief constructor
+      /// @param _controller controller of the board, must outlive worker
+     public: explicit AeroBusWorker(AeroControllerProto* _controller);
+
+      /// @brief destructor, waits for the running command
+     public: ~AeroBusWorker();
+
+      /// @brief pin worker and io thread of board to a cpu
+      ///   and set their priority
+      /// @param _cpu cpu index, -1 to keep current affinity
+      /// @param _priority SCHED_FIFO priority, 0 to keep current policy
+      /// @return false if not permitted
+     public: bool set_scheduling(int _cpu, int _priority);
+
+      /// @brief post update_position, waits only if ring is full
+     public: void post_update_position();
+
+      /// @brief post set_position, waits only if ring is full
+      /// @param _stroke_vector stroke vector, copied into slot
+      /// @param _time time[ms]
+      /// @param _poll_status also poll status in the same bus cycle
+     public: void post_set_position(const std::vector<int16_t>& _stroke_vector,
+                                    uint16_t _time, bool _poll_status=false);
+
+      /// @brief wait for all posted commands
+      /// @return false if a reply timed out
+     public: bool wait();
+
+      /// @brief enable telemetry queries in idle bus time
+      /// @param _budget max fraction of time spent on telemetry, 0 to disable
+      /// @param _period expected time between position commands[s],
+      ///   0 if not periodic
+     public: void set_telemetry(double _budget, double _period);
+
+      /// @brief latest telemetry, never blocks
+     public: AeroTelemetry telemetry() const {return telemetry_.load();}
+
+     private: void run_();
+
+      /// @brief free slot, waits for posted commands if ring is full
+     private: Slot* prepare_();
+
+      /// @brief hand prepared slot to worker
+     private: void commit_();
+
+      /// @brief true if a telemetry query can be sent now, worker only
+     private: bool telemetry_due_(bus_clock::time_point _now);
+
+      /// @brief send next telemetry query without waiting reply
+     private: void query_telemetry_();
+
+      /// @brief publish reply of telemetry query if it has come
+      /// @param _wait wait for reply or timeout
+     private: void collect_telemetry_(bool _wait);
+
+      /// @brief time of position command for telemetry_due_
+     private: void stamp_position_();
+
+     private: AeroControllerProto* controller_;
+
+     private: boost::thread thread_;
+
+     private: SPSCRing<Slot, AERO_BUS_QUEUE> commands_;
+
+      /// @brief posted for each command, stop and telemetry change
+     private: sem_t wake_;
+
+      /// @brief posted for each finished command
+     private: sem_t done_;
+
+      /// @brief commands not collected by wait(), control thread only
+     private: size_t outstanding_;
+
+     private: std::atomic<bool> running_;
+
+      /// @brief a command failed since last wait()
+     private: std::atomic<bool> failed_;
+
+     private: std::atomic<double> telemetry_budget_;
+
+      /// @brief expected time between position commands[ns]
+     private: std::atomic<int64_t> period_;
+
+      /// @brief steady clock time of last position command[ns], 0 if none,
+      ///   set by update_position and set_position
+     private: std::atomic<int64_t> last_position_;
+
+      /// @brief allowance is restarted by worker
+     private: std::atomic<bool> telemetry_reset_;
+
+      /// @brief stroke vector of running command, worker only
+     private: std::vector<int16_t> stroke_vector_;
+
+      /// @brief telemetry time earned by budget[s]
+     private: double allowance_;
+
+     private: bus_clock::time_point last_refill_;
+
+      /// @brief expected duration of a telemetry query[s]
+     private: double query_cost_;
+
+      /// @brief next query, current -> temperature -> voltage
+     private: int next_query_;
+
+      /// @brief reply of query sent by query_telemetry_, invalid if none
+     private: std::shared_future<bool> telemetry_pending_;
+
+     private: bus_clock::time_point telemetry_start_;
+
+      /// @brief a position command ran while query was pending,
+      ///   its time is not the cost of the query
+     private: bool telemetry_preempted_;
+
+     private: std::vector<int16_t> telemetry_vector_;
+
+     private: float telemetry_voltage_;
+
+      /// @brief written by worker thread only
+     private: AeroTelemetry telemetry_value_;
+
+     private: SeqLockSnapshot<AeroTelemetry> telemetry_;
+    };
+  }
+}
+
+#endif
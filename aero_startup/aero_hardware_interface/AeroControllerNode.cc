@@ -7,12 +7,72 @@ using namespace controller;
 AeroControllerNode::AeroControllerNode(const ros::NodeHandle& _nh,
                                        const std::string& _port_upper,
                                        const std::string& _port_lower) :
-  nh_(_nh), upper_(_port_upper), lower_(_port_lower), wheel_spinner_(1, &wheel_queue_),
+  nh_(_nh), wheel_spinner_(1, &wheel_queue_),
   jointtraj_spinner_(1, &jointtraj_queue_),
   speed_overwrite_spinner_(1, &speed_overwrite_queue_)
 {
   ROS_INFO("starting aero_hardware_interface");
 
+  // boards, upper and lower on the given ports by default
+  // record bus traffic for seed_replay, empty for no capture
+  std::vector<AeroBoardConfig> boards =
+    AeroBus::default_config(_port_upper, _port_lower);
+  nh_.param<std::string>("capture_upper", boards[0].capture, "");
+  nh_.param<std::string>("capture_lower", boards[1].capture, "");
+  if (!load_board_config(nh_, "boards", boards))
+    throw std::runtime_error("invalid ~boards");
+  // trajectories and services split whole body strokes at AERO_DOF_UPPER,
+  // other boards and joint tables need aero_ros_controller,
+  // commands are sent from this node's threads, not by AeroBus workers
+  for (size_t b = 0; b < boards.size(); ++b) {
+    const AeroBoardConfig& board = boards[b];
+    if ((board.name != "upper" && board.name != "lower")
+        || !board.joints.empty())
+      throw std::runtime_error("AeroControllerNode runs upper and lower "
+                               "boards without joint tables only, not "
+                               + board.name);
+    ROS_INFO("%s_port: %s", board.name.c_str(), board.port.c_str());
+    std::shared_ptr<AeroControllerProto> controller;
+    if (board.name == "upper") {
+      if (upper_) throw std::runtime_error("~boards has upper twice");
+      upper_.reset(new AeroUpperController(board.port));
+      controller = upper_;
+    } else {
+      if (lower_) throw std::runtime_error("~boards has lower twice");
+      lower_.reset(new AeroLowerController(board.port));
+      controller = lower_;
+    }
+    if (board.capture != "" && !controller->start_capture(board.capture))
+      ROS_WARN("failed to capture %s", board.name.c_str());
+    if (!controller->set_io_scheduling(board.cpu, 0))
+      ROS_WARN("failed to set cpu affinity of %s io thread",
+               board.name.c_str());
+  }
+  if (!upper_ || !lower_)
+    throw std::runtime_error("~boards must have upper and lower");
+
+  // trajectories are accepted from command callbacks
+  // and run by one executor thread
+  upper_executor_.resize(AERO_DOF_UPPER);
+  lower_executor_.resize(AERO_DOF - AERO_DOF_UPPER);
+  executor_running_ = true;
+  paused_ = false;
+  upper_bus_ns_ = 0;
+  lower_bus_ns_ = 0;
+
+  // default frame period of trajectories[s],
+  // a shorter period is sent to board when any running trajectory uses it
+  double frame_period;
+  nh_.param<double>("frame_period", frame_period, 0.1);
+  frame_period_ = static_cast<float>(frame_period * 100);
+  executor_period_ = frame_period_;
+
+  // velocity of joints taken from running trajectories is blended in[s]
+  double handover_blend;
+  nh_.param<double>("handover_blend", handover_blend, 0.3);
+  upper_executor_.set_blend(static_cast<uint16_t>(handover_blend * 100));
+  lower_executor_.set_blend(static_cast<uint16_t>(handover_blend * 100));
+
   ROS_INFO(" create publisher");
   state_pub_ =
       nh_.advertise<control_msgs::JointTrajectoryControllerState>(
@@ -160,10 +220,16 @@ AeroControllerNode::AeroControllerNode(const ros::NodeHandle& _nh,
     nh_.createTimer(ros::Duration(0.02),
                     &AeroControllerNode::PublishInAction, this);
 
-  global_thread_cnt_ = 0;
+  diagnostics_pub_ =
+    ros::NodeHandle().advertise<diagnostic_msgs::DiagnosticArray>(
+        "diagnostics", 1);
+  diagnostics_timer_ =
+    nh_.createTimer(ros::Duration(1.0),
+                    &AeroControllerNode::PublishDiagnostics, this);
+
   send_joints_status_ = false;
 
-  lower_killed_thread_info_ = {{}, {}, 1, 0, 0, 1.0f};
+  executor_thread_ = std::thread(&AeroControllerNode::ExecutorThread, this);
 
   ROS_INFO(" done");
 }
@@ -171,6 +237,12 @@ AeroControllerNode::AeroControllerNode(const ros::NodeHandle& _nh,
 //////////////////////////////////////////////////
 AeroControllerNode::~AeroControllerNode()
 {
+  mtx_executor_.lock();
+  executor_running_ = false;
+  mtx_executor_.unlock();
+  executor_cv_.notify_one();
+  if (executor_thread_.joinable())
+    executor_thread_.join();
 }
 
 //////////////////////////////////////////////////
@@ -183,262 +255,125 @@ AeroControllerNode::~AeroControllerNode()
 // }
 
 //////////////////////////////////////////////////
-void AeroControllerNode::JointTrajectoryThread(
-    std::vector<aero::interpolation::InterpolationPtr> _interpolation,
-    std::vector<std::pair<std::vector<int16_t>, uint16_t> > _stroke_trajectory,
-    int _trajectory_start_from,
-    int _split_start_from, float _factor)
+void AeroControllerNode::ExecutorThread()
 {
-  ROS_INFO("starting upper joint trajectory thread");
-  auto start_time = aero::time::now();
-
-  uint16_t csec_per_frame = 10; // 10 fps
-  uint this_id;
-
-  // register current thread
-  mtx_threads_.lock();
-  std::vector<int> joints;
-  for (size_t i = 0; i < _stroke_trajectory[0].first.size(); ++i)
-    if (_stroke_trajectory[0].first.at(i) != 0x7fff)
-      joints.push_back(static_cast<int>(i));
-  registered_threads_.push_back({global_thread_cnt_, joints, false});
-  this_id = global_thread_cnt_++;
-  mtx_threads_.unlock();
-
-  // main process starts here
-
-  ROS_INFO("upper joint trajectory thread: starting!");
-
-  for (auto it = _stroke_trajectory.begin() + _trajectory_start_from;
-       it != _stroke_trajectory.end(); ++it) {
-    // check if any kill signal was provided to current thread
-    mtx_threads_.lock();
-    for (auto th = registered_threads_.begin(); th != registered_threads_.end(); ++th)
-      if (th->id == this_id) {
-        if (th->kill) {
-          // save info of killing thread
-          mtx_thread_graveyard_.lock();
-          thread_graveyard_.push_back({_stroke_trajectory, _interpolation,
-                static_cast<int>(it - _stroke_trajectory.begin()), 1, this_id, _factor});
-          mtx_thread_graveyard_.unlock();
-          // remove this thread info
-          registered_threads_.erase(th);
-          mtx_threads_.unlock();
-          ROS_WARN("upper joint trajectory thread: detected kill signal during trajectory!");
-          return;
-        }
-        break;
-      }
-    mtx_threads_.unlock();
+  std::vector<int16_t> upper_strokes;
+  std::vector<int16_t> lower_strokes;
+
+  // frames start at absolute deadlines, so time spent on the bus
+  // or in a late wake up is not added to following frames
+  int64_t deadline = 0;
+  // measured time from waking up to both boards replied[ns]
+  int64_t bus_ns = 0;
+  bool idle = true;
+
+  std::unique_lock<std::mutex> lock(mtx_executor_);
+  while (executor_running_) {
+    if (upper_executor_.size() == 0 && lower_executor_.size() == 0) {
+      paused_ = false; // nothing left to resume
+      idle = true;
+      executor_cv_.wait(lock);
+      continue;
+    }
 
-    // check if any collision happened during send trajectory
-    mtx_upper_.lock();
-    bool collision_status = upper_.get_status();
-    mtx_upper_.unlock();
-    if (collision_status && collision_abort_mode_ != 0) {
-      ROS_ERROR("upper joint trajectory thread: abort trajectory collision!");
-      if (collision_abort_mode_ == 1) {
-        mtx_upper_.lock();
-        upper_.reset_status();
-        mtx_upper_.unlock();
-      }
-      break;
+    int64_t begin = aero::time::steady_ns();
+    if (idle) { // first frame starts now
+      deadline = begin;
+      idle = false;
     }
 
-    int k = static_cast<int>(it - _stroke_trajectory.begin());
-    // from here, main process for trajectory it
-    // any movement faster than 100ms(10cs) will not interpolate = linear
-    if (it->second - (it-1)->second < 10
-        || _interpolation.at(k)->is(aero::interpolation::i_constant)
-        ) {
-      // check if elapsed time should be considered
-      int elapsed_csec = _split_start_from;
-      int runtime_csec;
-      if (elapsed_csec >= csec_per_frame)
-        runtime_csec = std::max(static_cast<int>(csec_per_frame), it->second - (it-1)->second + 5 + 1 - elapsed_csec); // skip elapsed time
-      else
-        runtime_csec = it->second - (it-1)->second + 5 + 1; // 5 csec(50[ms]) is to synchronize upper and lower and 1csec to smoothing trajectory
+    // shortest period of running trajectories,
+    // trajectories with longer period are read between their frames
+    float period = frame_period_;
+    float upper_period = upper_executor_.period();
+    float lower_period = lower_executor_.period();
+    if (upper_period > 0) period = upper_period;
+    if (lower_period > 0 && (upper_period == 0 || lower_period < period))
+      period = lower_period;
+    executor_period_ = period;
+    const int64_t frame_ns = std::llround(period * 1e7);
+
+    // strokes of all running trajectories at end of this frame
+    bool upper = upper_executor_.step(upper_strokes, period);
+    bool lower = lower_executor_.step(lower_strokes, period);
+    lock.unlock();
+
+    // check if any collision happened during send trajectory
+    if (upper && collision_abort_mode_ != 0) {
       mtx_upper_.lock();
-      upper_.set_position(it->first, runtime_csec);
+      // read in safety lane, a polled status may be a frame old
+      bool collision_status = upper_->check_status();
+      if (collision_status && collision_abort_mode_ == 1)
+        upper_->reset_status();
       mtx_upper_.unlock();
-
-      // check for kill every csec_per_frame
-      int runtime_msec = (runtime_csec - 2) * 10;
-      int loops = runtime_msec / static_cast<int32_t>(csec_per_frame * 10);
-      int remain_msec = runtime_msec - loops * static_cast<int32_t>(csec_per_frame * 10);
-      if (loops > 0) {
-        for (int loop_count = 0; loop_count < loops; ++loop_count) {
-          // check if any kill signal was provided to current thread
-          mtx_threads_.lock();
-          for (auto th = registered_threads_.begin();
-               th != registered_threads_.end(); ++th)
-            if (th->id == this_id) {
-              if (th->kill) {
-                // save info of killing thread
-                mtx_thread_graveyard_.lock();
-                thread_graveyard_.push_back({_stroke_trajectory, _interpolation, k, loop_count * csec_per_frame + elapsed_csec, this_id, _factor});
-                mtx_thread_graveyard_.unlock();
-                // remove this thread info
-                registered_threads_.erase(th);
-                mtx_threads_.unlock();
-                ROS_WARN("upper joint trajectory thread: detected kill signal during command!");
-                return;
-              }
-              break;
-            }
-          mtx_threads_.unlock();
-          usleep(static_cast<int32_t>(csec_per_frame) * 10 * 1000);
-        }
+      if (collision_status) {
+        ROS_ERROR("trajectory executor: abort upper trajectories collision!");
+        lock.lock();
+        upper_executor_.clear();
+        lock.unlock();
+        upper = false;
       }
-      if (remain_msec > 0)
-        usleep(remain_msec * 1000);
-      _split_start_from = 0;
-      continue;
     }
-    // find number of splits in this trajectory
-    // time becomes slightly faster if not cleanly dividable
-    int splits = static_cast<int>((it->second - (it-1)->second) / csec_per_frame);
-    // send splitted stroke
-    for (size_t j = _split_start_from; j <= splits; ++j) {
-      // check if any kill signal was provided to current thread
-      mtx_threads_.lock();
-      for (auto th = registered_threads_.begin();
-           th != registered_threads_.end(); ++th)
-        if (th->id == this_id) {
-          if (th->kill) {
-            // save info of killing thread
-            mtx_thread_graveyard_.lock();
-            thread_graveyard_.push_back({_stroke_trajectory,
-                  _interpolation, k, static_cast<int>(j), this_id, _factor});
-            mtx_thread_graveyard_.unlock();
-            // remove this thread info
-            registered_threads_.erase(th);
-            mtx_threads_.unlock();
-            ROS_WARN("upper joint trajectory thread: detected kill signal during interpolation!");
-            return;
-          }
-          break;
-        }
-      mtx_threads_.unlock();
-
-      // from here, main process for split j
-      float t_param = _interpolation.at(k)->interpolate(
-          static_cast<float>(j) / splits);
-      if(j == splits) t_param = 1.0;
-      // calculate stroke in this split
-      std::vector<int16_t> stroke(it->first.size(), 0x7fff);
-      for (size_t i = 0; i < it->first.size(); ++i) {
-        if (it->first[i] == 0x7fff) continue; // skip non-send joints
-        stroke[i] =
-          (1 - t_param) * (it - 1)->first[i] + t_param * it->first[i];
-      }
-      // slightly longer time added for trajectory smoothness
+
+    // both boards are sent at once,
+    // twice the frame period for trajectory smoothness
+    uint16_t csec = static_cast<uint16_t>(std::max(1.0f, std::round(2 * period)));
+    // replies of each board are stamped when they arrive,
+    // the slower board limits the frame rate
+    std::shared_future<bool> upper_sent, lower_sent;
+    int64_t upper_done = 0;
+    int64_t lower_done = 0;
+    int64_t sent_begin = aero::time::steady_ns();
+    if (upper) {
       mtx_upper_.lock();
-      upper_.set_position(stroke, csec_per_frame + 10);
+      upper_sent = upper_->set_position_async(upper_strokes, csec, &upper_done);
       mtx_upper_.unlock();
-      // 20ms sleep in set_position, subtract
-      if(j != splits) {
-        usleep(static_cast<int32_t>(csec_per_frame) * 10 * 1000 - 20000);
-      } else {// total time - used time
-        usleep(static_cast<int32_t>(it->second - (it-1)->second - (splits - 1) * csec_per_frame) * 10 * 1000 - 20000);
-      }
-    } // splits
-    _split_start_from = 1;
-  } // _stroke_trajectory
-
-  // remove finished thread
-  mtx_threads_.lock();
-  for (auto th = registered_threads_.begin(); th != registered_threads_.end(); ++th)
-    if (th->id == this_id) {
-      registered_threads_.erase(th);
-      break;
     }
-  mtx_threads_.unlock();
-
-  ROS_INFO("finished upper joint trajectory thread %f",
-           aero::time::ms(aero::time::now() - start_time));
-}
-
-/////////////////////////////////////////////////
-void AeroControllerNode::LowerTrajectoryThread(
-    std::vector<std::pair<std::vector<int16_t>, uint16_t> > _stroke_trajectory)
-{
-  ROS_INFO("starting lower joint trajectory thread");
-  auto start_time = aero::time::now();
-
-  int csec_per_frame = 10;
-
-  mtx_lower_thread_.lock();
-  int traj_start_from = lower_killed_thread_info_.at_trajectory_num;
-  if (traj_start_from >= _stroke_trajectory.size()) {
-    lower_thread_.id = 0; // bad command, finish thread
-    mtx_lower_thread_.unlock();
-    ROS_WARN("bad lower trajectory detected! trajectory size is 0?");
-    return;
-  }
-  mtx_lower_thread_.unlock();
-
-  for (auto it = _stroke_trajectory.begin() + traj_start_from;
-       it != _stroke_trajectory.end(); ++it) {
-    // check for kill every csec_per_frame
-    mtx_lower_thread_.lock();
-    int elapsed_csec = lower_killed_thread_info_.at_split_num;
-    lower_killed_thread_info_.at_split_num = 0; // set for next frame
-    uint16_t csec_in_frame =
-      it->second - (it-1)->second - static_cast<uint16_t>(elapsed_csec);
-    // 20ms sleep in set_position, subtract
-    int msec_in_frame = static_cast<int>(csec_in_frame - 2) * 10;
-    int loops = msec_in_frame / (csec_per_frame * 10);
-    int remain_msec = msec_in_frame - loops * csec_per_frame * 10;
-
-    // check for kill signal
-    if (lower_thread_.kill) {
-      ROS_WARN("lower joint trajectory thread: detected kill signal one!");
-      lower_killed_thread_info_.trajectories = _stroke_trajectory;
-      lower_killed_thread_info_.at_trajectory_num =
-        static_cast<int>(it - _stroke_trajectory.begin());
-      lower_killed_thread_info_.at_split_num = elapsed_csec;
-      lower_thread_.kill = false;
-      mtx_lower_thread_.unlock();
-      return;
+    if (lower) {
+      mtx_lower_.lock();
+      lower_sent = lower_->set_position_async(lower_strokes, csec, &lower_done);
+      mtx_lower_.unlock();
     }
-    mtx_lower_thread_.unlock();
-
-    // send
-    mtx_lower_.lock();
-    lower_.set_position(it->first, csec_in_frame  + 10);
-    mtx_lower_.unlock();
- 
-    // check for kill during send
-    for (int loop_count = 0; loop_count < loops; ++loop_count) {
-      // check for kill signal
-      mtx_lower_thread_.lock();
-      if (lower_thread_.kill) {
-        ROS_WARN("lower joint trajectory thread: detected kill signal two!");
-        lower_killed_thread_info_.trajectories = _stroke_trajectory;
-        lower_killed_thread_info_.at_trajectory_num =
-          static_cast<int>(it - _stroke_trajectory.begin());
-        lower_killed_thread_info_.at_split_num =
-          loop_count * csec_per_frame + elapsed_csec;
-        lower_thread_.kill = false;
-        mtx_lower_thread_.unlock();
-        return;
-      }
-      mtx_lower_thread_.unlock();
-      usleep(csec_per_frame * 10 * 1000);
+    if (upper) upper_sent.wait();
+    if (lower) lower_sent.wait();
+
+    // time from callback to first frame of started trajectories,
+    // and timing of trajectories, by send completion of each board
+    int64_t sent = aero::time::steady_ns();
+    lock.lock();
+    upper_executor_.sent(upper ? upper_done : sent);
+    lower_executor_.sent(lower ? lower_done : sent);
+    const std::vector<TrajectoryTiming>* finished[2] =
+      {&upper_executor_.finished(), &lower_executor_.finished()};
+    for (int i = 0; i < 2; ++i)
+      for (auto it = finished[i]->begin(); it != finished[i]->end(); ++it)
+        ROS_INFO("%s trajectory %u finished: %.1f ms late"
+                 " (commanded %d ms, frames %.1f ms, actual %.1f ms)",
+                 i == 0 ? "upper" : "lower", it->id,
+                 (it->actual - it->planned) * 1e-6, it->commanded * 10,
+                 it->planned * 1e-6, it->actual * 1e-6);
+    if (upper)
+      upper_bus_ns_ += (upper_done - sent_begin - upper_bus_ns_) / 8;
+    if (lower)
+      lower_bus_ns_ += (lower_done - sent_begin - lower_bus_ns_) / 8;
+    lock.unlock();
+
+    // bus time is averaged over frames, replies vary by a few ms
+    if (upper || lower)
+      bus_ns += (sent - begin - bus_ns) / 8;
+
+    // wake up ahead of next frame by bus time,
+    // so its strokes are on the bus at the deadline
+    deadline += frame_ns;
+    if (sent > deadline) {
+      ROS_WARN("trajectory executor: frame overran by %.1f ms"
+               " (period %.1f ms)",
+               (sent - deadline) * 1e-6, period * 10.0f);
+      deadline = sent; // skip, do not send frames in a burst
     }
-
-    if (remain_msec > 0)
-      usleep(remain_msec * 1000);
+    aero::time::sleep_until_ns(deadline - bus_ns);
+    lock.lock();
   }
-
-  mtx_lower_thread_.lock();
-  lower_thread_.id = 0; // thread finish
-  lower_killed_thread_info_ = {{}, {}, 1, 0, 0, 1.0f};
-  mtx_lower_thread_.unlock();
-
-  ROS_INFO("finished lower joint trajectory thread %f",
-           aero::time::ms(aero::time::now() - start_time));
 }
 
 //////////////////////////////////////////////////
@@ -446,13 +381,14 @@ void AeroControllerNode::JointTrajectoryCallback(
     const trajectory_msgs::JointTrajectory::ConstPtr& _msg)
 {
   ROS_INFO("----start joint trajectory callback----");
+  int64_t stamp = aero::time::steady_ns();
 
   mtx_upper_.lock();
   mtx_lower_.lock();
 
   int number_of_angle_joints =
-      upper_.get_number_of_angle_joints() +
-      lower_.get_number_of_angle_joints();
+      upper_->get_number_of_angle_joints() +
+      lower_->get_number_of_angle_joints();
 
   if (_msg->joint_names.size() > number_of_angle_joints) {
     // invalid number of joints from _msg
@@ -482,13 +418,13 @@ void AeroControllerNode::JointTrajectoryCallback(
   for (size_t i = 0; i < _msg->joint_names.size(); ++i) {
     // try finding name from upper_
     id_in_msg_to_ordered_id[i] =
-        upper_.get_ordered_angle_id(_msg->joint_names[i]);
+        upper_->get_ordered_angle_id(_msg->joint_names[i]);
 
     // if finding name from upper_ failed
     if (id_in_msg_to_ordered_id[i] < 0) {
       // try finding name from lower_
       id_in_msg_to_ordered_id[i] =
-        lower_.get_ordered_angle_id(_msg->joint_names[i]);
+        lower_->get_ordered_angle_id(_msg->joint_names[i]);
     } else {
       ++upper_count;
       send_true[id_in_msg_to_ordered_id[i]] = true;
@@ -517,7 +453,7 @@ void AeroControllerNode::JointTrajectoryCallback(
   if (upper_count > 0) {
     upper_stroke_trajectory.reserve(_msg->points.size() + 1);
     // get current stroke values, use reference for safety
-    std::vector<int16_t> ref_strokes = upper_.get_reference_stroke_vector();
+    std::vector<int16_t> ref_strokes = upper_->get_reference_stroke_vector();
     // fill in unused joints to no-send
     common::UnusedAngle2Stroke(ref_strokes, send_true);
     upper_stroke_trajectory.push_back({ref_strokes, 0});
@@ -526,7 +462,7 @@ void AeroControllerNode::JointTrajectoryCallback(
   if (lower_count > 0) {
     lower_stroke_trajectory.reserve(_msg->points.size() + 1);
     // get current stroke values, use reference for safety
-    std::vector<int16_t> ref_strokes = lower_.get_reference_stroke_vector();
+    std::vector<int16_t> ref_strokes = lower_->get_reference_stroke_vector();
     lower_stroke_trajectory.push_back({ref_strokes, 0});
   }
 
@@ -534,69 +470,67 @@ void AeroControllerNode::JointTrajectoryCallback(
 
   // from here, get ready to handle the _msg positions
 
-  // this is a tmp variable that is reused
-  std::vector<double> ordered_positions(number_of_angle_joints);
+  // angles of all points, converted to strokes in one pass
+  common::TrajectoryBlock<double> ordered_positions;
+  ordered_positions.resize(number_of_angle_joints, _msg->points.size());
+
+  for (size_t i = 0; i < _msg->points.size(); ++i)
+    for (size_t j = 0; j < _msg->points[i].positions.size(); ++j)
+      if (!std::isnan(_msg->points[i].positions[j]))
+        ordered_positions.at(id_in_msg_to_ordered_id[j], i) =
+          _msg->points[i].positions[j];
+
+  common::TrajectoryBlock<int16_t> stroke_block;
+  common::Angle2Stroke(stroke_block, ordered_positions);
+
+  // these are tmp variables that are reused
+  std::vector<int16_t> strokes(AERO_DOF);
+  std::vector<bool> send_true_with_cancel(send_true.size());
 
   // for each trajectory points,
   for (size_t i = 0; i < _msg->points.size(); ++i) {
-    std::fill(ordered_positions.begin(), ordered_positions.end(), 0.0);
+    for (size_t k = 0; k < AERO_DOF; ++k)
+      strokes[k] = stroke_block.at(k, i);
 
     // check for cancelling joints (NaN values)
-    std::vector<bool> send_true_with_cancel;
     send_true_with_cancel.assign(send_true.begin(), send_true.end());
-
     for (size_t j = 0; j < _msg->points[i].positions.size(); ++j)
-      if (!std::isnan(_msg->points[i].positions[j]))
-        ordered_positions[id_in_msg_to_ordered_id[j]] =
-          _msg->points[i].positions[j];
-      else
+      if (std::isnan(_msg->points[i].positions[j]))
         send_true_with_cancel[id_in_msg_to_ordered_id[j]] = false;
 
-    std::vector<int16_t> strokes(AERO_DOF);
-    common::Angle2Stroke(strokes, ordered_positions);
-
     // fill in unused joints to no-send
     common::UnusedAngle2Stroke(strokes, send_true_with_cancel);
 
     // split strokes into upper and lower
-    std::vector<int16_t> upper_stroke_vector(
-        strokes.begin(), strokes.begin() + AERO_DOF_UPPER);
-    std::vector<int16_t> lower_stroke_vector(
-        strokes.begin() + AERO_DOF_UPPER, strokes.end());
+    std::vector<int16_t>::const_iterator upper_begin = strokes.begin();
+    std::vector<int16_t>::const_iterator lower_begin =
+      strokes.begin() + AERO_DOF_UPPER;
 
     double time_sec = _msg->points[i].time_from_start.toSec();
     uint16_t time_csec = static_cast<uint16_t>(time_sec * 100.0);
 
+    // strokes of trajectories are built in place, one vector per point
     if (upper_count > 0) {
-      upper_stroke_trajectory.push_back({upper_stroke_vector, time_csec});
+      upper_stroke_trajectory.emplace_back(
+          std::vector<int16_t>(upper_begin, lower_begin), time_csec);
     }
 
     if (lower_count > 0 && _msg->points.size() > 1) {
-      lower_stroke_trajectory.push_back({lower_stroke_vector, time_csec});
+      lower_stroke_trajectory.emplace_back(
+          std::vector<int16_t>(lower_begin, strokes.cend()), time_csec);
     } else if (lower_count > 0 && i == 0) { // to be removed in future
-      bool servo_off = false;
       // if cancel in any of the joints, cancel movement with servo on
-      for (auto l = lower_stroke_vector.begin();
-           l != lower_stroke_vector.end(); ++l) {
-        if (*l == 0x7fff) {
-          servo_off = true;
-          break;
-        }
-      }
+      bool servo_off =
+        std::find(lower_begin, strokes.cend(), 0x7fff) != strokes.cend();
       if (servo_off) {
-        // kill if trajectory is running
-        mtx_lower_thread_.lock();
-        if (lower_thread_.id == 1) // trajectory is running
-          lower_thread_.kill = true;
-        mtx_lower_thread_.unlock();
-        // cancel lower movement
-        lower_.servo_on();
-        mtx_lower_thread_.lock();
-        lower_thread_.id = 0;
-        lower_killed_thread_info_ = {{}, {}, 1, 0, 0, 1.0f};
-        mtx_lower_thread_.unlock();
+        // drop running trajectories, then cancel lower movement
+        mtx_executor_.lock();
+        lower_executor_.clear();
+        mtx_executor_.unlock();
+        lower_->servo_on();
       } else {
-        lower_stroke_trajectory.push_back({lower_stroke_vector, time_csec});
+        lower_stroke_trajectory.emplace_back(
+            std::vector<int16_t>(lower_begin, strokes.cend()), time_csec);
       }
     }
   }
@@ -604,178 +538,46 @@ void AeroControllerNode::JointTrajectoryCallback(
   mtx_upper_.unlock();
   mtx_lower_.unlock();
 
-  if (lower_count > 0 && lower_stroke_trajectory.size() > 0) {
-    // setup thread settings
-    mtx_lower_thread_.lock();
-    if (lower_thread_.id == 1) { // trajectory is already running
-      ROS_ERROR("you cannot overwrite lower trajectory!");
-      mtx_lower_thread_.unlock();
-    } else {
-      lower_thread_.id = 1;
-      lower_thread_.kill = false;
-      mtx_lower_thread_.unlock();
-      // start thread
-      std::thread send_lower([&](
-        std::vector<std::pair<std::vector<int16_t>, uint16_t> > _stroke_trajectory) {
-          LowerTrajectoryThread(_stroke_trajectory);
-        }, lower_stroke_trajectory);
-      send_lower.detach();
-    }
-  }
-
-  if (upper_count <= 0) {
-    ROS_WARN("----only lower trajectory, finishing up----");
-    return; // nothing more to do
-  }
-
-  std::vector<aero::interpolation::InterpolationPtr> interpolation;
-  interpolation.reserve(upper_stroke_trajectory.size());
-  // fill in dummy setup in head
-  interpolation.push_back(std::shared_ptr<aero::interpolation::Interpolation>(
-        new aero::interpolation::Interpolation(aero::interpolation::i_constant)));
-  // copy interpolation setup
-  mtx_intrpl_.lock();
-  for (auto it = interpolation_.begin(); it != interpolation_.end(); ++it)
-    interpolation.push_back(*it);
-  // fillin rest with linear if not specified
-  for (size_t i = interpolation_.size(); i < upper_stroke_trajectory.size(); ++i)
-    interpolation.push_back(std::shared_ptr<aero::interpolation::Interpolation>(
-        new aero::interpolation::Interpolation(aero::interpolation::i_linear)));
-  mtx_intrpl_.unlock();
-
-  // start new thread if no other thread is running
-  mtx_threads_.lock();
-  if (registered_threads_.size() == 0) {
-    mtx_threads_.unlock();
-    std::thread send_av([&](
-        std::vector<aero::interpolation::InterpolationPtr> _interpolation,
-        std::vector<std::pair<std::vector<int16_t>, uint16_t> > _stroke_trajectory)
-    {
-      JointTrajectoryThread(_interpolation, _stroke_trajectory, 1, 1);
-    }, interpolation, upper_stroke_trajectory);
-    send_av.detach();
-    ROS_INFO("----no other thread is running, finishing up----");
-    return;
-  }
-  mtx_threads_.unlock();
-
-  ROS_WARN("----another thread is running----");
-
-  // check if any of current joint is already running in one of the threads
-  std::vector<std::pair<int, uint> > conflict_joints;
-  mtx_threads_.lock();
-  for (size_t i = 0; i < upper_stroke_trajectory[1].first.size(); ++i) {
-    if (upper_stroke_trajectory[1].first.at(i) == 0x7fff &&
-        upper_stroke_trajectory[0].first.at(i) == 0x7fff) // **
-      continue;
-    // ** if [1] == 0x7fff but [0] != 0x7fff : the 0x7fff in [1] means cancel
-    //    this distinguishes unused joints to cancelled joints
-    for (auto th = registered_threads_.begin(); th != registered_threads_.end(); ++th)
-      for (auto j = th->joints.begin(); j != th->joints.end(); ++j)
-        if (i == *j) conflict_joints.push_back({static_cast<int>(i), th->id});
-  }
-  mtx_threads_.unlock();
-
-  // start new thread if there is no conflict
-  if (conflict_joints.size() == 0) {
-    std::thread send_av([&](
-        std::vector<aero::interpolation::InterpolationPtr> _interpolation,
-        std::vector<std::pair<std::vector<int16_t>, uint16_t> > _stroke_trajectory)
-    {
-      JointTrajectoryThread(_interpolation, _stroke_trajectory, 1, 1);
-    }, interpolation, upper_stroke_trajectory);
-    send_av.detach();
-    ROS_INFO("----no conflict in threads, finishing up----");
-    return;
-  }
-
-  ROS_WARN("----confict in threads----");
-
-  // if there is a thread conflict, thread remapping must be conducted
-  // find and count the threads to be killed
-  std::vector<int> kill_thread_id;
-  for (auto it = conflict_joints.begin(); it != conflict_joints.end(); ++it) {
-    auto in_list = std::find(kill_thread_id.begin(), kill_thread_id.end(), it->second);
-    if (in_list == kill_thread_id.end()) { // kill thread if not killed yet
-      mtx_threads_.lock();
-      for (auto th = registered_threads_.begin(); th != registered_threads_.end(); ++th)
-        if (it->second == th->id) {
-          th->kill = true; // register as kill
-          kill_thread_id.push_back(it->second); // save already set to kill thread
-          mtx_threads_.unlock();
-          break;
-        }
-      mtx_threads_.unlock();
-    }
-  }
-
-  auto time_begin = std::chrono::high_resolution_clock::now();
-
-  // wait till corresponding threads are killed
-  while (1) {
-    mtx_thread_graveyard_.lock();
-    if (thread_graveyard_.size() == kill_thread_id.size() ||
-        std::chrono::duration_cast<std::chrono::milliseconds>(
-            std::chrono::high_resolution_clock::now() - time_begin).count()
-        > 500) { // a thread might have finished before kill
-      mtx_thread_graveyard_.unlock();
-      break;
-    }
-    mtx_thread_graveyard_.unlock();
-    usleep(10 * 1000); // sleep 10 ms and wait for update
-  }
-
-  mtx_thread_graveyard_.lock();
-  // remap use joint info
-  for (auto it = conflict_joints.begin(); it != conflict_joints.end(); ++it)
-    for (auto th = thread_graveyard_.begin(); th != thread_graveyard_.end(); ++th)
-      if (it->second == th->thread_id) {
-        for (auto traj = th->trajectories.begin();
-             traj != th->trajectories.end(); ++traj)
-          traj->first.at(it->first) = 0x7fff;
-        break;
-      }
-  // create new threads
-  std::vector<std::thread> new_threads;
-  // add this msg
-  new_threads.push_back(std::thread([&](
-        std::vector<aero::interpolation::InterpolationPtr> _interpolation,
-        std::vector<std::pair<std::vector<int16_t>, uint16_t> > _stroke_trajectory)
-    {
-      JointTrajectoryThread(_interpolation, _stroke_trajectory, 1, 1);
-    }, interpolation, upper_stroke_trajectory));
-  // add previously running threads that were remapped
-  for (auto th = thread_graveyard_.begin(); th != thread_graveyard_.end(); ++th) {
-    int unused_joint_num = 0;
-    for (auto j = th->trajectories[0].first.begin();
-         j != th->trajectories[0].first.end(); ++j)
-      if (*j == 0x7fff) ++unused_joint_num;
-    // i_constant at_split_num tracks elapsed time
-    // elapsed time is used for speed overwrite but not for command overwrite
-    if (th->interpolation.at(th->at_trajectory_num)->is(aero::interpolation::i_constant))
-      th->at_split_num = 1; // make sure to reset elapsed time
-    // if remapped trajectory is still valid (= has moving joints)
-    if (unused_joint_num != th->trajectories[0].first.size()) {
-      new_threads.push_back(std::thread([&](
-        std::vector<aero::interpolation::InterpolationPtr> _interpolation,
-        std::vector<std::pair<std::vector<int16_t>, uint16_t> > _stroke_trajectory,
-        int _trajectory_start_from,
-        int _split_start_from)
-      {
-        JointTrajectoryThread(_interpolation, _stroke_trajectory,
-                              _trajectory_start_from, _split_start_from);
-      }, th->interpolation, th->trajectories, th->at_trajectory_num, th->at_split_num));
-    } else if (th->interpolation.at(th->at_trajectory_num)->is(aero::interpolation::i_constant)) {
-      // upper_.servo_on(); // cancel movement
-    }
+  std::vector<aero::interpolation::Interpolation> interpolation;
+  // ~frame_period may be set at runtime for following trajectories
+  double frame_period;
+  float period = frame_period_;
+  if (nh_.getParamCached("frame_period", frame_period) && frame_period > 0)
+    period = static_cast<float>(frame_period * 100);
+  if (upper_count > 0) {
+    interpolation.reserve(upper_stroke_trajectory.size());
+    // fill in dummy setup in head
+    interpolation.push_back(
+        aero::interpolation::Interpolation(aero::interpolation::i_constant));
+    // copy interpolation setup
+    mtx_intrpl_.lock();
+    for (auto it = interpolation_.begin(); it != interpolation_.end(); ++it)
+      interpolation.push_back(*it);
+    // fillin rest with linear if not specified
+    for (size_t i = interpolation_.size(); i < upper_stroke_trajectory.size(); ++i)
+      interpolation.push_back(
+          aero::interpolation::Interpolation(aero::interpolation::i_linear));
+    mtx_intrpl_.unlock();
   }
-  // free graveyard
-  thread_graveyard_.clear();
-  mtx_thread_graveyard_.unlock();
 
-  // start threads
-  std::for_each(
-      new_threads.begin(), new_threads.end(), [](std::thread& t){ t.detach(); });
+  // every frame is computed here, the executor thread only reads them
+  TrajectoryFrames lower_frames, upper_frames;
+  if (lower_count > 0)
+    TrajectoryExecutor::precompute(
+        lower_frames, lower_stroke_trajectory, {}, period, stamp);
+  if (upper_count > 0)
+    TrajectoryExecutor::precompute(
+        upper_frames, upper_stroke_trajectory, interpolation, period, stamp);
+
+  // hand over to executor, strokes used by this msg are taken
+  // from running trajectories at next frame, other strokes keep moving
+  mtx_executor_.lock();
+  if (lower_count > 0)
+    lower_executor_.add(lower_frames);
+  if (upper_count > 0)
+    upper_executor_.add(upper_frames);
+  mtx_executor_.unlock();
+  executor_cv_.notify_one();
 
   ROS_INFO("----finishing joint trajectory callback----");
 }
@@ -787,19 +589,11 @@ void AeroControllerNode::SpeedOverwriteCallback(
   ROS_WARN("----speed overwrite callback---- factor:%f", _msg->data);
 
   // make sure robot is in action when SpeedOverwrite is called
-  bool upper=true, lower=true;
-  mtx_threads_.lock();
-  if (registered_threads_.size() == 0)
-    upper = false;
-  mtx_threads_.unlock();
-  mtx_lower_thread_.lock();
-  if (lower_thread_.id == 0)
-    lower = false;
-  mtx_lower_thread_.unlock();
-  mtx_thread_postpone_.lock();
-  bool postpone = thread_postpone_;
-  mtx_thread_postpone_.unlock();
-  if (!upper && !lower && !postpone) {
+  mtx_executor_.lock();
+  bool in_action = upper_executor_.size() > 0 || lower_executor_.size() > 0;
+  bool postpone = paused_;
+  mtx_executor_.unlock();
+  if (!in_action && !postpone) {
     ROS_ERROR("  cannot overwrite speed when robot is not in action!");
     return;
   }
@@ -815,128 +609,23 @@ void AeroControllerNode::SpeedOverwriteCallback(
     return;
   }
 
-  // on background, kill lower thread if running
-  std::thread lower_process([&](bool _postpone){
-      mtx_lower_thread_.lock();
-      if (lower_thread_.id == 1 && !_postpone) // if running
-        lower_thread_.kill = true;
-      mtx_lower_thread_.unlock();
-
-      auto time_begin = std::chrono::high_resolution_clock::now();
-      while (1) {
-        mtx_lower_thread_.lock();
-        if (!lower_thread_.kill ||
-            std::chrono::duration_cast<std::chrono::milliseconds>(
-              std::chrono::high_resolution_clock::now() - time_begin).count()
-            > 500) { // a thread might have finished before kill
-          mtx_lower_thread_.unlock();
-          break;
-        }
-        mtx_lower_thread_.unlock();
-        usleep(10 * 1000); // sleep 10 ms and wait for update
-      }
-
-      if (_msg->data < abort_threshold) { // avoid overflow, act as 0.0
-        mtx_lower_.lock();
-        lower_.servo_on();
-        mtx_lower_.unlock();
-        return;
-      }
-
-      // rewrite lower thread command time
-      // update elapsed time to new time scale
-      mtx_lower_thread_.lock();
-      lower_killed_thread_info_.at_split_num /=
-        _msg->data / lower_killed_thread_info_.factor;
-      for (auto traj = lower_killed_thread_info_.trajectories.begin();
-           traj != lower_killed_thread_info_.trajectories.end(); ++traj)
-        traj->second = static_cast<uint16_t>(
-            traj->second / (_msg->data / lower_killed_thread_info_.factor));
-      lower_killed_thread_info_.factor = _msg->data;
-      mtx_lower_thread_.unlock();
-    }, postpone);
-
-  if (_msg->data < abort_threshold) {
-    // set postpone flag before thread clear to avoid wait escape
-    // speed 0.0 is technically non-dead
-    mtx_thread_postpone_.lock();
-    thread_postpone_ = true;
-    mtx_thread_postpone_.unlock();
-  }
+  // trajectories keep their progress and run at new speed from next frame,
+  // speed 0.0 holds them until next overwrite (technically non-dead)
+  float factor = (_msg->data < abort_threshold) ? 0.0f : _msg->data;
+  mtx_executor_.lock();
+  upper_executor_.set_factor(factor);
+  lower_executor_.set_factor(factor);
+  paused_ = (factor == 0.0f);
+  mtx_executor_.unlock();
 
-  // kill all running upper threads
-  std::vector<int> kill_thread_id;
-  mtx_threads_.lock();
-  for (auto th = registered_threads_.begin(); th != registered_threads_.end(); ++th) {
-    th->kill = true;
-    kill_thread_id.push_back(th->id);
-  }
-  mtx_threads_.unlock();
-
-  auto time_begin = std::chrono::high_resolution_clock::now();
-  if (!postpone)
-    while (1) {
-      mtx_thread_graveyard_.lock();
-      if (thread_graveyard_.size() == kill_thread_id.size() ||
-          std::chrono::duration_cast<std::chrono::milliseconds>(
-            std::chrono::high_resolution_clock::now() - time_begin).count()
-          > 500) { // a thread might have finished before kill
-        break;
-      }
-      mtx_thread_graveyard_.unlock();
-      usleep(10 * 1000); // sleep 10 ms and wait for update
-    }
-
-  if (_msg->data < abort_threshold) { // avoid overflow, act as 0.0
-    mtx_thread_graveyard_.unlock();
+  if (factor == 0.0f) { // cancel movement
     mtx_upper_.lock();
-    upper_.servo_on();
+    upper_->servo_on();
     mtx_upper_.unlock();
-    lower_process.join();
-    return;
-  }
-
-  // rewrite graveyard command time
-  // create new threads
-  std::vector<std::thread> new_threads;
-  for (auto th = thread_graveyard_.begin(); th != thread_graveyard_.end(); ++th) {
-    // update elapsed time to new time scale
-    th->at_split_num = static_cast<uint16_t>(th->at_split_num / (_msg->data / th->factor));
-
-    for (auto traj = th->trajectories.begin();
-         traj != th->trajectories.end(); ++traj)
-      traj->second = static_cast<uint16_t>(traj->second / (_msg->data / th->factor));
-    new_threads.push_back(std::thread([&](
-        std::vector<aero::interpolation::InterpolationPtr> _interpolation,
-        std::vector<std::pair<std::vector<int16_t>, uint16_t> > _stroke_trajectory,
-        int _trajectory_start_from,
-        int _split_start_from, float _factor)
-      {
-        JointTrajectoryThread(_interpolation, _stroke_trajectory,
-                              _trajectory_start_from, _split_start_from, _factor);
-      }, th->interpolation, th->trajectories, th->at_trajectory_num, th->at_split_num, _msg->data));
+    mtx_lower_.lock();
+    lower_->servo_on();
+    mtx_lower_.unlock();
   }
-  // free graveyard
-  thread_graveyard_.clear();
-  mtx_thread_graveyard_.unlock();
-
-  // create new lower thread
-  lower_process.join();
-  mtx_thread_postpone_.lock();
-  thread_postpone_ = false;
-  mtx_thread_postpone_.unlock();
-  mtx_lower_thread_.lock();
-  std::thread send_lower([&](
-    std::vector<std::pair<std::vector<int16_t>, uint16_t> > _stroke_trajectory) {
-      LowerTrajectoryThread(_stroke_trajectory);
-    }, lower_killed_thread_info_.trajectories);
-  lower_killed_thread_info_.trajectories.clear(); // re-fresh data
-  mtx_lower_thread_.unlock();
-  send_lower.detach();
-
-  // resend commands with rewritten time
-  std::for_each(
-      new_threads.begin(), new_threads.end(), [](std::thread& t){ t.detach(); });
 
   ROS_INFO("----finishing speed overwrite callback----");
 }
@@ -950,38 +639,35 @@ void AeroControllerNode::JointStateCallback(const ros::TimerEvent& event)
 //////////////////////////////////////////////////
 void AeroControllerNode::JointStateOnce()
 {
-  mtx_upper_.lock();
-  mtx_lower_.lock();
+  // strokes are read from snapshots published by the boards,
+  // no need of mtx_upper_, mtx_lower_ and trajectories are not blocked
 
   // get desired positions
   std::vector<int16_t> upper_ref_vector =
-      upper_.get_reference_stroke_vector();
+      upper_->get_reference_stroke_vector();
   std::vector<int16_t> lower_ref_vector =
-      lower_.get_reference_stroke_vector();
+      lower_->get_reference_stroke_vector();
 
   // update current position when upper body is not being controlled
   // when upper body is controlled, current position is auto-updated
-  mtx_threads_.lock();
-  if (registered_threads_.size() == 0) {
-    // commands take 20ms sleep, threading to save time
-    std::thread t1([&](){
-        upper_.update_position();
-      });
-    std::thread t2([&](){
-        lower_.update_position();
-      });
-    t1.join();
-    t2.join();
+  mtx_executor_.lock();
+  bool upper_idle = (upper_executor_.size() == 0);
+  mtx_executor_.unlock();
+  if (upper_idle) {
+    // both boards are polled at once, no thread is needed
+    std::shared_future<bool> upper = upper_->update_position_async();
+    std::shared_future<bool> lower = lower_->update_position_async();
+    upper.wait();
+    lower.wait();
   }
-  mtx_threads_.unlock();
 
   // get upper actual positions
   std::vector<int16_t> upper_stroke_vector =
-    upper_.get_actual_stroke_vector();
+    upper_->get_actual_stroke_vector();
 
   // get lower actual positions
   std::vector<int16_t> lower_stroke_vector =
-    lower_.get_actual_stroke_vector();
+    lower_->get_actual_stroke_vector();
 
   // first handle the stroke publisher
   // in this way, we don't have to concatenate new vectors
@@ -993,13 +679,13 @@ void AeroControllerNode::JointStateOnce()
 
   if (upper_ref_vector.size() < AERO_DOF_UPPER || upper_stroke_vector.size() < AERO_DOF_UPPER)
     for (size_t i = 0; i < AERO_DOF_UPPER; ++i) {
-      stroke_state.joint_names[i] = upper_.get_stroke_joint_name(i);
+      stroke_state.joint_names[i] = upper_->get_stroke_joint_name(i);
       stroke_state.desired.positions[i] = 0.0;
       stroke_state.actual.positions[i] = 0.0;
     }
   else // usually should enter else, enters if when port is not activated
     for (size_t i = 0; i < AERO_DOF_UPPER; ++i) {
-      stroke_state.joint_names[i] = upper_.get_stroke_joint_name(i);
+      stroke_state.joint_names[i] = upper_->get_stroke_joint_name(i);
       stroke_state.desired.positions[i] =
           static_cast<double>(upper_ref_vector[i]);
       stroke_state.actual.positions[i] =
@@ -1009,14 +695,14 @@ void AeroControllerNode::JointStateOnce()
   if (lower_ref_vector.size() < AERO_DOF_LOWER || lower_stroke_vector.size() < AERO_DOF_LOWER)
     for (size_t i = 0; i < AERO_DOF_LOWER; ++i) {
       stroke_state.joint_names[i + AERO_DOF_UPPER] =
-          lower_.get_stroke_joint_name(i);
+          lower_->get_stroke_joint_name(i);
       stroke_state.desired.positions[i + AERO_DOF_UPPER] = 0.0;
       stroke_state.actual.positions[i + AERO_DOF_UPPER] = 0.0;
     }
   else // usually should enter else, enters if when port is not activated
     for (size_t i = 0; i < AERO_DOF_LOWER; ++i) {
       stroke_state.joint_names[i + AERO_DOF_UPPER] =
-          lower_.get_stroke_joint_name(i);
+          lower_->get_stroke_joint_name(i);
       stroke_state.desired.positions[i + AERO_DOF_UPPER] =
           static_cast<double>(lower_ref_vector[i]);
       stroke_state.actual.positions[i + AERO_DOF_UPPER] =
@@ -1024,8 +710,8 @@ void AeroControllerNode::JointStateOnce()
     }
 
   int number_of_angle_joints =
-      upper_.get_number_of_angle_joints() +
-      lower_.get_number_of_angle_joints();
+      upper_->get_number_of_angle_joints() +
+      lower_->get_number_of_angle_joints();
 
   control_msgs::JointTrajectoryControllerState state;
   state.header.stamp = ros::Time::now();
@@ -1048,14 +734,40 @@ void AeroControllerNode::JointStateOnce()
 
   // get status
   std_msgs::Bool status_flag;
-  status_flag.data = upper_.get_status() || lower_.get_status();
+  status_flag.data = upper_->get_status() || lower_->get_status();
   status_pub_.publish(status_flag);
 
   state_pub_.publish(state);
   stroke_state_pub_.publish(stroke_state);
+}
 
-  mtx_upper_.unlock();
-  mtx_lower_.unlock();
+//////////////////////////////////////////////////
+void AeroControllerNode::PublishDiagnostics(const ros::TimerEvent& _event)
+{
+  // counters are kept by io threads, no need of mtx_upper_, mtx_lower_
+  SEEDBusStats upper = upper_->get_bus_stats();
+  SEEDBusStats lower = lower_->get_bus_stats();
+
+  mtx_executor_.lock();
+  HandoverStats upper_handover = upper_executor_.stats();
+  HandoverStats lower_handover = lower_executor_.stats();
+  float period = executor_period_;
+  int64_t upper_bus_ns = upper_bus_ns_;
+  int64_t lower_bus_ns = lower_bus_ns_;
+  mtx_executor_.unlock();
+
+  diagnostic_msgs::DiagnosticArray array;
+  array.header.stamp = ros::Time::now();
+  array.status.push_back(bus_diagnostics("upper", upper, last_bus_stats_upper_));
+  array.status.push_back(bus_diagnostics("lower", lower, last_bus_stats_lower_));
+  array.status.push_back(
+      executor_diagnostics("upper", upper_handover, period, upper_bus_ns));
+  array.status.push_back(
+      executor_diagnostics("lower", lower_handover, period, lower_bus_ns));
+  diagnostics_pub_.publish(array);
+
+  last_bus_stats_upper_ = upper;
+  last_bus_stats_lower_ = lower;
 }
 
 //////////////////////////////////////////////////
@@ -1079,42 +791,15 @@ void AeroControllerNode::PublishInAction(const ros::TimerEvent& event)
     return;
   }
 
-  // count upper trajectory threads number
-  int upper;
-  if (!mtx_threads_.try_lock()) {// when mutex cant be locked, thread should be active.
-    upper = 1;
-  } else {//lock
-    upper = static_cast<int>(registered_threads_.size());
-    mtx_threads_.unlock();
-  }
-  if (upper > 0) {
-    msg.data = true;
-    in_action_pub_.publish(msg);
-    return;
-  }
-
-  // lower trajectory thread is active or not
-  int lower;
-  if (!mtx_lower_thread_.try_lock()) {// when mutex cant be locked, thread should be active.
-    lower = 1;
-  } else {
-    lower = lower_thread_.id;
-    mtx_lower_thread_.unlock();
-  }
-  if (lower > 0) {
-    msg.data = true;
-    in_action_pub_.publish(msg);
-    return;
-  }
-
-  bool in_overwrite = false;
-  if (!mtx_thread_postpone_.try_lock()) {// when mutex cant be locked, thread should be active.
-    in_overwrite = true;
+  // trajectories are running or held by speed overwrite
+  bool running;
+  if (!mtx_executor_.try_lock()) {// when mutex cant be locked, executor should be active.
+    running = true;
   } else {//lock
-    in_overwrite = thread_postpone_;
-    mtx_thread_postpone_.unlock();
+    running = upper_executor_.size() > 0 || lower_executor_.size() > 0;
+    mtx_executor_.unlock();
   }
-  if (in_overwrite) {
+  if (running) {
     msg.data = true;
     in_action_pub_.publish(msg);
     return;
@@ -1130,10 +815,10 @@ void AeroControllerNode::WheelServoCallback(
 
   if (_msg->data) {
     // wheel_on sets all joints and wheels to servo on
-    lower_.wheel_on();
+    lower_->wheel_on();
   } else {
     // servo_on joints only, and servo off wheels
-    lower_.wheel_only_off();
+    lower_->wheel_only_off();
   }
 
   mtx_lower_.unlock();
@@ -1146,8 +831,8 @@ void AeroControllerNode::StatusResetCallback(
   mtx_upper_.lock();
   mtx_lower_.lock();
 
-  upper_.reset_status();
-  lower_.reset_status();
+  upper_->reset_status();
+  lower_->reset_status();
 
   mtx_upper_.unlock();
   mtx_lower_.unlock();
@@ -1177,13 +862,13 @@ void AeroControllerNode::WheelCommandCallback(
   for (size_t i = 0; i < _msg->joint_names.size(); ++i) {
     std::string joint_name = _msg->joint_names[i];
     joint_to_wheel_indices[i] =
-        lower_.get_wheel_id(joint_name);
+        lower_->get_wheel_id(joint_name);
   }
 
   // set previous velocity
   std::vector<int16_t> wheel_vector;
   std::vector<int16_t>& ref_vector =
-      lower_.get_reference_wheel_vector();
+      lower_->get_reference_wheel_vector();
   wheel_vector.assign(ref_vector.begin(), ref_vector.end());
 
   // for each trajectory points,
@@ -1199,7 +884,7 @@ void AeroControllerNode::WheelCommandCallback(
 
     double time_sec = _msg->points[i].time_from_start.toSec();
     uint16_t time_csec = static_cast<uint16_t>(time_sec * 100.0);
-    lower_.set_wheel_velocity(wheel_vector, time_csec);
+    lower_->set_wheel_velocity(wheel_vector, time_csec);
     // usleep(static_cast<int32_t>(time_sec * 1000.0 * 1000.0));
   }
 
@@ -1214,11 +899,11 @@ void AeroControllerNode::UtilServoCallback(
 
   if (_msg->data == 0) {
     usleep(static_cast<int32_t>(200.0 * 1000.0));
-    upper_.util_servo_off();
+    upper_->util_servo_off();
     usleep(static_cast<int32_t>(200.0 * 1000.0));
   } else {
     usleep(static_cast<int32_t>(200.0 * 1000.0));
-    upper_.util_servo_on();
+    upper_->util_servo_on();
     usleep(static_cast<int32_t>(200.0 * 1000.0));
   }
 
@@ -1235,9 +920,10 @@ bool AeroControllerNode::InterpolationCallback(
   mtx_intrpl_.lock();
   interpolation_.clear();
 
+  // curves are compiled to polynomials here and by set_points,
+  // trajectories copy them by value
   for (auto it = _req.type.begin(); it != _req.type.end(); ++it) {
-    interpolation_.push_back(std::shared_ptr<aero::interpolation::Interpolation>(
-        new aero::interpolation::Interpolation(*it)));
+    interpolation_.push_back(aero::interpolation::Interpolation(*it));
   }
 
   int i = 0;
@@ -1248,7 +934,7 @@ bool AeroControllerNode::InterpolationCallback(
     }
     int j = 0;
     for (auto itt = it->points.begin(); itt != it->points.end(); ++itt) {
-      interpolation_.at(i)->set_points({itt->x, itt->y}, j);
+      interpolation_.at(i).set_points({itt->x, itt->y}, j);
       ++j;
     }
     ++i;
@@ -1263,7 +949,7 @@ bool AeroControllerNode::InterpolationCallback(
 //     const std_msgs::Int16MultiArray::ConstPtr& _msg)
 // {
 //   mtx_upper_.lock();
-//     upper_.Hand_Script(_msg->data[0],_msg->data[1]);
+//     upper_->Hand_Script(_msg->data[0],_msg->data[1]);
 //   mtx_upper_.unlock();
 // }
 
@@ -1273,11 +959,11 @@ bool AeroControllerNode::GraspControlCallback(
     aero_startup::GraspControl::Response& _res)
 {
   mtx_upper_.lock();
-  upper_.set_max_single_current(_req.position, _req.power);
+  upper_->set_max_single_current(_req.position, _req.power);
   mtx_upper_.unlock();
   usleep(200 * 1000);
   mtx_upper_.lock();
-  upper_.Hand_Script(_req.position, _req.script);
+  upper_->Hand_Script(_req.position, _req.script);
   mtx_upper_.unlock();
 
   // return if cancel script
@@ -1291,22 +977,22 @@ bool AeroControllerNode::GraspControlCallback(
   }
 
   mtx_upper_.lock();
-  upper_.update_position();
+  upper_->update_position();
   std::vector<int16_t> upper_stroke_vector_ret =
-    upper_.get_actual_stroke_vector();
+    upper_->get_actual_stroke_vector();
   mtx_upper_.unlock();
 
   // get lower for angle conversion only (update not necessary)
   mtx_lower_.lock();
   std::vector<int16_t> lower_stroke_vector_ret =
-    lower_.get_actual_stroke_vector();
+    lower_->get_actual_stroke_vector();
   mtx_lower_.unlock();
   upper_stroke_vector_ret.insert(upper_stroke_vector_ret.end(),
       lower_stroke_vector_ret.begin(), lower_stroke_vector_ret.end());
 
   // convert strokes to angles
-  std::vector<double> upper_angles(upper_.get_number_of_angle_joints()
-      + lower_.get_number_of_angle_joints());
+  std::vector<double> upper_angles(upper_->get_number_of_angle_joints()
+      + lower_->get_number_of_angle_joints());
   common::Stroke2Angle(upper_angles, upper_stroke_vector_ret);
 
   _res.angles.resize(2);
@@ -1328,8 +1014,8 @@ bool AeroControllerNode::SendJointsCallback(
   mtx_lower_.lock();
 
   int number_of_angle_joints =
-      upper_.get_number_of_angle_joints() +
-      lower_.get_number_of_angle_joints();
+      upper_->get_number_of_angle_joints() +
+      lower_->get_number_of_angle_joints();
 
   if (_req.joint_names.size() > number_of_angle_joints) {
     // invalid number of joints from _req
@@ -1357,13 +1043,13 @@ bool AeroControllerNode::SendJointsCallback(
   for (size_t i = 0; i < _req.joint_names.size(); ++i) {
     // try finding name from upper_
     id_in_req_to_ordered_id[i] =
-        upper_.get_ordered_angle_id(_req.joint_names[i]);
+        upper_->get_ordered_angle_id(_req.joint_names[i]);
 
     // if finding name from upper_ failed
     if (id_in_req_to_ordered_id[i] < 0) {
       // try finding name from lower_
       id_in_req_to_ordered_id[i] =
-        lower_.get_ordered_angle_id(_req.joint_names[i]);
+        lower_->get_ordered_angle_id(_req.joint_names[i]);
     } else {
       ++upper_count;
       send_true[id_in_req_to_ordered_id[i]] = true;
@@ -1420,22 +1106,22 @@ bool AeroControllerNode::SendJointsCallback(
   std::thread t1([&](){
       if (_req.reset_status) { // reset status if flag
         usleep(20000); // 20ms sleep before next command
-        upper_.reset_status();
+        upper_->reset_status();
         usleep(20000); // 20ms sleep before next command
       }
       if (upper_count > 0) {
-        upper_.set_position(upper_stroke_vector, time_csec);
+        upper_->set_position(upper_stroke_vector, time_csec);
       }
     });
 
   std::thread t2([&](){
       if (_req.reset_status) { // reset status if flag
         usleep(20000); // 20ms sleep before next command
-        lower_.reset_status();
+        lower_->reset_status();
         usleep(20000); // 20ms sleep before next command
       }
       if (lower_count > 0) {
-        lower_.set_position(lower_stroke_vector, time_csec);
+        lower_->set_position(lower_stroke_vector, time_csec);
       }
     });
 
@@ -1458,21 +1144,21 @@ bool AeroControllerNode::SendJointsCallback(
 
   // commands take 20ms sleep, threading to save time
   std::thread t3([&](){
-      upper_.update_position();
+      upper_->update_position();
     });
   std::thread t4([&](){
-      lower_.update_position();
+      lower_->update_position();
     });
   t3.join();
   t4.join();
 
   // get upper actual positions
   std::vector<int16_t> upper_stroke_vector_ret =
-    upper_.get_actual_stroke_vector();
+    upper_->get_actual_stroke_vector();
 
   // get lower actual positions
   std::vector<int16_t> lower_stroke_vector_ret =
-    lower_.get_actual_stroke_vector();
+    lower_->get_actual_stroke_vector();
 
   std::vector<double> actual_stroke_state(AERO_DOF);
 
@@ -1505,7 +1191,7 @@ bool AeroControllerNode::SendJointsCallback(
 
   // get status
   std_msgs::Bool status_flag;
-  _res.status = upper_.get_status() || lower_.get_status();
+  _res.status = upper_->get_status() || lower_->get_status();
 
   mtx_upper_.unlock();
   mtx_lower_.unlock();
@@ -1525,13 +1211,13 @@ bool AeroControllerNode::GetJointsCallback(
   mtx_lower_.lock();
 
   int number_of_angle_joints =
-      upper_.get_number_of_angle_joints() +
-      lower_.get_number_of_angle_joints();
+      upper_->get_number_of_angle_joints() +
+      lower_->get_number_of_angle_joints();
 
   std::thread t1([&](){
       if (_req.reset_status) { // reset status if flag
         usleep(20000); // 20ms sleep before next command
-        upper_.reset_status();
+        upper_->reset_status();
         usleep(20000); // 20ms sleep before next command
       }
     });
@@ -1539,7 +1225,7 @@ bool AeroControllerNode::GetJointsCallback(
   std::thread t2([&](){
       if (_req.reset_status) { // reset status if flag
         usleep(20000); // 20ms sleep before next command
-        lower_.reset_status();
+        lower_->reset_status();
         usleep(20000); // 20ms sleep before next command
       }
     });
@@ -1549,17 +1235,17 @@ bool AeroControllerNode::GetJointsCallback(
 
   // commands take 20ms sleep, threading to save time
   std::thread t3([&](){
-      upper_.update_position();
+      upper_->update_position();
     });
   std::thread t4([&](){
-      lower_.update_position();
+      lower_->update_position();
     });
   t3.join();
   t4.join();
 
   // print status for debug
-  // upper_.update_status();
-  // std::vector<int16_t> stat = upper_.get_status_vec();
+  // upper_->update_status();
+  // std::vector<int16_t> stat = upper_->get_status_vec();
   // for (unsigned int i = 0; i < stat.size(); ++i)
   //   std::cout << static_cast<int>(i) << ": " << static_cast<int>(stat.at(i)) << ", ";
   // std::cout << std::endl;
@@ -1567,11 +1253,11 @@ bool AeroControllerNode::GetJointsCallback(
 
   // get upper actual positions
   std::vector<int16_t> upper_stroke_vector_ret =
-    upper_.get_actual_stroke_vector();
+    upper_->get_actual_stroke_vector();
 
   // get lower actual positions
   std::vector<int16_t> lower_stroke_vector_ret =
-    lower_.get_actual_stroke_vector();
+    lower_->get_actual_stroke_vector();
 
   std::vector<double> actual_stroke_state(AERO_DOF);
 
@@ -1604,7 +1290,7 @@ bool AeroControllerNode::GetJointsCallback(
 
   // get status
   std_msgs::Bool status_flag;
-  _res.status = upper_.get_status() || lower_.get_status();
+  _res.status = upper_->get_status() || lower_->get_status();
 
   mtx_upper_.unlock();
   mtx_lower_.unlock();
@@ -11,10 +11,15 @@
 #include <cmath>
 #include <thread>
 #include <mutex>
+#include <condition_variable>
 #include <algorithm>
+#include <memory>
+#include <stdexcept>
 
 #include "aero_hardware_interface/Constants.hh"
 #include "aero_hardware_interface/AeroControllers.hh"
+#include "aero_hardware_interface/AeroBus.hh"
+#include "aero_hardware_interface/AeroBusConfig.hh"
 
 #include "aero_hardware_interface/AngleJointNames.hh"
 #include "aero_hardware_interface/Stroke2Angle.hh"
@@ -22,6 +27,8 @@
 #include "aero_hardware_interface/UnusedAngle2Stroke.hh"
 
 #include "aero_hardware_interface/Interpolation.hh"
+#include "aero_hardware_interface/TrajectoryExecutor.hh"
+#include "aero_hardware_interface/SEEDBusDiagnostics.hh"
 
 #include <ros/ros.h>
 #include <trajectory_msgs/JointTrajectory.h>
@@ -45,6 +52,8 @@
 #include <std_msgs/Float32.h>
 
 #include <chrono>
+#include <cerrno>
+#include <time.h>
 
 namespace aero
 {
@@ -56,6 +65,26 @@ namespace aero
     inline float ms(std::chrono::duration<double> _p)
     { return std::chrono::duration_cast<std::chrono::milliseconds>(_p).count();\
     };
+
+    /// @brief CLOCK_MONOTONIC time[ns]
+    inline int64_t steady_ns()
+    {
+      struct timespec now;
+      clock_gettime(CLOCK_MONOTONIC, &now);
+      return static_cast<int64_t>(now.tv_sec) * 1000000000 + now.tv_nsec;
+    };
+
+    /// @brief sleep until absolute CLOCK_MONOTONIC time,
+    ///   returns at once if it has passed
+    /// @param _deadline time[ns]
+    inline void sleep_until_ns(int64_t _deadline)
+    {
+      struct timespec deadline;
+      deadline.tv_sec = _deadline / 1000000000;
+      deadline.tv_nsec = _deadline % 1000000000;
+      while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &deadline, NULL)
+             == EINTR);
+    };
   }
 }
 
@@ -64,40 +93,18 @@ namespace aero
   namespace controller
   {
 
-    /// @brief Handles kill running joint trajectory threads.
-    struct thread_info
-    {
-      uint id;
-
-      std::vector<int> joints;
-
-      bool kill;
-    };
-
-    /// @brief Handles copy killed joint trajectory threads.
-    struct killed_thread_info
-    {
-      std::vector<std::pair<std::vector<int16_t>, uint16_t> > trajectories;
-
-      std::vector<aero::interpolation::InterpolationPtr> interpolation;
-
-      int at_trajectory_num;
-
-      int at_split_num;
-
-      uint thread_id;
-
-      float factor; // for speed overwrite
-    };
-
     /// @brief Aero controller node,
     /// has AeroUpperController and AeroLowerController
+    /// created from ~boards (AeroBusConfig.hh)
     class AeroControllerNode
     {
-      /// @brief constructor
+      /// @brief constructor, throws std::runtime_error
+      ///   if ~boards is invalid or has boards other than upper and lower
       /// @param _nh Node handle
-      /// @param _port_upper Upper body USB port file name
-      /// @param _port_lower Lower body USB port file name
+      /// @param _port_upper Upper body USB port file name,
+      ///   used if ~boards is not set
+      /// @param _port_lower Lower body USB port file name,
+      ///   used if ~boards is not set
     public:
       explicit AeroControllerNode(const ros::NodeHandle& _nh,
 				  const std::string& _port_upper,
@@ -108,20 +115,9 @@ namespace aero
     // private: void GoVelocityCallback(
     //     const geometry_msgs::Twist::ConstPtr& _msg);
 
-      /// @brief joint tracjectory threads created from callback
-      /// @param _interpolaiton information on how to interpolate
-      /// @param _stroke_trajectory information of trajectory
-      /// @param _trajectory_start_from skips trajectory
-      /// @param _split_start_from skips split for first trajectory
-      /// @param _factor current speed factor (for speed overwrite)
-    private: void JointTrajectoryThread(
-        std::vector<aero::interpolation::InterpolationPtr> _interpolation,
-        std::vector<std::pair<std::vector<int16_t>, uint16_t> > _stroke_trajectory,
-        int _trajectory_start_from,
-        int _split_start_from, float _factor=1.0f);
-
-    private: void LowerTrajectoryThread(
-        std::vector<std::pair<std::vector<int16_t>, uint16_t> > _stroke_trajectory);
+      /// @brief runs trajectories of upper and lower executors
+      ///   frame by frame, sleeps while both are empty
+    private: void ExecutorThread();
 
       /// @brief subscribe joint tracjectory
       /// @param _msg joint trajectory
@@ -140,6 +136,10 @@ namespace aero
       /// whether trajectories are in action or not.
     private: void PublishInAction(const ros::TimerEvent& event);
 
+      /// @brief publish bus health of upper and lower to /diagnostics
+      /// @param _event timer event
+    private: void PublishDiagnostics(const ros::TimerEvent& _event);
+
       /// @brief subscribe wheel servo message
       /// @param _msg true: on, false :off
     private: void WheelServoCallback(
@@ -185,9 +185,9 @@ namespace aero
         aero_startup::GraspControl::Request& _req,
         aero_startup::GraspControl::Response& _res);
 
-    private: AeroUpperController upper_;
+    private: std::shared_ptr<AeroUpperController> upper_;
 
-    private: AeroLowerController lower_;
+    private: std::shared_ptr<AeroLowerController> lower_;
 
     private: ros::NodeHandle nh_;
 
@@ -221,6 +221,8 @@ namespace aero
 
     private: ros::Publisher in_action_pub_;
 
+    private: ros::Publisher diagnostics_pub_;
+
     private: ros::Subscriber status_reset_sub_;
 
     private: ros::Subscriber collision_mode_set_sub_;
@@ -239,33 +241,41 @@ namespace aero
 
     private: std::mutex mtx_lower_;
 
-      /// @brief saved interpolation settings
-    private: std::vector<aero::interpolation::InterpolationPtr> interpolation_;
+      /// @brief saved interpolation settings, compiled curves
+    private: std::vector<aero::interpolation::Interpolation> interpolation_;
 
     private: std::mutex mtx_intrpl_;
 
-      /// @brief info of on-going threads moving the upper body
-      ///   used to kill threads when interfered
-      ///   JointStateOnce does not update current position while threads > 0
-    private: std::vector<thread_info> registered_threads_;
+      /// @brief frame period at startup[csec],
+      ///   used while ~frame_period is not valid
+    private: float frame_period_;
+
+      /// @brief trajectories moving the upper body,
+      ///   JointStateOnce does not update current position while not empty
+    private: TrajectoryExecutor upper_executor_;
 
-      /// @brief thread id count (increments every time new thread is created)
-      ///   used for applying thread id to new thread
-    private: uint global_thread_cnt_;
+      /// @brief trajectories moving the lower body
+    private: TrajectoryExecutor lower_executor_;
 
-    private: std::mutex mtx_threads_;
+      /// @brief guards executors, paused_, executor_running_ and bus times,
+      ///   never held during bus commands
+    private: std::mutex mtx_executor_;
 
-      /// @brief info of killed thread moving the upper body
-      ///   used to copy and re-split threads when interfered
-    private: std::vector<killed_thread_info> thread_graveyard_;
+      /// @brief notified when a trajectory is accepted or node stops
+    private: std::condition_variable executor_cv_;
 
-    private: std::mutex mtx_thread_graveyard_;
+    private: bool executor_running_;
 
-    private: std::mutex mtx_lower_thread_;
+    private: std::thread executor_thread_;
 
-    private: thread_info lower_thread_;
+      /// @brief mean time from frame sent to reply of upper board[ns]
+    private: int64_t upper_bus_ns_;
 
-    private: killed_thread_info lower_killed_thread_info_;
+      /// @brief mean time from frame sent to reply of lower board[ns]
+    private: int64_t lower_bus_ns_;
+
+      /// @brief frame period of last frame[csec]
+    private: float executor_period_;
 
       // @brief wether sendJoints is active or not
     private: bool send_joints_status_;
@@ -274,6 +284,13 @@ namespace aero
 
     private: ros::Timer in_action_timer_;
 
+    private: ros::Timer diagnostics_timer_;
+
+      /// @brief bus counters at last PublishDiagnostics
+    private: SEEDBusStats last_bus_stats_upper_;
+
+    private: SEEDBusStats last_bus_stats_lower_;
+
       /// @brief 0:no abort, 1:abort and reset, 2:abort but external reset 
     private: int collision_abort_mode_;
 
@@ -287,9 +304,8 @@ namespace aero
 
     private: ros::Subscriber speed_overwrite_sub_;
 
-    private: std::mutex mtx_thread_postpone_;
-
-    private: bool thread_postpone_;
+      /// @brief trajectories are held by speed overwrite 0.0
+    private: bool paused_;
 
     private: void SpeedOverwriteCallback(
 	const std_msgs::Float32::ConstPtr& _msg);
@@ -1,5 +1,9 @@
 #include "AeroControllerProto.hh"
 
+#include <cerrno>
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+
 using namespace boost::asio;
 using namespace aero;
 using namespace controller;
@@ -7,27 +11,101 @@ using namespace controller;
 //////////////////////////////////////////////////
 SEED485Controller::SEED485Controller(
     const std::string& _port, uint8_t _id) :
-  ser_(io_), verbose_(false), id_(_id)
+  ser_(io_), port_(_port), id_(_id), debug_(false), connected_(false),
+  reconnect_enabled_(true), stopping_(false), verbose_(false),
+  rx_pending_(NULL),
+  rx_head_(0), rx_count_(0), writing_(false), writing_lane_(0),
+  in_flight_count_(0), max_in_flight_(4), sequence_(0),
+  timeout_timer_(io_), timeout_armed_(false),
+  drain_timer_(io_), drain_armed_(false), read_timeout_ms_(100)
 {
+  for (size_t i = 0; i < SEED_MAX_IN_FLIGHT; ++i)
+    in_flight_[i].active = false;
+  for (size_t lane = 0; lane < SEED_LANES; ++lane) {
+    tx_head_[lane] = 0;
+    tx_count_[lane] = 0;
+  }
+
   if (_port == "") {
     std::cerr << "empty serial port name: entering debug mode...\n";
     // verbose_ = true;
+    debug_ = true;
     return;
   }
 
-  boost::system::error_code err;
-
-  ser_.open(_port, err);
-  usleep(1000 * 1000);
-
-  if (err) {
-    std::cerr << "could not open " << _port << "\n";
+  if (!open_port_()) {
+    std::cerr << "Proto: ERROR: could not open " << _port
+              << ", entering debug mode" << std::endl;
     // verbose_ = true;
+    debug_ = true;
     return;
   }
+  connected_ = true;
+
+  // reads and writes are handled by asio in io_thread_
+  work_.reset(new io_service::work(io_));
+  start_read_();
+  io_thread_ = boost::thread([this]() { io_.run(); });
+  reconnect_thread_ = boost::thread([this]() { reconnect_(); });
+
+  // board is ready when it answers, not after a fixed sleep
+  if (!probe_(SEED_READY_TIMEOUT))
+    std::cerr << "Proto: ERROR: no reply from " << _port << std::endl;
+}
+
+//////////////////////////////////////////////////
+SEED485Controller::~SEED485Controller()
+{
+  if (debug_) return;
+
+  stop_reconnect();
+
+  // let queued commands go out
+  {
+    boost::mutex::scoped_lock lock(io_mtx_);
+    boost::system_time deadline = boost::get_system_time()
+      + boost::posix_time::milliseconds(read_timeout_ms_);
+    while (connected_ && tx_count_[SEED_LANE_SAFETY]
+           + tx_count_[SEED_LANE_POSITION] + tx_count_[SEED_LANE_TELEMETRY] > 0)
+      if (!tx_cond_.timed_wait(lock, deadline)) break;
+  }
+
+  // close in io thread, pending read finishes with operation_aborted
+  io_.post([this]() {
+      {
+        boost::mutex::scoped_lock lock(io_mtx_);
+        connected_ = false;
+      }
+      boost::system::error_code err;
+      timeout_timer_.cancel(err);
+      drain_timer_.cancel(err);
+      ser_.close(err);
+    });
+  work_.reset();
+  if (io_thread_.joinable()) io_thread_.join();
+
+  // nobody will reply anymore
+  for (size_t i = 0; i < SEED_MAX_IN_FLIGHT; ++i)
+    if (in_flight_[i].active && in_flight_[i].callback)
+      in_flight_[i].callback(NULL);
+  for (size_t lane = 0; lane < SEED_LANES; ++lane)
+    for (size_t i = 0; i < tx_count_[lane]; ++i) {
+      SEEDTransaction& tx =
+        tx_queue_[lane][(tx_head_[lane] + i) % SEED_TX_QUEUE];
+      if (tx.callback) tx.callback(NULL);
+    }
+}
+
+//////////////////////////////////////////////////
+bool SEED485Controller::open_port_()
+{
+  boost::system::error_code err;
+
+  ser_.open(port_, err);
+  if (err) return false;
 
   try {
-    ser_.set_option(serial_port_base::baud_rate(1000000));
+    ser_.set_option(serial_port_base::baud_rate(SEED_BAUD_RATE));
 //     struct termios tio;
 // #if ((BOOST_VERSION / 100 % 1000) > 50)
 //     ::tcgetattr(ser_.lowest_layer().native_handle(), &tio);
@@ -56,12 +134,168 @@ SEED485Controller::SEED485Controller(
   } catch (std::exception& e) {
     std::cerr << e.what() << "\n";
   }
+
+  return true;
 }
 
 //////////////////////////////////////////////////
-SEED485Controller::~SEED485Controller()
+bool SEED485Controller::probe_(int _timeout_ms)
+{
+  std::vector<uint8_t> data(6);
+  data[0] = 0xFD;
+  data[1] = 0xDF;
+  data[2] = 0x02;
+  data[3] = CMD_GET_VERSION;
+  data[4] = 0x00;
+  data[5] = seed_checksum(&data[0], data.size());
+
+  std::chrono::steady_clock::time_point start =
+    std::chrono::steady_clock::now();
+  std::vector<uint8_t> reply;
+  // each try waits read_timeout_ms_ for reply
+  while (!request_(data, CMD_GET_VERSION, reply)) {
+    if (!is_connected() || std::chrono::steady_clock::now() - start
+        >= std::chrono::milliseconds(_timeout_ms))
+      return false;
+  }
+
+  boost::mutex::scoped_lock lock(io_mtx_);
+  stats_.ready_time = std::chrono::duration_cast<std::chrono::microseconds>(
+      std::chrono::steady_clock::now() - start).count();
+  return true;
+}
+
+//////////////////////////////////////////////////
+void SEED485Controller::lose_port_(const boost::system::error_code& _err)
+{
+  std::vector<SEEDReplyCallback> callbacks;
+  {
+    boost::mutex::scoped_lock lock(io_mtx_);
+    if (!connected_) return;
+    std::cerr << "Proto: ERROR: lost " << port_ << ": " << _err.message()
+              << std::endl;
+    connected_ = false;
+    ++stats_.disconnects;
+    lost_time_ = std::chrono::steady_clock::now();
+
+    // nothing will be written or replied until reconnect
+    for (size_t i = 0; i < SEED_MAX_IN_FLIGHT; ++i)
+      if (in_flight_[i].active) {
+        callbacks.push_back(nullptr);
+        callbacks.back().swap(in_flight_[i].callback);
+        in_flight_[i].active = false;
+      }
+    in_flight_count_ = 0;
+    // head being written is popped by handle_write_
+    for (size_t lane = 0; lane < SEED_LANES; ++lane) {
+      size_t keep = (writing_ && lane == writing_lane_) ? 1 : 0;
+      for (size_t i = keep; i < tx_count_[lane]; ++i) {
+        SEEDTransaction& tx =
+          tx_queue_[lane][(tx_head_[lane] + i) % SEED_TX_QUEUE];
+        callbacks.push_back(nullptr);
+        callbacks.back().swap(tx.callback);
+      }
+      tx_count_[lane] = std::min(tx_count_[lane], keep);
+    }
+
+    boost::system::error_code err;
+    timeout_timer_.cancel(err);
+    drain_timer_.cancel(err);
+    ser_.close(err);
+    tx_cond_.notify_all();
+    reconnect_cond_.notify_all();
+  }
+
+  for (size_t i = 0; i < callbacks.size(); ++i)
+    if (callbacks[i]) callbacks[i](NULL);
+}
+
+//////////////////////////////////////////////////
+void SEED485Controller::reconnect_()
 {
-  if (ser_.is_open()) ser_.close();
+  boost::mutex::scoped_lock lock(io_mtx_);
+  while (!stopping_) {
+    if (connected_ || !reconnect_enabled_) {
+      reconnect_cond_.wait(lock);
+      continue;
+    }
+
+    // wait before each try, device may take time to come back
+    reconnect_cond_.timed_wait(
+        lock, boost::posix_time::milliseconds(SEED_RECONNECT_INTERVAL));
+    if (stopping_ || connected_ || !reconnect_enabled_) continue;
+
+    // io thread does not touch ser_ while not connected
+    lock.unlock();
+    bool opened = open_port_();
+    lock.lock();
+    if (!opened) continue;
+
+    decoder_.clear();
+    rx_head_ = 0;
+    rx_count_ = 0;
+    wire_free_ = std::chrono::steady_clock::now();
+    connected_ = true;
+    lock.unlock();
+
+    io_.post(boost::bind(&SEED485Controller::start_read_, this));
+    bool ready = probe_(SEED_READY_TIMEOUT);
+
+    lock.lock();
+    if (!ready) {
+      // board does not answer, close and try again
+      lock.unlock();
+      io_.post([this]() {
+          lose_port_(boost::asio::error::make_error_code(
+              boost::asio::error::timed_out));
+        });
+      lock.lock();
+      continue;
+    }
+
+    ++stats_.reconnects;
+    stats_.downtime += std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now() - lost_time_).count();
+    std::cerr << "Proto: reconnected " << port_ << " in "
+              << stats_.ready_time << " us" << std::endl;
+    std::function<void()> callback = reconnect_callback_;
+    lock.unlock();
+    if (callback) callback();
+    lock.lock();
+  }
+}
+
+//////////////////////////////////////////////////
+bool SEED485Controller::is_connected()
+{
+  boost::mutex::scoped_lock lock(io_mtx_);
+  return connected_;
+}
+
+//////////////////////////////////////////////////
+void SEED485Controller::set_reconnect(bool _enable)
+{
+  boost::mutex::scoped_lock lock(io_mtx_);
+  reconnect_enabled_ = _enable;
+  reconnect_cond_.notify_all();
+}
+
+//////////////////////////////////////////////////
+void SEED485Controller::set_reconnect_callback(std::function<void()> _callback)
+{
+  boost::mutex::scoped_lock lock(io_mtx_);
+  reconnect_callback_ = _callback;
+}
+
+//////////////////////////////////////////////////
+void SEED485Controller::stop_reconnect()
+{
+  {
+    boost::mutex::scoped_lock lock(io_mtx_);
+    stopping_ = true;
+    reconnect_cond_.notify_all();
+  }
+  if (reconnect_thread_.joinable()) reconnect_thread_.join();
 }
 
 //////////////////////////////////////////////////
@@ -84,19 +318,8 @@ std::string SEED485Controller::get_version()
   data[data.size() - 1] =
     ~(reinterpret_cast<uint8_t*>(&b_check_sum)[0]);
 
-  send_data(data);
-
   std::vector<uint8_t> dat;
-  dat.resize(11);
-  read(dat, 11);
-  uint16_t header = decode_short_(&dat[0]);
-  int16_t cmd;
-  uint8_t* bvalue = reinterpret_cast<uint8_t*>(&cmd);
-  bvalue[0] = dat[3];
-  bvalue[1] = 0x00;
-
-  if (header != 0xdffd || cmd != CMD_GET_VERSION) {
-    flush();
+  if (!request_(data, CMD_GET_VERSION, dat) || dat.size() < 11) {
     std::cerr << "Proto: ERROR: invalid header" << std::endl;
     return "";
   }
@@ -119,6 +342,20 @@ std::string SEED485Controller::get_version()
 //////////////////////////////////////////////////
 float SEED485Controller::get_voltage()
 {
+  float voltage = 0;
+  get_voltage_async(&voltage).get();
+
+  //std::cout << "Voltage is " << voltage << " [V]" << std::endl;
+
+  return voltage;
+}
+
+//////////////////////////////////////////////////
+std::shared_future<bool> SEED485Controller::get_voltage_async(float* _voltage)
+{
+  std::shared_ptr<std::promise<bool> > done(new std::promise<bool>());
+  std::shared_future<bool> result = done->get_future().share();
+
   std::vector<uint8_t> data(6);
   data[0] = 0xFD;
   data[1] = 0xDF;
@@ -136,28 +373,37 @@ float SEED485Controller::get_voltage()
   data[data.size() - 1] =
     ~(reinterpret_cast<uint8_t*>(&b_check_sum)[0]);
 
-  send_data(data);
-
-  std::vector<uint8_t> dat;
-  dat.resize(8);
-  read(dat, 8);
-  uint16_t header = decode_short_(&dat[0]);
-  int16_t cmd;
-  uint8_t* bvalue = reinterpret_cast<uint8_t*>(&cmd);
-  bvalue[0] = dat[3];
-  bvalue[1] = 0x00;
+  send_data(data, CMD_GET_TMP_VOLT,
+            [done, _voltage](const SEEDFrame* _frame) {
+      if (!_frame || _frame->length < 8) {
+        //std::cerr << "Proto: ERROR: invalid header" << std::endl;
+        *_voltage = 0;
+        done->set_value(false);
+        return;
+      }
+      const uint8_t* dat = _frame->data;
+      *_voltage = static_cast<uint16_t>((dat[RAW_HEADER_OFFSET] << 8) + dat[RAW_HEADER_OFFSET + 1]) * 0.1;
+      done->set_value(true);
+    });
 
-  if (header != 0xdffd || cmd != CMD_GET_TMP_VOLT) {
-    flush();
-    //std::cerr << "Proto: ERROR: invalid header" << std::endl;
-    return 0;
-  }
+  return result;
+}
 
-  float voltage = static_cast<uint16_t>((dat[RAW_HEADER_OFFSET] << 8) + dat[RAW_HEADER_OFFSET + 1]) * 0.1;
+//////////////////////////////////////////////////
+bool SEED485Controller::request_(std::vector<uint8_t>& _send_data,
+                                 uint8_t _reply_cmd,
+                                 std::vector<uint8_t>& _reply)
+{
+  std::shared_ptr<std::promise<bool> > done(new std::promise<bool>());
+  std::future<bool> result = done->get_future();
 
-  //std::cout << "Voltage is " << voltage << " [V]" << std::endl;
+  send_data(_send_data, _reply_cmd, [done, &_reply](const SEEDFrame* _frame) {
+      if (_frame)
+        _reply.assign(_frame->data, _frame->data + _frame->length);
+      done->set_value(_frame != NULL);
+    });
 
-  return voltage;
+  return result.get();
 }
 
 //////////////////////////////////////////////////
@@ -165,29 +411,29 @@ void SEED485Controller::read(std::vector<uint8_t>& _read_data, const size_t _len
 {
   _read_data.resize(_length);
 
-  auto error_code = boost::system::error_code{};
-  int size = 0;
-  if (ser_.is_open()) {
-    boost::mutex::scoped_lock lock(mtx_);
-    while(size < _length) {
-      usleep(100); // sleep 100 us
-      int size_read;
-      std::vector<uint8_t> read_buffer(_length);
-      size_read = ser_.read_some(buffer(read_buffer, _length), error_code);
-      if ((size + size_read) <= _length) {
-        std::copy(read_buffer.begin(), read_buffer.begin()+size_read,
-                  _read_data.begin() + size);
-      } else {
-        std::cerr << "Proto: ERROR: data length, size : " << size << ", size_read " << size_read << std::endl;
-        //flush();
-#if ((BOOST_VERSION / 100 % 1000) > 50)
-        ::tcflush(ser_.lowest_layer().native_handle(), TCIOFLUSH);
-#else  // 12.04
-        ::tcflush(ser_.lowest_layer().native(), TCIOFLUSH);
-#endif
-        break;
+  if (!debug_) {
+    boost::mutex::scoped_lock lock(io_mtx_);
+    boost::system_time deadline = boost::get_system_time()
+      + boost::posix_time::milliseconds(read_timeout_ms_);
+    while (rx_count_ == 0)
+      if (!rx_cond_.timed_wait(lock, deadline)) break;
+
+    if (rx_count_ > 0) {
+      const SEEDFrame& frame = rx_frames_[rx_head_];
+      size_t size = std::min(frame.length, _length);
+      std::copy(frame.data, frame.data + size, _read_data.begin());
+      std::fill(_read_data.begin() + size, _read_data.end(), 0);
+      if (frame.length != _length) {
+        ++stats_.short_reads;
+        std::cerr << "Proto: ERROR: data length, expected : " << _length
+                  << ", frame " << frame.length << std::endl;
       }
-      size += size_read;
+      rx_head_ = (rx_head_ + 1) % SEED_RX_FRAME_QUEUE;
+      --rx_count_;
+    } else {
+      ++stats_.read_timeouts;
+      std::fill(_read_data.begin(), _read_data.end(), 0);
+      std::cerr << "Proto: ERROR: read timeout" << std::endl;
     }
   }
 
@@ -203,6 +449,318 @@ void SEED485Controller::read(std::vector<uint8_t>& _read_data, const size_t _len
   }
 }
 
+//////////////////////////////////////////////////
+void SEED485Controller::set_max_in_flight(size_t _num)
+{
+  boost::mutex::scoped_lock lock(io_mtx_);
+  // keep a slot for safety commands
+  max_in_flight_ =
+    std::max<size_t>(1, std::min(_num, SEED_MAX_IN_FLIGHT - 1));
+}
+
+//////////////////////////////////////////////////
+uint64_t SEED485Controller::safety_latency_bound()
+{
+  boost::mutex::scoped_lock lock(io_mtx_);
+  // other lanes stop at SEED_TX_BACKLOG plus the frame written then
+  uint64_t bytes = SEED_TX_BACKLOG + RAW_DATA_LENGTH
+    + (tx_count_[SEED_LANE_SAFETY] + 1) * RAW_DATA_LENGTH;
+  return bytes * 10 * 1000000 / SEED_BAUD_RATE;
+}
+
+//////////////////////////////////////////////////
+void SEED485Controller::count_short_read()
+{
+  boost::mutex::scoped_lock lock(io_mtx_);
+  ++stats_.short_reads;
+}
+
+//////////////////////////////////////////////////
+SEEDBusStats SEED485Controller::get_stats()
+{
+  boost::mutex::scoped_lock lock(io_mtx_);
+  SEEDBusStats stats = stats_;
+  stats.checksum_errors = decoder_.checksum_errors;
+  stats.resyncs = decoder_.resyncs;
+  stats.skipped_bytes = decoder_.skipped_bytes;
+  return stats;
+}
+
+//////////////////////////////////////////////////
+bool SEED485Controller::start_capture(const std::string& _path, size_t _slots)
+{
+  boost::mutex::scoped_lock lock(io_mtx_);
+  return capture_.open(_path, _slots);
+}
+
+//////////////////////////////////////////////////
+void SEED485Controller::stop_capture()
+{
+  boost::mutex::scoped_lock lock(io_mtx_);
+  capture_.close();
+}
+
+//////////////////////////////////////////////////
+bool SEED485Controller::set_io_scheduling(int _cpu, int _priority)
+{
+  if (!io_thread_.joinable()) return true;  // debug mode
+  return set_thread_scheduling(io_thread_.native_handle(), _cpu, _priority);
+}
+
+//////////////////////////////////////////////////
+void SEED485Controller::start_read_()
+{
+  size_t space;
+  {
+    boost::mutex::scoped_lock lock(io_mtx_);
+    rx_pending_ = decoder_.prepare(space);
+  }
+  ser_.async_read_some(
+      buffer(rx_pending_, space),
+      boost::bind(&SEED485Controller::handle_read_, this,
+                  boost::asio::placeholders::error,
+                  boost::asio::placeholders::bytes_transferred));
+}
+
+//////////////////////////////////////////////////
+void SEED485Controller::handle_read_(
+    const boost::system::error_code& _err, size_t _bytes)
+{
+  if (_err) {
+    // device gone (USB reset, unplug), reconnect_ reopens it
+    if (_err != boost::asio::error::operation_aborted) lose_port_(_err);
+    return;
+  }
+
+  boost::mutex::scoped_lock lock(io_mtx_);
+  decoder_.commit(rx_pending_, _bytes);
+  stats_.bytes_received += _bytes;
+
+  bool received = false;
+  bool replied = false;
+  while (decoder_.next(rx_frame_)) {
+    ++stats_.frames_received;
+    capture_.record(SEED_CAPTURE_RX, rx_frame_.data, rx_frame_.length);
+
+    // hand frame to oldest command waiting for it
+    SEEDPendingReply* pending = NULL;
+    for (size_t i = 0; i < SEED_MAX_IN_FLIGHT; ++i)
+      if (in_flight_[i].active
+          && in_flight_[i].reply_cmd == rx_frame_.cmd()
+          && (!pending || in_flight_[i].sequence < pending->sequence))
+        pending = &in_flight_[i];
+
+    if (pending) {
+      stats_.add_latency(std::chrono::duration_cast<std::chrono::microseconds>(
+          std::chrono::steady_clock::now() - pending->sent).count());
+      SEEDReplyCallback callback;
+      callback.swap(pending->callback);
+      pending->active = false;
+      --in_flight_count_;
+      replied = true;
+      // rx_frame_ is only touched in this thread
+      lock.unlock();
+      if (callback) callback(&rx_frame_);
+      lock.lock();
+      continue;
+    }
+
+    // not a reply, keep it for read, oldest frame is dropped if full
+    ++stats_.unmatched_frames;
+    rx_frames_[(rx_head_ + rx_count_) % SEED_RX_FRAME_QUEUE] = rx_frame_;
+    if (rx_count_ == SEED_RX_FRAME_QUEUE)
+      rx_head_ = (rx_head_ + 1) % SEED_RX_FRAME_QUEUE;
+    else
+      ++rx_count_;
+    received = true;
+  }
+  if (received) rx_cond_.notify_all();
+  lock.unlock();
+
+  // replies make room for next commands
+  if (replied) try_write_();
+
+  start_read_();
+}
+
+//////////////////////////////////////////////////
+void SEED485Controller::try_write_()
+{
+  boost::mutex::scoped_lock lock(io_mtx_);
+  if (writing_ || !connected_) return;
+
+  for (size_t lane = 0; lane < SEED_LANES; ++lane) {
+    if (tx_count_[lane] == 0) continue;
+    SEEDTransaction& tx = tx_queue_[lane][tx_head_[lane]];
+
+    // too many commands waiting, wait for reply or timeout,
+    // safety commands may use slots kept free by max_in_flight_
+    size_t limit =
+      (lane == SEED_LANE_SAFETY ? SEED_MAX_IN_FLIGHT : max_in_flight_);
+    if (tx.reply_cmd != 0 && in_flight_count_ >= limit) continue;
+
+    // a safety command must not wait behind frames in the driver
+    if (lane != SEED_LANE_SAFETY && !backlog_drained_()) return;
+
+    if (tx.reply_cmd != 0) {
+      for (size_t i = 0; i < SEED_MAX_IN_FLIGHT; ++i)
+        if (!in_flight_[i].active) {
+          SEEDPendingReply& pending = in_flight_[i];
+          pending.active = true;
+          pending.reply_cmd = tx.reply_cmd;
+          pending.callback.swap(tx.callback);
+          pending.deadline =
+            boost::posix_time::microsec_clock::universal_time()
+            + boost::posix_time::milliseconds(read_timeout_ms_);
+          pending.sequence = sequence_++;
+          pending.sent = std::chrono::steady_clock::now();
+          ++in_flight_count_;
+          break;
+        }
+      arm_timeout_();
+    }
+
+    capture_.record(SEED_CAPTURE_TX, tx.frame.data, tx.frame.length);
+    std::chrono::steady_clock::time_point now =
+      std::chrono::steady_clock::now();
+    wire_free_ = std::max(wire_free_, now) + std::chrono::microseconds(
+        tx.frame.length * 10 * 1000000 / SEED_BAUD_RATE);
+    writing_ = true;
+    writing_lane_ = lane;
+    async_write(ser_, buffer(tx.frame.data, tx.frame.length),
+                boost::bind(&SEED485Controller::handle_write_, this,
+                            boost::asio::placeholders::error,
+                            boost::asio::placeholders::bytes_transferred));
+    return;
+  }
+}
+
+//////////////////////////////////////////////////
+void SEED485Controller::handle_write_(
+    const boost::system::error_code& _err, size_t _bytes)
+{
+  {
+    boost::mutex::scoped_lock lock(io_mtx_);
+    size_t lane = writing_lane_;
+    SEEDTransaction& tx = tx_queue_[lane][tx_head_[lane]];
+    if (!_err) {
+      ++stats_.frames_sent;
+      stats_.bytes_sent += _bytes;
+      ++stats_.lane_frames[lane];
+      uint64_t wait = std::chrono::duration_cast<std::chrono::microseconds>(
+          std::chrono::steady_clock::now() - tx.queued).count();
+      stats_.lane_wait_max[lane] = std::max(stats_.lane_wait_max[lane], wait);
+    }
+    tx.callback = nullptr;
+    tx_head_[lane] = (tx_head_[lane] + 1) % SEED_TX_QUEUE;
+    --tx_count_[lane];
+    writing_ = false;
+    tx_cond_.notify_all();
+  }
+
+  if (_err && _err != boost::asio::error::operation_aborted) {
+    std::cerr << "Proto: ERROR: write " << _err.message() << std::endl;
+    lose_port_(_err);
+  }
+
+  // nothing is written after port is lost or closed
+  try_write_();
+}
+
+//////////////////////////////////////////////////
+bool SEED485Controller::backlog_drained_()
+{
+  // bytes not on the wire yet, by link rate since last writes,
+  // or by driver if it knows (a pty always reports 0)
+  std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+  int64_t queued = 0;
+  if (wire_free_ > now)
+    queued = std::chrono::duration_cast<std::chrono::microseconds>(
+        wire_free_ - now).count() * SEED_BAUD_RATE / (10 * 1000000);
+  int driver = 0;
+#if ((BOOST_VERSION / 100 % 1000) > 50)
+  int fd = ser_.lowest_layer().native_handle();
+#else  // 12.04
+  int fd = ser_.lowest_layer().native();
+#endif
+  if (::ioctl(fd, TIOCOUTQ, &driver) == 0)
+    queued = std::max<int64_t>(queued, driver);
+  if (queued <= static_cast<int64_t>(SEED_TX_BACKLOG)) return true;
+
+  // retry when the bytes above backlog are written, 10 bits per byte
+  if (!drain_armed_) {
+    drain_armed_ = true;
+    drain_timer_.expires_from_now(boost::posix_time::microseconds(
+        (queued - SEED_TX_BACKLOG) * 10 * 1000000 / SEED_BAUD_RATE + 1));
+    drain_timer_.async_wait(
+        boost::bind(&SEED485Controller::handle_drain_, this,
+                    boost::asio::placeholders::error));
+  }
+  return false;
+}
+
+//////////////////////////////////////////////////
+void SEED485Controller::handle_drain_(const boost::system::error_code& _err)
+{
+  {
+    boost::mutex::scoped_lock lock(io_mtx_);
+    drain_armed_ = false;
+  }
+  if (_err == boost::asio::error::operation_aborted) return;
+
+  try_write_();
+}
+
+//////////////////////////////////////////////////
+void SEED485Controller::arm_timeout_()
+{
+  if (timeout_armed_ || in_flight_count_ == 0) return;
+
+  // oldest command has earliest deadline
+  SEEDPendingReply* oldest = NULL;
+  for (size_t i = 0; i < SEED_MAX_IN_FLIGHT; ++i)
+    if (in_flight_[i].active
+        && (!oldest || in_flight_[i].sequence < oldest->sequence))
+      oldest = &in_flight_[i];
+
+  timeout_armed_ = true;
+  timeout_timer_.expires_at(oldest->deadline);
+  timeout_timer_.async_wait(
+      boost::bind(&SEED485Controller::handle_timeout_, this,
+                  boost::asio::placeholders::error));
+}
+
+//////////////////////////////////////////////////
+void SEED485Controller::handle_timeout_(const boost::system::error_code& _err)
+{
+  if (_err == boost::asio::error::operation_aborted) return;
+
+  size_t expired = 0;
+  {
+    boost::mutex::scoped_lock lock(io_mtx_);
+    timeout_armed_ = false;
+    boost::posix_time::ptime now =
+      boost::posix_time::microsec_clock::universal_time();
+    for (size_t i = 0; i < SEED_MAX_IN_FLIGHT; ++i)
+      if (in_flight_[i].active && in_flight_[i].deadline <= now) {
+        expired_[expired++].swap(in_flight_[i].callback);
+        ++stats_.reply_timeouts;
+        in_flight_[i].active = false;
+        --in_flight_count_;
+      }
+    arm_timeout_();
+  }
+
+  if (expired > 0)
+    std::cerr << "Proto: ERROR: reply timeout" << std::endl;
+  for (size_t i = 0; i < expired; ++i) {
+    if (expired_[i]) expired_[i](NULL);
+    expired_[i] = nullptr;
+  }
+
+  try_write_();
+}
+
 //////////////////////////////////////////////////
 void SEED485Controller::send_command(
     uint8_t _cmd, uint16_t _time, std::vector<uint8_t>& _send_data)
@@ -214,7 +772,7 @@ void SEED485Controller::send_command(
 void SEED485Controller::send_command(
     uint8_t _cmd, uint8_t _num, uint16_t _data)
 {
-  std::vector<uint8_t> data(8);
+  std::vector<uint8_t> data(RAW_SHORT_COMMAND_LENGTH);
   data[0] = 0xFD;
   data[1] = 0xDF;
   data[2] = 0x04;
@@ -239,6 +797,24 @@ void SEED485Controller::send_command(
 //////////////////////////////////////////////////
 void SEED485Controller::send_command(
     uint8_t _cmd, uint8_t _sub, uint16_t _time, std::vector<uint8_t>& _send_data)
+{
+  fill_command_(_cmd, _sub, _time, _send_data);
+  send_data(_send_data);
+}
+
+//////////////////////////////////////////////////
+void SEED485Controller::send_command(
+    uint8_t _cmd, uint8_t _sub, uint16_t _time,
+    std::vector<uint8_t>& _send_data, SEEDReplyCallback _callback,
+    SEEDLane _lane)
+{
+  fill_command_(_cmd, _sub, _time, _send_data);
+  send_data(_send_data, _cmd, _callback, _lane);
+}
+
+//////////////////////////////////////////////////
+void SEED485Controller::fill_command_(
+    uint8_t _cmd, uint8_t _sub, uint16_t _time, std::vector<uint8_t>& _send_data)
 {
   _send_data[0] = 0xFD;
   _send_data[1] = 0xDF;
@@ -259,8 +835,6 @@ void SEED485Controller::send_command(
 
   _send_data[RAW_DATA_LENGTH - 1] =
     ~(reinterpret_cast<uint8_t*>(&b_check_sum)[0]);
-
-  send_data(_send_data);
 }
 
 //////////////////////////////////////////////////
@@ -281,31 +855,40 @@ void SEED485Controller::AERO_Snd_Script(uint16_t sendnum,uint8_t scriptnum)
   dat[4] = sendnum;  // sendnum
   dat[5] = 0x00;  //
   dat[6] = scriptnum;  // script No.
-  dat[7] = 0xbc;  // checksum
+  dat[7] = seed_checksum(&dat[0], dat.size());  // checksum
   send_data(dat);
 }
 
 //////////////////////////////////////////////////
 void SEED485Controller::flush()
 {
-  if (ser_.is_open()) {
+  if (is_connected()) {
     boost::mutex::scoped_lock lock(mtx_);
 #if ((BOOST_VERSION / 100 % 1000) > 50)
     ::tcflush(ser_.lowest_layer().native_handle(), TCIOFLUSH);
 #else  // 12.04
     ::tcflush(ser_.lowest_layer().native(), TCIOFLUSH);
 #endif
+    // drop bytes and frames already received
+    boost::mutex::scoped_lock io_lock(io_mtx_);
+    decoder_.clear();
+    rx_head_ = 0;
+    rx_count_ = 0;
   }
 }
 
 //////////////////////////////////////////////////
 void SEED485Controller::send_data(std::vector<uint8_t>& _send_data)
 {
-  if (ser_.is_open()) {
-    boost::mutex::scoped_lock lock(mtx_);
-    ser_.write_some(buffer(_send_data));
-  }
+  send_data(_send_data, 0, SEEDReplyCallback());
+}
 
+//////////////////////////////////////////////////
+void SEED485Controller::send_data(std::vector<uint8_t>& _send_data,
+                                  uint8_t _reply_cmd,
+                                  SEEDReplyCallback _callback,
+                                  SEEDLane _lane)
+{
   if (verbose_) {
     std::cout << "send: ";
     for (size_t i = 0; i < _send_data.size(); ++i) {
@@ -315,19 +898,61 @@ void SEED485Controller::send_data(std::vector<uint8_t>& _send_data)
     }
     std::cout << "\n";
   }
-}
 
+  if (debug_ || _send_data.size() > RAW_DATA_LENGTH) {
+    if (!debug_)
+      std::cerr << "Proto: ERROR: command too long "
+                << _send_data.size() << std::endl;
+    if (_callback) _callback(NULL);
+    return;
+  }
+
+  {
+    size_t lane = _lane;
+    if (_lane == SEED_LANES)
+      lane = _send_data.size() > 4 ?
+        seed_lane(_send_data[3], _send_data[4]) : SEED_LANE_POSITION;
+
+    // each lane is bounded, wait for io thread to make room,
+    // a full position lane does not block safety commands
+    boost::mutex::scoped_lock lock(io_mtx_);
+    while (connected_ && tx_count_[lane] == SEED_TX_QUEUE)
+      tx_cond_.wait(lock);
+
+    // port lost, fail now instead of waiting for reconnect
+    if (!connected_) {
+      lock.unlock();
+      if (_callback) _callback(NULL);
+      return;
+    }
+
+    SEEDTransaction& tx =
+      tx_queue_[lane][(tx_head_[lane] + tx_count_[lane]) % SEED_TX_QUEUE];
+    std::copy(_send_data.begin(), _send_data.end(), tx.frame.data);
+    tx.frame.length = _send_data.size();
+    tx.reply_cmd = _callback ? _reply_cmd : 0;
+    tx.callback = _callback;
+    tx.queued = std::chrono::steady_clock::now();
+    ++tx_count_[lane];
+  }
+
+  io_.post(boost::bind(&SEED485Controller::try_write_, this));
+}
 
 //////////////////////////////////////////////////
 AeroControllerProto::AeroControllerProto(const std::string& _port,
 					 uint8_t _id) :
-  seed_(_port, _id), verbose_(false), bad_status_(false)
+  seed_(_port, _id), verbose_(false), bad_status_(false),
+  servo_state_(-1)
 {
+  seed_.set_reconnect_callback([this]() { restore_(); });
 }
 
 //////////////////////////////////////////////////
 AeroControllerProto::~AeroControllerProto()
 {
+  // restore_ uses members destroyed before seed_
+  seed_.stop_reconnect();
 }
 
 //////////////////////////////////////////////////
@@ -342,6 +967,13 @@ float AeroControllerProto::get_voltage()
   return seed_.get_voltage();
 }
 
+//////////////////////////////////////////////////
+std::shared_future<bool> AeroControllerProto::get_voltage_async(
+    float* _voltage)
+{
+  return seed_.get_voltage_async(_voltage);
+}
+
 //////////////////////////////////////////////////
 void AeroControllerProto::servo_on()
 {
@@ -357,27 +989,34 @@ void AeroControllerProto::servo_off()
 //////////////////////////////////////////////////
 void AeroControllerProto::servo_command(int16_t _d0)
 {
-  boost::mutex::scoped_lock lock(ctrl_mtx_);
-
-  std::vector<int16_t> stroke_vector(stroke_joint_indices_.size(), _d0);
-
   std::vector<uint8_t> dat(RAW_DATA_LENGTH);
+  {
+    boost::mutex::scoped_lock lock(ctrl_mtx_);
+    servo_state_ = _d0;
+
+    std::vector<int16_t> stroke_vector(stroke_joint_indices_.size(), _d0);
 
-  stroke_to_raw_(stroke_vector, dat);
+    stroke_to_raw_(stroke_vector, dat);
+  }
 
+  // safety lane, written before queued position commands
   seed_.send_command(CMD_MOTOR_SRV, 0, dat);
 }
 
 //////////////////////////////////////////////////
 std::vector<int16_t> AeroControllerProto::get_reference_stroke_vector()
 {
-  return stroke_ref_vector_;
+  AeroStrokeSnapshot strokes = strokes_.load();
+  return std::vector<int16_t>(strokes.reference,
+                              strokes.reference + strokes.size);
 }
 
 //////////////////////////////////////////////////
 std::vector<int16_t> AeroControllerProto::get_actual_stroke_vector()
 {
-  return stroke_cur_vector_;
+  // replies are decoded from io thread, snapshot does not wait for them
+  AeroStrokeSnapshot strokes = strokes_.load();
+  return std::vector<int16_t>(strokes.actual, strokes.actual + strokes.size);
 }
 
 //////////////////////////////////////////////////
@@ -408,6 +1047,26 @@ int32_t AeroControllerProto::get_ordered_angle_id(std::string _name)
   return -1;
 }
 
+//////////////////////////////////////////////////
+void AeroControllerProto::set_stroke_joint_indices(
+    const std::vector<AJointIndex>& _indices)
+{
+  {
+    boost::mutex::scoped_lock lock(ctrl_mtx_);
+    stroke_joint_indices_ = _indices;
+    stroke_vector_.assign(_indices.size(), 0);
+    stroke_ref_vector_.assign(_indices.size(), 0);
+    stroke_cur_vector_.assign(_indices.size(), 0);
+    status_vector_.assign(_indices.size(), 0);
+  }
+
+  get_command(CMD_GET_POS, stroke_cur_vector_);
+  boost::mutex::scoped_lock lock(ctrl_mtx_);
+  stroke_ref_vector_.assign(stroke_cur_vector_.begin(),
+                            stroke_cur_vector_.end());
+  publish_strokes_(false);
+}
+
 //////////////////////////////////////////////////
 bool AeroControllerProto::get_joint_name(int32_t _joint_id, std::string &_name)
 {
@@ -429,6 +1088,7 @@ bool AeroControllerProto::get_status()
 //////////////////////////////////////////////////
 std::vector<int16_t> AeroControllerProto::get_status_vec()
 {
+  boost::mutex::scoped_lock lock(ctrl_mtx_);
   return status_vector_;
 }
 
@@ -440,30 +1100,52 @@ bool AeroControllerProto::get_status(std::vector<bool>& _status_vector)
 }
 
 //////////////////////////////////////////////////
-void AeroControllerProto::update_position()
+bool AeroControllerProto::update_position()
+{
+  return update_position_async().get();
+}
+
+//////////////////////////////////////////////////
+std::shared_future<bool> AeroControllerProto::update_position_async()
 {
   if (seed_.is_debug_mode()) {
     // just return ref_vector in debug mode
+    boost::mutex::scoped_lock lock(ctrl_mtx_);
     stroke_cur_vector_.assign(stroke_ref_vector_.begin(),
                               stroke_ref_vector_.end());
-  } else {
-    //seed_.flush();
-    get_command(CMD_GET_POS, stroke_cur_vector_);
+    publish_strokes_(true);
+    std::promise<bool> done;
+    done.set_value(true);
+    return done.get_future().share();
   }
+  return get_command_async(CMD_GET_POS, 0x00, &stroke_cur_vector_);
 }
 
 //////////////////////////////////////////////////
 void AeroControllerProto::update_status()
 {
-  seed_.flush();
-  get_command(CMD_WATCH_MISSTEP, status_vector_);
+  // reply is matched by command id, no need to flush
+  update_status_async().get();
+}
+
+//////////////////////////////////////////////////
+std::shared_future<bool> AeroControllerProto::update_status_async()
+{
+  return get_command_async(CMD_WATCH_MISSTEP, 0x00, &status_vector_);
+}
+
+//////////////////////////////////////////////////
+bool AeroControllerProto::check_status()
+{
+  get_command_async(CMD_WATCH_MISSTEP, 0x00, &status_vector_,
+                    SEED_LANE_SAFETY).get();
+  return bad_status_;
 }
 
 //////////////////////////////////////////////////
 void AeroControllerProto::reset_status()
 {
-  seed_.flush();
-  get_command(CMD_WATCH_MISSTEP, 0xff, status_vector_);
+  get_command(CMD_WATCH_MISSTEP, SUB_RESET_STATUS, status_vector_);
 }
 
 //////////////////////////////////////////////////
@@ -472,6 +1154,13 @@ void AeroControllerProto::get_current(std::vector<int16_t>& _stroke_vector)
   get_command(CMD_GET_CUR, _stroke_vector);
 }
 
+//////////////////////////////////////////////////
+std::shared_future<bool> AeroControllerProto::get_current_async(
+    std::vector<int16_t>* _stroke_vector)
+{
+  return get_command_async(CMD_GET_CUR, 0x00, _stroke_vector);
+}
+
 //////////////////////////////////////////////////
 void AeroControllerProto::get_temperature(
     std::vector<int16_t>& _stroke_vector)
@@ -479,6 +1168,13 @@ void AeroControllerProto::get_temperature(
   get_command(CMD_GET_TMP_VOLT, _stroke_vector);
 }
 
+//////////////////////////////////////////////////
+std::shared_future<bool> AeroControllerProto::get_temperature_async(
+    std::vector<int16_t>* _stroke_vector)
+{
+  return get_command_async(CMD_GET_TMP_VOLT, 0x00, _stroke_vector);
+}
+
 //////////////////////////////////////////////////
 void AeroControllerProto::get_data(std::vector<int16_t>& _stroke_vector)
 {
@@ -488,17 +1184,33 @@ void AeroControllerProto::get_data(std::vector<int16_t>& _stroke_vector)
   seed_.read(dat);
 
   uint16_t header = decode_short_(&dat[0]);
-  int16_t cmd;
-  uint8_t* bvalue = reinterpret_cast<uint8_t*>(&cmd);
-  bvalue[0] = dat[3];
-  bvalue[1] = 0x00;
 
+  // frames are already split by header and checksum,
+  // no header means read timed out and nothing is left to flush
   if (header != 0xdffd) {
-    seed_.flush();
     std::cerr << "Proto: ERROR: invalid header" << std::endl;
     return;
   }
 
+  // read counts and pads a frame of other length
+  decode_data_(&dat[0], RAW_DATA_LENGTH, _stroke_vector);
+}
+
+//////////////////////////////////////////////////
+bool AeroControllerProto::decode_data_(const uint8_t* _dat, size_t _length,
+                                       std::vector<int16_t>& _stroke_vector)
+{
+  // reply is matched by command byte only,
+  // a short frame of same command must not be decoded
+  if (_length != RAW_DATA_LENGTH) {
+    seed_.count_short_read();
+    std::cerr << "Proto: ERROR: reply length, expected : " << RAW_DATA_LENGTH
+              << ", frame " << _length << std::endl;
+    return false;
+  }
+
+  uint8_t cmd = _dat[3];
+
   if (cmd == CMD_MOVE_ABS_POS ||
       cmd == CMD_MOVE_ABS_POS_RET ||
       cmd == CMD_GET_POS ||
@@ -513,7 +1225,7 @@ void AeroControllerProto::get_data(std::vector<int16_t>& _stroke_vector)
       AJointIndex& aji = stroke_joint_indices_[i];
       // uint8_t -> uint16_t
       _stroke_vector[aji.stroke_index] =
-        decode_short_(&dat[RAW_HEADER_OFFSET + aji.raw_index * 2]);
+        decode_short_(&_dat[RAW_HEADER_OFFSET + aji.raw_index * 2]);
 
       // check value
       if (_stroke_vector[aji.stroke_index] > 0x7fff) {
@@ -526,8 +1238,8 @@ void AeroControllerProto::get_data(std::vector<int16_t>& _stroke_vector)
 
   // if (cmd == CMD_MOVE_ABS || cmd == CMD_WATCH_MISSTEP || cmd == CMD_GET_POS) {
   if (cmd == CMD_WATCH_MISSTEP) {
-    uint8_t status0 = dat[RAW_HEADER_OFFSET + 60];
-    uint8_t status1 = dat[RAW_HEADER_OFFSET + 61];
+    uint8_t status0 = _dat[RAW_HEADER_OFFSET + 60];
+    uint8_t status1 = _dat[RAW_HEADER_OFFSET + 61];
     if ((status0 >> 5) == 1 || (status1 >> 5) == 1) {
       bad_status_ = true;
     } else {
@@ -535,6 +1247,8 @@ void AeroControllerProto::get_data(std::vector<int16_t>& _stroke_vector)
     }
   }
 
+  if (&_stroke_vector == &stroke_cur_vector_) publish_strokes_(true);
+  return true;
 }
 
 //////////////////////////////////////////////////
@@ -548,80 +1262,134 @@ void AeroControllerProto::get_command(uint8_t _cmd,
 void AeroControllerProto::get_command(uint8_t _cmd, uint8_t _sub,
                                       std::vector<int16_t>& _stroke_vector)
 {
-  boost::mutex::scoped_lock lock(ctrl_mtx_);
+  get_command_async(_cmd, _sub, &_stroke_vector).get();
+}
+
+//////////////////////////////////////////////////
+std::shared_future<bool> AeroControllerProto::get_command_async(
+    uint8_t _cmd, uint8_t _sub, std::vector<int16_t>* _stroke_vector,
+    SEEDLane _lane)
+{
+  std::shared_ptr<std::promise<bool> > done(new std::promise<bool>());
+  std::shared_future<bool> result = done->get_future().share();
 
   std::vector<uint8_t> dat(RAW_DATA_LENGTH);
-  seed_.send_command(_cmd, _sub, 0, dat);
-  //usleep(1000 * 20);  // wait
-  get_data(_stroke_vector);
+  // ctrl_mtx_ is not held while waiting, reply locks it to decode
+  seed_.send_command(_cmd, _sub, 0, dat,
+                     [this, done, _stroke_vector](const SEEDFrame* _frame) {
+      bool decoded = false;
+      if (_frame) {
+        boost::mutex::scoped_lock lock(ctrl_mtx_);
+        decoded = decode_data_(_frame->data, _frame->length, *_stroke_vector);
+      }
+      done->set_value(decoded);
+    }, _lane);
+
+  return result;
 }
 
 //////////////////////////////////////////////////
 void AeroControllerProto::set_position(
     std::vector<int16_t>& _stroke_vector, uint16_t _time)
 {
-  boost::mutex::scoped_lock lock(ctrl_mtx_);
+  set_position_async(_stroke_vector, _time).get();
 
-  // for ROS
-  for (size_t i = 0; i < _stroke_vector.size(); ++i) {
-    if (_stroke_vector[i] != 0x7fff) {
-      stroke_ref_vector_[i] = _stroke_vector[i];
-    }
-  }
+  if (seed_.is_debug_mode())
+    usleep(1000 * 20);
+}
+
+//////////////////////////////////////////////////
+std::shared_future<bool> AeroControllerProto::set_position_async(
+    std::vector<int16_t>& _stroke_vector, uint16_t _time, int64_t* _replied)
+{
+  std::shared_ptr<std::promise<bool> > done(new std::promise<bool>());
+  std::shared_future<bool> result = done->get_future().share();
 
-  // for seed
   std::vector<uint8_t> dat(RAW_DATA_LENGTH);
-  stroke_to_raw_(_stroke_vector, dat);
-  //seed_.flush();
-  seed_.send_command(CMD_MOVE_ABS_POS_RET, _time, dat);
+  {
+    boost::mutex::scoped_lock lock(ctrl_mtx_);
 
-  // for ROS
-  if (seed_.is_debug_mode()) {
-    usleep(1000 * 20);
-    // in debug mode, get_data returns before writing stroke vector,
-    // and controller must copy ref_vector into cur_vector
-    stroke_cur_vector_.assign(stroke_ref_vector_.begin(),
-                              stroke_ref_vector_.end());
-  } else {
-    get_data(stroke_cur_vector_);
+    // for ROS
+    for (size_t i = 0; i < _stroke_vector.size(); ++i) {
+      if (_stroke_vector[i] != 0x7fff) {
+        stroke_ref_vector_[i] = _stroke_vector[i];
+      }
+    }
+
+    // for seed, always 68 bytes frame, single commands have no reply
+    stroke_to_raw_(_stroke_vector, dat);
+
+    // for ROS
+    if (seed_.is_debug_mode()) {
+      // in debug mode, no reply comes,
+      // and controller must copy ref_vector into cur_vector
+      stroke_cur_vector_.assign(stroke_ref_vector_.begin(),
+                                stroke_ref_vector_.end());
+      publish_strokes_(true);
+      if (_replied) *_replied = strokes_value_.stamp;
+      done->set_value(true);
+      return result;
+    }
+    publish_strokes_(false);
   }
+
+  // MoveAbs returns current stroke
+  seed_.send_command(CMD_MOVE_ABS_POS_RET, 0x00, _time, dat,
+                     [this, done, _replied](const SEEDFrame* _frame) {
+      // stamped in io thread, waiting on future adds no error
+      if (_replied)
+        *_replied = std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+      bool decoded = false;
+      if (_frame) {
+        boost::mutex::scoped_lock lock(ctrl_mtx_);
+        decoded = decode_data_(_frame->data, _frame->length,
+                               stroke_cur_vector_);
+      }
+      done->set_value(decoded);
+    });
+
+  return result;
 }
 
 //////////////////////////////////////////////////
 void AeroControllerProto::set_position_no_wait(
     std::vector<int16_t>& _stroke_vector, uint16_t _time)
 {
-  boost::mutex::scoped_lock lock(ctrl_mtx_);
+  std::vector<uint8_t> dat(RAW_DATA_LENGTH);
+  {
+    boost::mutex::scoped_lock lock(ctrl_mtx_);
 
-  // for ROS
-  for (size_t i = 0; i < _stroke_vector.size(); ++i) {
-    if (_stroke_vector[i] != 0x7fff) {
-      stroke_ref_vector_[i] = _stroke_vector[i];
+    // for ROS
+    for (size_t i = 0; i < _stroke_vector.size(); ++i) {
+      if (_stroke_vector[i] != 0x7fff) {
+        stroke_ref_vector_[i] = _stroke_vector[i];
+      }
     }
+
+    // for seed, always 68 bytes frame, single commands have no time
+    stroke_to_raw_(_stroke_vector, dat);
+
+    // for ROS
+    if (seed_.is_debug_mode()) {
+      // in debug mode, get_data returns before writing stroke vector,
+      // and controller must copy ref_vector into cur_vector
+      stroke_cur_vector_.assign(stroke_ref_vector_.begin(),
+                                stroke_ref_vector_.end());
+      publish_strokes_(true);
+      return;
+    }
+    publish_strokes_(false);
   }
 
-  // for seed
-  std::vector<uint8_t> dat(RAW_DATA_LENGTH);
-  stroke_to_raw_(_stroke_vector, dat);
-  //seed_.flush();
+  // queueing may wait for room, ctrl_mtx_ is not held
+  // so that servo_off is not blocked behind position commands
   seed_.send_command(CMD_MOVE_ABS_POS, _time, dat);
-
-  // for ROS
-  if (seed_.is_debug_mode()) {
-    // in debug mode, get_data returns before writing stroke vector,
-    // and controller must copy ref_vector into cur_vector
-    stroke_cur_vector_.assign(stroke_ref_vector_.begin(),
-                              stroke_ref_vector_.end());
-  } else {
-    // no return
-    //get_data(stroke_cur_vector_);
-  }
 }
 
 //////////////////////////////////////////////////
 void AeroControllerProto::set_max_single_current(int8_t _num, int16_t _dat)
 {
-  boost::mutex::scoped_lock lock(ctrl_mtx_);
   if (verbose_) {
     struct timeval m_t;
     gettimeofday(&m_t, NULL);
@@ -657,7 +1425,6 @@ void AeroControllerProto::set_motor_gain(
 void AeroControllerProto::set_command(
     uint8_t _cmd, uint8_t _num, uint16_t _data)
 {
-  boost::mutex::scoped_lock lock(ctrl_mtx_);
   seed_.send_command(_cmd, _num, _data);
 }
 
@@ -665,13 +1432,50 @@ void AeroControllerProto::set_command(
 void AeroControllerProto::set_command(uint8_t _cmd,
                                       std::vector<int16_t>& _stroke_vector)
 {
-  boost::mutex::scoped_lock lock(ctrl_mtx_);
-
   std::vector<uint8_t> dat(RAW_DATA_LENGTH);
-  stroke_to_raw_(_stroke_vector, dat);
+  {
+    boost::mutex::scoped_lock lock(ctrl_mtx_);
+    stroke_to_raw_(_stroke_vector, dat);
+  }
   seed_.send_command(_cmd, 0, dat);
 }
 
+//////////////////////////////////////////////////
+void AeroControllerProto::restore_()
+{
+  int16_t servo;
+  std::vector<int16_t> ref;
+  {
+    boost::mutex::scoped_lock lock(ctrl_mtx_);
+    servo = servo_state_;
+    ref = stroke_ref_vector_;
+  }
+  if (servo < 0) return;
+
+  servo_command(servo);
+  // slowly, actuators may have been moved while servo was off,
+  // a 68 bytes frame carries the time
+  if (servo != 0) set_position_no_wait(ref, SEED_RESTORE_TIME);
+}
+
+//////////////////////////////////////////////////
+void AeroControllerProto::publish_strokes_(bool _read)
+{
+  strokes_value_.size = std::min(stroke_cur_vector_.size(), RAW_AXES);
+  std::copy(stroke_cur_vector_.begin(),
+            stroke_cur_vector_.begin() + strokes_value_.size,
+            strokes_value_.actual);
+  size_t ref = std::min(stroke_ref_vector_.size(), strokes_value_.size);
+  std::copy(stroke_ref_vector_.begin(), stroke_ref_vector_.begin() + ref,
+            strokes_value_.reference);
+  std::fill(strokes_value_.reference + ref,
+            strokes_value_.reference + strokes_value_.size, 0);
+  strokes_value_.stamp = std::chrono::duration_cast<std::chrono::nanoseconds>(
+      std::chrono::steady_clock::now().time_since_epoch()).count();
+  if (_read) strokes_value_.actual_stamp = strokes_value_.stamp;
+  strokes_.store(strokes_value_);
+}
+
 //////////////////////////////////////////////////
 void AeroControllerProto::stroke_to_raw_(std::vector<int16_t>& _stroke,
                                          std::vector<uint8_t>& _raw)
@@ -685,7 +1489,7 @@ void AeroControllerProto::stroke_to_raw_(std::vector<int16_t>& _stroke,
 }
 
 //////////////////////////////////////////////////
-int16_t aero::controller::decode_short_(uint8_t* _raw)
+int16_t aero::controller::decode_short_(const uint8_t* _raw)
 {
   int16_t value;
   uint8_t* bvalue = reinterpret_cast<uint8_t*>(&value);
@@ -701,3 +1505,46 @@ void aero::controller::encode_short_(int16_t _value, uint8_t* _raw)
   _raw[0] = bvalue[1];
   _raw[1] = bvalue[0];
 }
+
+//////////////////////////////////////////////////
+bool aero::controller::set_thread_scheduling(
+    pthread_t _thread, int _cpu, int _priority)
+{
+  bool ok = true;
+
+  if (_cpu >= 0) {
+    cpu_set_t cpus;
+    CPU_ZERO(&cpus);
+    CPU_SET(_cpu, &cpus);
+    int err = pthread_setaffinity_np(_thread, sizeof(cpus), &cpus);
+    if (err != 0) {
+      std::cerr << "Proto: ERROR: cpu affinity " << _cpu << ": "
+                << strerror(err) << std::endl;
+      ok = false;
+    }
+  }
+
+  if (_priority > 0) {
+    struct sched_param param;
+    param.sched_priority = _priority;
+    int err = pthread_setschedparam(_thread, SCHED_FIFO, &param);
+    if (err != 0) {
+      std::cerr << "Proto: ERROR: priority " << _priority << ": "
+                << strerror(err) << std::endl;
+      ok = false;
+    }
+  }
+
+  return ok;
+}
+
+//////////////////////////////////////////////////
+bool aero::controller::lock_memory()
+{
+  if (::mlockall(MCL_CURRENT | MCL_FUTURE) != 0) {
+    std::cerr << "Proto: ERROR: lock memory: " << strerror(errno)
+              << std::endl;
+    return false;
+  }
+  return true;
+}
@@ -1,6 +1,7 @@
 #ifndef AERO_CONTROLLER_AERO_CONTROLLER_PROTO_H_
 #define AERO_CONTROLLER_AERO_CONTROLLER_PROTO_H_
 
+#include <algorithm>
 #include <iostream>
 #include <iomanip>
 #include <sstream>
@@ -8,8 +9,13 @@
 #include <string>
 #include <stdint.h>
 #include <unistd.h>
+#include <pthread.h>
 #include <unordered_map>
 #include <cmath>
+#include <functional>
+#include <future>
+#include <memory>
+#include <chrono>
 
 #include <boost/asio.hpp>
 #include <boost/algorithm/string.hpp>
@@ -18,6 +24,10 @@
 #include "aero_hardware_interface/CommandList.hh"
 #include "aero_hardware_interface/Constants.hh"
 #include "aero_hardware_interface/AJointIndex.hh"
+#include "aero_hardware_interface/SEEDFrame.hh"
+#include "aero_hardware_interface/SEEDBusStats.hh"
+#include "aero_hardware_interface/SEEDCapture.hh"
+#include "aero_hardware_interface/SeqLockSnapshot.hh"
 
 using namespace boost::asio;
 
@@ -25,7 +35,65 @@ namespace aero
 {
   namespace controller
   {
+    // commands waiting to be written in each lane
+    const static size_t SEED_TX_QUEUE = 16;
+    // bytes in serial driver above which only safety commands are written
+    const static size_t SEED_TX_BACKLOG = RAW_DATA_LENGTH;
+    // commands waiting for reply
+    const static size_t SEED_MAX_IN_FLIGHT = 8;
+    // board must answer CMD_GET_VERSION within this after open[ms]
+    const static int SEED_READY_TIMEOUT = 2000;
+    // interval of reopening a lost port[ms]
+    const static int SEED_RECONNECT_INTERVAL = 200;
+    // restore_ moves to reference strokes in this time[csec]
+    const static uint16_t SEED_RESTORE_TIME = 100;
+
+    /// @brief called with reply frame of a command, NULL on timeout
+    typedef std::function<void(const SEEDFrame*)> SEEDReplyCallback;
+
+    /// @brief command queued to be written to SEED controller
+    struct SEEDTransaction
+    {
+      /// @brief raw bytes to write
+      SEEDFrame frame;
+
+      /// @brief command byte of reply, 0 if no reply
+      uint8_t reply_cmd;
+
+      SEEDReplyCallback callback;
+
+      /// @brief time command was queued
+      std::chrono::steady_clock::time_point queued;
+    };
+
+    /// @brief command written and waiting for its reply
+    struct SEEDPendingReply
+    {
+      bool active;
+
+      /// @brief command byte of reply
+      uint8_t reply_cmd;
+
+      SEEDReplyCallback callback;
+
+      /// @brief reply is given up after deadline
+      boost::posix_time::ptime deadline;
+
+      /// @brief time command was written
+      std::chrono::steady_clock::time_point sent;
+
+      /// @brief write order, oldest command gets reply first
+      uint64_t sequence;
+    };
+
     /// @brief SEED controller via USB/RS485
+    ///
+    /// Reads and writes are done asynchronously in io thread.
+    /// Commands are queued in lanes by seed_lane(), safety commands are
+    /// written first, then position commands, then telemetry, in order of
+    /// call within a lane. Several commands can wait for their reply at
+    /// the same time, and each reply is handed to the oldest command
+    /// waiting for the same command byte.
     class SEED485Controller
     {
       /// @brief constructor
@@ -42,9 +110,32 @@ namespace aero
       /// @brief get voltage of SEED controller
      public: float get_voltage();
 
-      /// @brief read from SEED controller
+      /// @brief get voltage without waiting reply
+      /// @param _voltage [V], 0 on timeout, must live until reply
+      /// @return true when decoded, false on timeout
+     public: std::shared_future<bool> get_voltage_async(float* _voltage);
+
+      /// @brief read from SEED controller,
+      ///   waits for the next complete frame not taken by any command
+      /// @param _read_data frame bytes, zero filled on timeout
+      /// @param _length expected frame length
      public: void read(std::vector<uint8_t>& _read_data, const size_t _length=RAW_DATA_LENGTH);
 
+      /// @brief set how long read and commands wait for a frame
+      /// @param _msec timeout[ms]
+     public: void set_read_timeout(int _msec) {read_timeout_ms_ = _msec;}
+
+      /// @brief set number of commands that can wait for reply at once,
+      ///   safety commands may use the remaining slots
+      /// @param _num 1 to SEED_MAX_IN_FLIGHT - 1
+     public: void set_max_in_flight(size_t _num);
+
+      /// @brief pin io thread to a cpu and set its priority
+      /// @param _cpu cpu index, -1 to keep current affinity
+      /// @param _priority SCHED_FIFO priority, 0 to keep current policy
+      /// @return false if not permitted
+     public: bool set_io_scheduling(int _cpu, int _priority);
+
       /// @brief send command to SEED controller
       /// @param _cmd Command ID
       /// @param _time Destination time
@@ -61,16 +152,39 @@ namespace aero
      public: void send_command(uint8_t _cmd, uint8_t _sub, uint16_t _time,
                                std::vector<uint8_t>& _send_data);
 
+      /// @brief send command to SEED controller and wait for reply
+      /// @param _cmd Command ID, reply has same ID
+      /// @param _sub Sub command
+      /// @param _time Destination time
+      /// @param _send_data data buffer
+      /// @param _callback called from io thread with reply
+      /// @param _lane lane of command, SEED_LANES to choose by seed_lane()
+     public: void send_command(uint8_t _cmd, uint8_t _sub, uint16_t _time,
+                               std::vector<uint8_t>& _send_data,
+                               SEEDReplyCallback _callback,
+                               SEEDLane _lane=SEED_LANES);
+
       /// @brief send_executing script command
      public: void AERO_Snd_Script(uint16_t sendnum, uint8_t scriptnum);
 
-      /// @brief flush io buffer
+      /// @brief flush io buffer and drop received frames,
+      ///   not needed after broken bytes, the decoder resynchronizes
      public: void flush();
 
       /// @brief send raw data to SEED controller
       /// @param _send_data raw data buffer
      public: void send_data(std::vector<uint8_t>& _send_data);
 
+      /// @brief send raw data to SEED controller and wait for reply
+      /// @param _send_data raw data buffer
+      /// @param _reply_cmd command ID of reply, 0 if no reply
+      /// @param _callback called from io thread with reply,
+      ///   NULL on timeout
+      /// @param _lane lane of command, SEED_LANES to choose by seed_lane()
+     public: void send_data(std::vector<uint8_t>& _send_data,
+                            uint8_t _reply_cmd, SEEDReplyCallback _callback,
+                            SEEDLane _lane=SEED_LANES);
+
       /// @brief set / unset verbose mode
       /// @param val verbose mode
      public: void verbose(bool val) {verbose_ = val;}
@@ -80,19 +194,228 @@ namespace aero
 
       /// @brief getdebug mode flag
       /// @return true if in debug mode
-     public: bool is_debug_mode() {return !ser_.is_open();}
+     public: bool is_debug_mode() {return debug_;}
+
+      /// @brief false in debug mode and while port is lost
+     public: bool is_connected();
+
+      /// @brief reopen a lost port (read or write error, e.g. USB reset)
+      ///   every SEED_RECONNECT_INTERVAL, enabled by default
+     public: void set_reconnect(bool _enable);
+
+      /// @brief called from reconnect thread after a lost port was reopened
+      ///   and the board replied, commands can be sent from it
+     public: void set_reconnect_callback(std::function<void()> _callback);
+
+      /// @brief stop reconnecting and wait for reconnect thread,
+      ///   called before objects used by reconnect callback are destroyed
+     public: void stop_reconnect();
+
+      /// @brief copy of health and throughput counters of port
+     public: SEEDBusStats get_stats();
+
+      /// @brief count a reply of unexpected length in short_reads,
+      ///   for replies decoded outside of read
+     public: void count_short_read();
+
+      /// @brief longest time a safety command queued now can wait until
+      ///   it is written: serial driver backlog left by other lanes,
+      ///   safety commands ahead and itself, at link rate
+      /// @return time[us]
+     public: uint64_t safety_latency_bound();
+
+      /// @brief record every frame written and read to a capture file,
+      ///   replaces previous capture
+      /// @param _path capture file (SEEDCapture.hh)
+      /// @param _slots frames kept, oldest are overwritten
+      /// @return false if file could not be created
+     public: bool start_capture(const std::string& _path,
+                                size_t _slots=SEED_CAPTURE_SLOTS);
+
+     public: void stop_capture();
+
+      /// @brief open port_ and set line options
+      /// @return false if port could not be opened
+     private: bool open_port_();
+
+      /// @brief send CMD_GET_VERSION until the board replies,
+      ///   time to first reply is stats_.ready_time
+      /// @param _timeout_ms give up after this[ms]
+      /// @return false if no reply
+     private: bool probe_(int _timeout_ms);
+
+      /// @brief close port after read or write error,
+      ///   waiting commands get NULL reply (io thread)
+     private: void lose_port_(const boost::system::error_code& _err);
+
+      /// @brief reopen lost port until board replies (reconnect thread)
+     private: void reconnect_();
+
+      /// @brief send raw data and block until reply
+      /// @param _reply reply frame bytes
+      /// @return false on timeout
+     private: bool request_(std::vector<uint8_t>& _send_data,
+                            uint8_t _reply_cmd, std::vector<uint8_t>& _reply);
+
+      /// @brief write header and checksum of 68 bytes command
+     private: void fill_command_(uint8_t _cmd, uint8_t _sub, uint16_t _time,
+                                 std::vector<uint8_t>& _send_data);
+
+      /// @brief request next bytes from serial port (io thread)
+     private: void start_read_();
+
+      /// @brief handle received bytes (io thread)
+     private: void handle_read_(const boost::system::error_code& _err,
+                                size_t _bytes);
+
+      /// @brief write next queued command if possible (io thread)
+     private: void try_write_();
+
+      /// @brief handle end of write (io thread)
+     private: void handle_write_(const boost::system::error_code& _err,
+                                 size_t _bytes);
+
+      /// @brief true if at most SEED_TX_BACKLOG bytes are not on the wire,
+      ///   otherwise drain_timer_ retries when they should be,
+      ///   io_mtx_ locked
+     private: bool backlog_drained_();
+
+      /// @brief retry writing after driver backlog drained (io thread)
+     private: void handle_drain_(const boost::system::error_code& _err);
+
+      /// @brief start timer for oldest pending reply, io_mtx_ locked
+     private: void arm_timeout_();
+
+      /// @brief give up replies past deadline (io thread)
+     private: void handle_timeout_(const boost::system::error_code& _err);
 
      private: io_service io_;
 
      private: serial_port ser_;
 
+     private: std::string port_;
+
      private: uint8_t id_;
 
+      /// @brief no port, commands are not sent
+     private: bool debug_;
+
+      /// @brief port is open and can be written, io_mtx_ locked
+     private: bool connected_;
+
+     private: bool reconnect_enabled_;
+
+      /// @brief reconnect thread ends, io_mtx_ locked
+     private: bool stopping_;
+
+      /// @brief waits for lost port, then reopens it
+     private: boost::thread reconnect_thread_;
+
+     private: boost::condition_variable reconnect_cond_;
+
+     private: std::function<void()> reconnect_callback_;
+
+      /// @brief when port was lost, for stats_.downtime
+     private: std::chrono::steady_clock::time_point lost_time_;
+
      private: bool verbose_;
 
      private: boost::mutex mtx_;
+
+      /// @brief keeps io_ running while port is open
+     private: boost::shared_ptr<io_service::work> work_;
+
+      /// @brief runs io_, all reads and writes are done in this thread
+     private: boost::thread io_thread_;
+
+      /// @brief splits received bytes into frames
+     private: SEEDFrameDecoder decoder_;
+
+      /// @brief region of decoder_ the pending read writes into
+     private: uint8_t* rx_pending_;
+
+      /// @brief frame being decoded (io thread)
+     private: SEEDFrame rx_frame_;
+
+      /// @brief complete frames not taken by any command, waiting for read
+     private: SEEDFrame rx_frames_[SEED_RX_FRAME_QUEUE];
+
+     private: size_t rx_head_;
+
+     private: size_t rx_count_;
+
+      /// @brief commands waiting to be written in each SEEDLane
+     private: SEEDTransaction tx_queue_[SEED_LANES][SEED_TX_QUEUE];
+
+     private: size_t tx_head_[SEED_LANES];
+
+     private: size_t tx_count_[SEED_LANES];
+
+      /// @brief true while head of tx_queue_[writing_lane_] is being written
+     private: bool writing_;
+
+     private: size_t writing_lane_;
+
+      /// @brief commands waiting for reply
+     private: SEEDPendingReply in_flight_[SEED_MAX_IN_FLIGHT];
+
+     private: size_t in_flight_count_;
+
+     private: size_t max_in_flight_;
+
+     private: uint64_t sequence_;
+
+      /// @brief replies given up in handle_timeout_ (io thread)
+     private: SEEDReplyCallback expired_[SEED_MAX_IN_FLIGHT];
+
+     private: deadline_timer timeout_timer_;
+
+     private: bool timeout_armed_;
+
+     private: deadline_timer drain_timer_;
+
+     private: bool drain_armed_;
+
+      /// @brief when written bytes are expected to be on the wire
+     private: std::chrono::steady_clock::time_point wire_free_;
+
+      /// @brief guards decoder_, rx_frames_, tx_queue_ and in_flight_
+     private: boost::mutex io_mtx_;
+
+     private: boost::condition_variable rx_cond_;
+
+     private: boost::condition_variable tx_cond_;
+
+      /// @brief counters except decoder ones, io_mtx_ locked
+     private: SEEDBusStats stats_;
+
+      /// @brief written by io thread, io_mtx_ locked
+     private: SEEDCapture capture_;
+
+     private: int read_timeout_ms_;
     };  // SEED485Controller
 
+    /// @brief strokes of one board, published whenever they change
+    struct AeroStrokeSnapshot
+    {
+      AeroStrokeSnapshot() : size(0), stamp(0), actual_stamp(0)
+      {
+      }
+
+      size_t size;
+
+      int16_t actual[RAW_AXES];
+
+      int16_t reference[RAW_AXES];
+
+      /// @brief steady clock time of last change[ns]
+      int64_t stamp;
+
+      /// @brief steady clock time of last reading of actual[ns],
+      ///   0 if never read, reference writes leave it
+      int64_t actual_stamp;
+    };
+
     /// @brief super class of body controller,
     /// has SEED485Controller and some SEED command fucntions.
     class AeroControllerProto
@@ -111,6 +434,11 @@ namespace aero
       /// @brief get voltage of SEED controller
      public: float get_voltage();
 
+      /// @brief get voltage without waiting reply
+      /// @param _voltage [V], 0 on timeout, must live until reply
+      /// @return true when decoded, false on timeout
+     public: std::shared_future<bool> get_voltage_async(float* _voltage);
+
       /// @brief servo on command
      public: void servo_on();
 
@@ -125,6 +453,10 @@ namespace aero
 
      public: std::vector<int16_t> get_actual_stroke_vector();
 
+      /// @brief latest strokes, never blocks nor allocates
+     public: void get_stroke_snapshot(AeroStrokeSnapshot& _snapshot) const
+      {_snapshot = strokes_.load();}
+
      public: std::vector<int16_t> get_status_vec();
 
      public: std::string get_stroke_joint_name(size_t _idx);
@@ -135,34 +467,107 @@ namespace aero
 
      public: int32_t get_ordered_angle_id(std::string _name);
 
+      /// @brief replace joint table of board, e.g. read from config,
+      ///   strokes are read again from board
+      /// @param _indices stroke_index must be 0 to size - 1
+     public: void set_stroke_joint_indices(
+         const std::vector<AJointIndex>& _indices);
+
      public: bool get_joint_name(int32_t _joint_id, std::string &_name);
 
      public: bool get_status();
 
      public: bool get_status(std::vector<bool>& _status_vector);
 
+      /// @brief read step out status in safety lane, not queued behind
+      ///   position commands and telemetry, e.g. before aborting a motion
+      /// @return true if any joint stepped out, last status on timeout
+     public: bool check_status();
+
       /// @brief get current position from seed_
       ///   to access position externally, use get_actual_stroke_vector
-     public: void update_position();
+      /// @return false if reply timed out
+     public: bool update_position();
 
       /// @brief updates robot status (checks step out joints)
      public: void update_status();
 
+      /// @brief send Get_Pos command without waiting reply,
+      ///   actual stroke vector is updated when reply arrives
+      /// @return true when updated, false on timeout
+     public: std::shared_future<bool> update_position_async();
+
+      /// @brief send status command without waiting reply
+      /// @return true when updated, false on timeout
+     public: std::shared_future<bool> update_status_async();
+
+      /// @brief set number of commands that can wait for reply at once
+      /// @param _num number of commands
+     public: void set_max_in_flight(size_t _num) {seed_.set_max_in_flight(_num);}
+
+      /// @brief pin io thread of seed_ to a cpu and set its priority
+      /// @param _cpu cpu index, -1 to keep current affinity
+      /// @param _priority SCHED_FIFO priority, 0 to keep current policy
+      /// @return false if not permitted
+     public: bool set_io_scheduling(int _cpu, int _priority)
+      {return seed_.set_io_scheduling(_cpu, _priority);}
+
+      /// @brief copy of health and throughput counters of port
+     public: SEEDBusStats get_bus_stats() {return seed_.get_stats();}
+
+      /// @brief false in debug mode and while port is lost
+     public: bool is_connected() {return seed_.is_connected();}
+
+      /// @brief worst case wait of a safety command queued now[us]
+     public: uint64_t get_safety_latency_bound()
+      {return seed_.safety_latency_bound();}
+
+      /// @brief record bus traffic to a capture file, see seed_replay
+      /// @param _path capture file
+      /// @param _slots frames kept, oldest are overwritten
+      /// @return false if file could not be created
+     public: bool start_capture(const std::string& _path,
+                                size_t _slots=SEED_CAPTURE_SLOTS)
+      {return seed_.start_capture(_path, _slots);}
+
+     public: void stop_capture() {seed_.stop_capture();}
+
      public: void reset_status();
 
       /// @brief send Get_Cur command
       /// @param _stroke_vector stroke vector
      public: void get_current(std::vector<int16_t>& _stroke_vector);
 
+      /// @brief send Get_Cur command without waiting reply
+      /// @param _stroke_vector decoded reply, must live until reply
+      /// @return true when decoded, false on timeout
+     public: std::shared_future<bool> get_current_async(
+         std::vector<int16_t>* _stroke_vector);
+
       /// @brief send Get_Tmp command
       /// @param _stroke_vector stroke vector
      public: void get_temperature(std::vector<int16_t>& _stroke_vector);
 
+      /// @brief send Get_Tmp command without waiting reply
+      /// @param _stroke_vector decoded reply, must live until reply
+      /// @return true when decoded, false on timeout
+     public: std::shared_future<bool> get_temperature_async(
+         std::vector<int16_t>* _stroke_vector);
+
       /// @brief get data from buffer,
       ///   this does not call command, but only read from buffer
       /// @param _stroke_vector stroke vector
      protected: void get_data(std::vector<int16_t>& _stroke_vector);
 
+      /// @brief decode reply into stroke vector, ctrl_mtx_ locked
+      /// @param _dat reply frame bytes
+      /// @param _length reply frame length, counted as short read and
+      ///   not decoded unless RAW_DATA_LENGTH
+      /// @param _stroke_vector stroke vector
+      /// @return false if frame was not decoded
+     protected: bool decode_data_(const uint8_t* _dat, size_t _length,
+                                  std::vector<int16_t>& _stroke_vector);
+
       /// @brief abstract of get commands
       /// @param _cmd command id
       /// @param _stroke_vector stroke vector
@@ -172,12 +577,33 @@ namespace aero
      protected: void get_command(uint8_t _cmd, uint8_t _sub,
                                  std::vector<int16_t>& _stroke_vector);
 
+      /// @brief get command without waiting reply
+      /// @param _cmd command id
+      /// @param _sub sub command
+      /// @param _stroke_vector decoded reply, must live until reply
+      /// @param _lane lane of command, SEED_LANES to choose by seed_lane()
+      /// @return true when decoded, false on timeout
+     protected: std::shared_future<bool> get_command_async(
+         uint8_t _cmd, uint8_t _sub, std::vector<int16_t>* _stroke_vector,
+         SEEDLane _lane=SEED_LANES);
+
       /// @brief set position command (waiting return of current position)
       /// @param _stroke_vector stroke vector, MUST be DOF bytes
       /// @param _time time[ms]
      public: void set_position(std::vector<int16_t>& _stroke_vector,
                                uint16_t _time);
 
+      /// @brief set position command without waiting reply,
+      ///   actual stroke vector is updated when reply arrives
+      /// @param _stroke_vector stroke vector, MUST be DOF bytes
+      /// @param _time time[ms]
+      /// @param _replied steady clock time of reply or timeout[ns],
+      ///   set before future is ready, must live until reply
+      /// @return true when updated, false on timeout
+     public: std::shared_future<bool> set_position_async(
+         std::vector<int16_t>& _stroke_vector, uint16_t _time,
+         int64_t* _replied=NULL);
+
       /// @brief set position command (no wait)
       /// @param _stroke_vector stroke vector, MUST be DOF bytes
       /// @param _time time[ms]
@@ -213,6 +639,16 @@ namespace aero
      protected: void set_command(uint8_t _cmd,
                                  std::vector<int16_t>& _stroke_vector);
 
+      /// @brief send last servo state and reference strokes again
+      ///   after port was reconnected, the board may have been reset
+     protected: void restore_();
+
+      /// @brief publish stroke_cur_vector_ and stroke_ref_vector_
+      ///   to readers, ctrl_mtx_ locked (or in constructor)
+      /// @param _read stroke_cur_vector_ was read from board
+      ///   (or copied from reference in debug mode)
+     protected: void publish_strokes_(bool _read);
+
       /// @brief stoke_vector to raw command bytes
      protected: void stroke_to_raw_(std::vector<int16_t>& _stroke,
                                     std::vector<uint8_t>& _raw);
@@ -235,8 +671,16 @@ namespace aero
 
      protected: bool bad_status_;
 
+      /// @brief last servo_command, -1 if none
+     protected: int16_t servo_state_;
+
      protected:
       std::unordered_map<std::string, int32_t> angle_joint_indices_;
+
+      /// @brief written by publish_strokes_ only
+     private: AeroStrokeSnapshot strokes_value_;
+
+     private: SeqLockSnapshot<AeroStrokeSnapshot> strokes_;
     };  // AeroControllerProto
 
   /////////////////////
@@ -244,10 +688,22 @@ namespace aero
   /////////////////////
 
   /// @brief decode short(int16_t) from byte(uint8_t)
-  int16_t decode_short_(uint8_t* _raw);
+  int16_t decode_short_(const uint8_t* _raw);
 
   /// @brief ecnode short(int16_t) to byte(uint8_t)
   void encode_short_(int16_t _value, uint8_t* _raw);
+
+  /// @brief pin thread to a cpu and set its SCHED_FIFO priority
+  /// @param _thread native thread handle
+  /// @param _cpu cpu index, -1 to keep current affinity
+  /// @param _priority SCHED_FIFO priority, 0 to keep current policy
+  /// @return false if not permitted
+  bool set_thread_scheduling(pthread_t _thread, int _cpu, int _priority);
+
+  /// @brief lock current and future pages of the process into memory,
+  ///   so that control and bus threads never wait for page faults
+  /// @return false if not permitted
+  bool lock_memory();
   }
 }
 
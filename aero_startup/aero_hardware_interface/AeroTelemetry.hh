@@ -0,0 +1,46 @@
+#ifndef AERO_CONTROLLER_AERO_TELEMETRY_H_
+#define AERO_CONTROLLER_AERO_TELEMETRY_H_
+
+#include <stdint.h>
+#include <cstddef>
+
+#include "aero_hardware_interface/SeqLockSnapshot.hh"
+
+namespace aero
+{
+  namespace controller
+  {
+    // strokes in one 68 bytes frame
+    const static size_t AERO_TELEMETRY_MAX_STROKES = 30;
+
+    /// @brief latest telemetry of one board
+    struct AeroTelemetry
+    {
+      AeroTelemetry() : size(0), voltage(0.0f), current_stamp(0),
+        temperature_stamp(0), voltage_stamp(0)
+      {
+      }
+
+      /// @brief number of valid strokes in current and temperature
+      size_t size;
+
+      /// @brief reply of CMD_GET_CUR in stroke order
+      int16_t current[AERO_TELEMETRY_MAX_STROKES];
+
+      /// @brief reply of CMD_GET_TMP_VOLT in stroke order
+      int16_t temperature[AERO_TELEMETRY_MAX_STROKES];
+
+      /// @brief [V]
+      float voltage;
+
+      /// @brief time of update[ns], steady clock, 0 if never updated
+      int64_t current_stamp;
+
+      int64_t temperature_stamp;
+
+      int64_t voltage_stamp;
+    };
+  }
+}
+
+#endif
@@ -9,6 +9,12 @@ namespace aero
     const static size_t RAW_HEADER_OFFSET = 5;
     // data length = 68bytes
     const static size_t RAW_DATA_LENGTH = 68;
+    // axes in one frame = 30
+    const static size_t RAW_AXES = 30;
+    // single command: FD DF 04 cmd num data(2) sum = 8bytes
+    const static size_t RAW_SHORT_COMMAND_LENGTH = 8;
+    // 8N1 at 1Mbps
+    const static size_t SEED_BAUD_RATE = 1000000;
 
     // command list
     const static uint8_t CMD_MOTOR_CUR  = 0x01; // CMAX
@@ -35,6 +41,43 @@ namespace aero
 
     const static uint8_t CMD_GET_VERSION = 0x51;
     const static uint8_t CMD_WATCH_MISSTEP = 0x52;
+    // sub command of CMD_WATCH_MISSTEP clearing step out status
+    const static uint8_t SUB_RESET_STATUS = 0xff;
+
+    /// @brief lanes of command queue, lower lane is written first
+    enum SEEDLane
+    {
+      SEED_LANE_SAFETY = 0,
+      SEED_LANE_POSITION,
+      SEED_LANE_TELEMETRY,
+      SEED_LANES
+    };
+
+    /// @brief lane of a command
+    /// @param _cmd command id
+    /// @param _sub sub command
+    /// @return SAFETY for servo and step out status reset,
+    ///   TELEMETRY for step out status, current, temperature, AD, DIO
+    ///   and version,
+    ///   POSITION for moves, positions, settings and others
+    inline SEEDLane seed_lane(uint8_t _cmd, uint8_t _sub)
+    {
+      switch (_cmd) {
+      case CMD_MOTOR_SRV:
+        return SEED_LANE_SAFETY;
+      case CMD_WATCH_MISSTEP:
+        return _sub == SUB_RESET_STATUS ?
+          SEED_LANE_SAFETY : SEED_LANE_TELEMETRY;
+      case CMD_GET_CUR:
+      case CMD_GET_TMP_VOLT:
+      case CMD_GET_AD:
+      case CMD_GET_DIO:
+      case CMD_GET_VERSION:
+        return SEED_LANE_TELEMETRY;
+      default:
+        return SEED_LANE_POSITION;
+      }
+    }
   }
 }
 
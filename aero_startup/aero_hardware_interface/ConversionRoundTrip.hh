@@ -0,0 +1,134 @@
+#ifndef AERO_COMMON_CONVERSION_ROUND_TRIP_H_
+#define AERO_COMMON_CONVERSION_ROUND_TRIP_H_
+
+#include <algorithm>
+#include <cmath>
+#include <stdint.h>
+
+// tables of one robot with ConversionPairs,
+// make_conversion_tables.py {robot_dir} --pairs
+#include "aero_hardware_interface/ConversionTables.hh"
+
+namespace aero
+{
+  namespace common
+  {
+    /// @brief worst angle -> stroke -> angle conversion of a sweep
+    struct RoundTrip
+    {
+      RoundTrip() :
+        max_error(0), angle(0), coupled_angle(0), conversions(0), failures(0)
+      {
+      }
+
+      /// @brief error[deg]
+      float max_error;
+
+      /// @brief angle[deg] of max_error
+      float angle;
+
+      /// @brief angle[deg] of coupled joint at max_error
+      float coupled_angle;
+
+      size_t conversions;
+
+      /// @brief conversions with error over tolerance
+      size_t failures;
+    };
+
+    /// @brief stroke[mm] as sent to and read from SEED (0.01 mm)
+    inline float QuantizeStroke(float _stroke)
+    {
+      return static_cast<int16_t>(100.0f * _stroke) * 0.01f;
+    }
+
+    inline float PairStroke(const ConversionPair& _pair, float _angle)
+    {
+      return A2SLookup(_pair.map, _pair.map_size, _pair.map_offset, _angle);
+    }
+
+    inline float PairAngle(const ConversionPair& _pair, float _stroke)
+    {
+      return S2ALookup(_pair.data, _pair.buckets, _pair.buckets_size,
+                       _pair.offset, _stroke);
+    }
+
+    /// @brief first and last angle[deg] of Angle2Stroke table
+    inline float PairMinAngle(const ConversionPair& _pair)
+    {
+      return _pair.map_offset;
+    }
+
+    inline float PairMaxAngle(const ConversionPair& _pair)
+    {
+      return _pair.map_offset + _pair.map_size - 1;
+    }
+
+    /// @brief sweep whole angle range of a table
+    /// @param _step angle step[deg]
+    /// @param _tolerance error[deg] counted as failure
+    inline RoundTrip SingleRoundTrip(const ConversionPair& _pair, float _step,
+                                     float _tolerance)
+    {
+      RoundTrip result;
+      int steps = static_cast<int>(
+          (PairMaxAngle(_pair) - PairMinAngle(_pair)) / _step);
+      for (int i = 0; i <= steps; ++i) {
+        float angle = PairMinAngle(_pair) + i * _step;
+        float error = std::fabs(
+            PairAngle(_pair, QuantizeStroke(PairStroke(_pair, angle))) -
+            angle);
+        ++result.conversions;
+        result.failures += error > _tolerance;
+        if (error > result.max_error) {
+          result.max_error = error;
+          result.angle = angle;
+        }
+      }
+      return result;
+    }
+
+    /// @brief sweep angle ranges of coupled tables (dualJoint) as a grid
+    ///
+    /// Both actuators move: strokes are two + one and two - one,
+    /// they are split back as in Stroke2Angle.
+    /// @param _one pair whose coupled is _two
+    /// @param _step angle step[deg] of both joints
+    /// @param _tolerance error[deg] counted as failure
+    inline RoundTrip CoupledRoundTrip(const ConversionPair& _one,
+                                      const ConversionPair& _two,
+                                      float _step, float _tolerance)
+    {
+      RoundTrip result;
+      int steps_one = static_cast<int>(
+          (PairMaxAngle(_one) - PairMinAngle(_one)) / _step);
+      int steps_two = static_cast<int>(
+          (PairMaxAngle(_two) - PairMinAngle(_two)) / _step);
+      for (int i = 0; i <= steps_one; ++i) {
+        float angle_one = PairMinAngle(_one) + i * _step;
+        float stroke_one = PairStroke(_one, angle_one);
+        for (int j = 0; j <= steps_two; ++j) {
+          float angle_two = PairMinAngle(_two) + j * _step;
+          float stroke_two = PairStroke(_two, angle_two);
+
+          float sum = QuantizeStroke(stroke_two + stroke_one);
+          float difference = QuantizeStroke(stroke_two - stroke_one);
+          float two = (sum + difference) * 0.5;
+          float error = std::max(
+              std::fabs(PairAngle(_one, sum - two) - angle_one),
+              std::fabs(PairAngle(_two, two) - angle_two));
+          ++result.conversions;
+          result.failures += error > _tolerance;
+          if (error > result.max_error) {
+            result.max_error = error;
+            result.angle = angle_one;
+            result.coupled_angle = angle_two;
+          }
+        }
+      }
+      return result;
+    }
+  }
+}
+
+#endif
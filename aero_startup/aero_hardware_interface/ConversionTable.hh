@@ -0,0 +1,244 @@
+#ifndef AERO_COMMON_CONVERSION_TABLE_H_
+#define AERO_COMMON_CONVERSION_TABLE_H_
+
+#include <stdint.h>
+#include <cmath>
+#include <cstddef>
+#include <vector>
+
+namespace aero
+{
+  namespace common
+  {
+    /// @brief point of Stroke2Angle table (csv line)
+    struct S2AData
+    {
+      int angle;
+      float stroke;
+      /// @brief stroke[mm] from previous point
+      float range;
+    };
+
+    /// @brief points of Stroke2Angle table around the same integral stroke
+    ///
+    /// Points are data[begin, begin + size), those whose segment
+    /// (from the previous point) overlaps the integral stroke.
+    struct S2ABucket
+    {
+      uint16_t begin;
+      uint16_t size;
+    };
+
+    /// @brief point of Angle2Stroke table, one per degree
+    struct A2SData
+    {
+      float stroke;
+      float interval;
+    };
+
+    /// @brief angle[deg] of stroke[mm] from generated Stroke2Angle table
+    ///
+    /// The bucket is indexed by stroke, only its few points are scanned,
+    /// nothing is copied or allocated.
+    /// The angle is interpolated on the segment containing the stroke,
+    /// strokes out of table are clamped to its nearest end.
+    /// @param _data points of all buckets
+    /// @param _buckets buckets from offset stroke on
+    /// @param _size number of buckets
+    /// @param _offset integral stroke of first bucket
+    /// @param _stroke stroke[mm]
+    inline float S2ALookup(const S2AData* _data, const S2ABucket* _buckets,
+                           int _size, int _offset, float _stroke)
+    {
+      int index = static_cast<int>(std::floor(_stroke)) - _offset;
+      if (index > _size - 1) index = _size - 1;
+      if (index < 0) index = 0;
+      const S2ABucket& bucket = _buckets[index];
+      const S2AData* candidates = _data + bucket.begin;
+
+      // position on segment, 0 at the point and 1 at the previous one
+      float nearest = 0;
+      float nearest_error = -1;
+      for (int i = 0; i < bucket.size; ++i) {
+        const S2AData& point = candidates[i];
+        float t = point.range == 0 ? 0 :
+          (point.stroke - _stroke) / point.range;
+        if (t >= 0 && t <= 1)
+          return point.angle - t;
+        float clamped = t < 0 ? 0 : 1;
+        float error = std::fabs(t - clamped);
+        if (nearest_error < 0 || error < nearest_error) {
+          nearest = point.angle - clamped;
+          nearest_error = error;
+        }
+      }
+      return nearest;
+    }
+
+    /// @brief stroke[mm] of angle[deg] from generated Angle2Stroke table
+    ///
+    /// Angles out of table are clamped to its first or last point.
+    /// @param _table one point per degree
+    /// @param _size number of points
+    /// @param _offset angle of first point
+    /// @param _angle angle[deg]
+    inline float A2SLookup(const A2SData* _table, int _size, int _offset,
+                           float _angle)
+    {
+      // clamped without branches
+      int roundedAngle = static_cast<int>(_angle);
+      roundedAngle += _angle > roundedAngle + 0.001;
+      int index = roundedAngle - _offset;
+      int clamped = index > _size - 1 ? _size - 1 : index;
+      clamped = clamped < 0 ? 0 : clamped;
+      float fraction = (roundedAngle - _angle) * (index == clamped);
+
+      const A2SData& point = _table[clamped];
+      return point.stroke - fraction * point.interval;
+    }
+
+    /// @brief knot of monotone cubic spline through points of a csv file
+    struct SplineKnot
+    {
+      float x;
+      float y;
+      /// @brief dy/dx at x
+      float slope;
+    };
+
+    /// @brief value of spline and its derivative
+    ///
+    /// Knots are searched by bisection, x out of spline is clamped
+    /// to its first or last knot with derivative 0,
+    /// on the first or last knot the derivative is its slope.
+    /// @param _knots x ascending
+    /// @param _size number of knots, at least 2
+    /// @param _x position on x
+    /// @param _derivative dy/dx at _x
+    /// @return y at _x
+    inline float SplineEval(const SplineKnot* _knots, int _size, float _x,
+                            float& _derivative)
+    {
+      if (_x < _knots[0].x || _x > _knots[_size - 1].x) {
+        _derivative = 0;
+        return _x < _knots[0].x ? _knots[0].y : _knots[_size - 1].y;
+      }
+
+      int low = 0;
+      int high = _size - 1;
+      while (high - low > 1) {
+        int middle = (low + high) / 2;
+        if (_x < _knots[middle].x)
+          high = middle;
+        else
+          low = middle;
+      }
+
+      // cubic Hermite of the interval
+      const SplineKnot& k0 = _knots[low];
+      const SplineKnot& k1 = _knots[high];
+      float h = k1.x - k0.x;
+      float d = (k1.y - k0.y) / h;
+      float c2 = (3 * d - 2 * k0.slope - k1.slope) / h;
+      float c3 = (k0.slope + k1.slope - 2 * d) / (h * h);
+      float dx = _x - k0.x;
+      _derivative = k0.slope + dx * (2 * c2 + 3 * c3 * dx);
+      return k0.y + dx * (k0.slope + dx * (c2 + c3 * dx));
+    }
+
+    /// @brief value and its rate of change through a conversion,
+    ///   chain rule applied by each operation (forward differentiation)
+    struct ConversionJet
+    {
+      ConversionJet(double _value=0, double _rate=0) :
+        value(_value), rate(_rate)
+      {
+      }
+
+      double value;
+
+      double rate;
+    };
+
+    inline ConversionJet operator+(const ConversionJet& _a,
+                                   const ConversionJet& _b)
+    {
+      return ConversionJet(_a.value + _b.value, _a.rate + _b.rate);
+    }
+
+    inline ConversionJet operator-(const ConversionJet& _a,
+                                   const ConversionJet& _b)
+    {
+      return ConversionJet(_a.value - _b.value, _a.rate - _b.rate);
+    }
+
+    inline ConversionJet operator-(const ConversionJet& _a)
+    {
+      return ConversionJet(-_a.value, -_a.rate);
+    }
+
+    inline ConversionJet operator*(const ConversionJet& _a,
+                                   const ConversionJet& _b)
+    {
+      return ConversionJet(_a.value * _b.value,
+                           _a.rate * _b.value + _a.value * _b.rate);
+    }
+
+    inline double JetRate(const ConversionJet& _jet)
+    {
+      return _jet.rate;
+    }
+
+    /// @brief strokes of coupled joints (dualJoint) with rates
+    struct dualJointJet
+    {
+      ConversionJet one;
+      ConversionJet two;
+    };
+
+    /// @brief spline of generated table applied to value and rate
+    inline ConversionJet SplineJet(const SplineKnot* _knots, int _size,
+                                   const ConversionJet& _x)
+    {
+      float derivative;
+      float y = SplineEval(_knots, _size, _x.value, derivative);
+      return ConversionJet(y, derivative * _x.rate);
+    }
+
+    /// @brief values of trajectory points as struct of arrays,
+    ///   value of joint j at point p is data[j * points + p]
+    template <typename T>
+    struct TrajectoryBlock
+    {
+      TrajectoryBlock() : joints(0), points(0)
+      {
+      }
+
+      /// @brief all values are 0
+      void resize(size_t _joints, size_t _points)
+      {
+        joints = _joints;
+        points = _points;
+        data.assign(_joints * _points, 0);
+      }
+
+      T& at(size_t _joint, size_t _point)
+      {
+        return data[_joint * points + _point];
+      }
+
+      const T& at(size_t _joint, size_t _point) const
+      {
+        return data[_joint * points + _point];
+      }
+
+      size_t joints;
+
+      size_t points;
+
+      std::vector<T> data;
+    };
+  }
+}
+
+#endif
@@ -10,76 +10,107 @@ Interpolation::Interpolation(int id)
   switch (id) {
   case i_constant:
     initConstant();
-    interpolate = [&](float t){ return Constant(t); };
-    set_points = [&](std::pair<float, float> p, int at) {
-      set_constant_p(p, at);
-    };
     break;
   case i_linear:
     initLinear();
-    interpolate = [&](float t){ return Linear(t); };
-    set_points = [&](std::pair<float, float> p, int at) {
-      set_linear_p(p, at);
-    };
     break;
   case i_bezier:
     initBezier();
-    interpolate = [&](float t){ return Bezier(t); };
-    set_points = [&](std::pair<float, float> p, int at) {
-      set_bezier_p(p, at);
-    };
     break;
   case i_slowout:
     initSlowOut();
-    interpolate = [&](float t){ return SlowOut(t); };
-    set_points = [&](std::pair<float, float> p, int at) {
-      set_slowout_p(p, at);
-    };
     break;
   case i_slowin:
     initSlowIn();
-    interpolate = [&](float t){ return SlowIn(t); };
-    set_points = [&](std::pair<float, float> p, int at) {
-      set_slowin_p(p, at);
-    };
     break;
   case i_sigmoid:
     initSigmoid();
-    interpolate = [&](float t){ return Sigmoid(t); };
-    set_points = [&](std::pair<float, float> p, int at) {
-      set_sigmoid_p(p, at);
-    };
     break;
   case i_cbezier:
     initCubicBezier();
-    interpolate = [&](float t){ return CubicBezier(t); };
-    set_points = [&](std::pair<float, float> p, int at) {
-      set_cubicbezier_p(p, at);
-    };
+    break;
+  default:
+    initLinear();
     break;
   }
+  compile();
 }
 
 Interpolation::~Interpolation() {
 }
 
-bool Interpolation::is(const int id)
+bool Interpolation::is(const int id) const
 {
   return (id_ == id);
 }
 
+float Interpolation::interpolate(float t) const
+{
+  int k = pieces_ - 1;
+  while (k > 0 && t < begin_[k])
+    --k;
+  float u = (t - begin_[k]) * scale_[k];
+  const float *c = coefficients_[k];
+  return ((c[3]*u + c[2])*u + c[1])*u + c[0];
+}
+
+void Interpolation::interpolate(float t0, float dt, size_t n,
+                                float *values) const
+{
+  if (n == 0) return;
+  if (dt < 0) {
+    for (size_t i = 0; i < n; ++i)
+      values[i] = interpolate(t0 + i*dt);
+    return;
+  }
+
+  int k = pieces_ - 1;
+  while (k > 0 && t0 < begin_[k])
+    --k;
+  for (size_t i = 0; i < n; ++i) {
+    float t = t0 + i*dt;
+    while (k + 1 < pieces_ && t >= begin_[k + 1])
+      ++k;
+    float u = (t - begin_[k]) * scale_[k];
+    const float *c = coefficients_[k];
+    values[i] = ((c[3]*u + c[2])*u + c[1])*u + c[0];
+  }
+}
+
+void Interpolation::set_points(std::pair<float, float> p, int at)
+{
+  switch (id_) {
+  case i_bezier:
+    set_bezier_p(p, at);
+    break;
+  case i_slowout:
+    set_slowout_p(p, at);
+    break;
+  case i_slowin:
+    set_slowin_p(p, at);
+    break;
+  case i_sigmoid:
+    set_sigmoid_p(p, at);
+    break;
+  case i_cbezier:
+    set_cubicbezier_p(p, at);
+    break;
+  default:
+    return;
+  }
+  compile();
+}
+
 void Interpolation::init(const int n)
 {
-  points_.clear();
-  points_.resize(n);
+  points_.fill({0.0, 0.0});
   points_.at(0) = {0.0, 0.0};
   points_.at(n-1) = {1.0, 1.0};
 }
 
 void Interpolation::initConstant()
 {
-  points_.clear();
-  points_.resize(2);
+  points_.fill({0.0, 0.0});
   points_.at(0) = {0.0, 0.0};
   points_.at(1) = {1.0, 0.0};
 }
@@ -132,67 +163,64 @@ void Interpolation::initCubicBezier()
   points_.at(2) = {1.0, 0.5};
 }
 
-float Interpolation::Constant(float t)
+void Interpolation::add_piece(float begin, float end,
+                              float c0, float c1, float c2, float c3)
 {
-  return 0.0;
+  if (end <= begin || pieces_ >= max_pieces) return;
+  begin_[pieces_] = begin;
+  scale_[pieces_] = 1 / (end - begin);
+  coefficients_[pieces_][0] = c0;
+  coefficients_[pieces_][1] = c1;
+  coefficients_[pieces_][2] = c2;
+  coefficients_[pieces_][3] = c3;
+  ++pieces_;
 }
 
-float Interpolation::Linear(float t)
+// bezier curves of points_ expanded in u of each piece
+void Interpolation::compile()
 {
-  return t;
-}
-
-float Interpolation::Bezier(float t)
-{
-  return 2*t*(1-t)*points_.at(1).second + t*t;
-}
-
-float Interpolation::SlowOut(float t)
-{
-  float tA = t / points_.at(1).first;
-  float tB = (t - points_.at(1).first) / (1 - points_.at(1).first);
-  float sB = 1 - tB;
-  return t <= points_.at(1).first ?
-    tA*points_.at(1).second :
-    sB*sB*points_.at(1).second + 2*sB*tB*points_.at(2).second + tB*tB;
-}
+  pieces_ = 0;
+  const std::pair<float, float> *p = points_.data();
 
-float Interpolation::SlowIn(float t)
-{
-  float tA = t / points_.at(2).first;
-  float tB = (t - points_.at(2).first) / (1 - points_.at(2).first);
-  return t <= points_.at(2).first ?
-    2*tA*(1-tA)*points_.at(1).second + tA*tA*points_.at(2).second :
-    (1 - tB)*points_.at(2).second + tB;
-}
-
-float Interpolation::Sigmoid(float t)
-{
-  float tA = t / points_.at(2).first;
-  float tB =
-    (t - points_.at(2).first) / (points_.at(3).first - points_.at(2).first);
-  float tC = (t - points_.at(3).first) / (1 - points_.at(3).first);
-  float sC = 1 - tC;
-  return t <= points_.at(2).first ?
-    2*tA*(1-tA)*points_.at(1).second + tA*tA*points_.at(2).second :
-    (t <= points_.at(3).first ?
-     (1 - tB)*points_.at(2).second + tB*points_.at(3).second :
-     sC*sC*points_.at(3).second + 2*sC*tC*points_.at(4).second + tC*tC);
-}
+  switch (id_) {
+  case i_constant:
+    add_piece(0, 1, 0, 0, 0);
+    break;
+  case i_bezier:
+    add_piece(0, 1, 0, 2*p[1].second, 1 - 2*p[1].second);
+    break;
+  case i_slowout:
+    add_piece(0, p[1].first, 0, p[1].second, 0);
+    add_piece(p[1].first, 1, p[1].second, 2*p[2].second - 2*p[1].second,
+              p[1].second - 2*p[2].second + 1);
+    break;
+  case i_slowin:
+    add_piece(0, p[2].first, 0, 2*p[1].second, p[2].second - 2*p[1].second);
+    add_piece(p[2].first, 1, p[2].second, 1 - p[2].second, 0);
+    break;
+  case i_sigmoid:
+    add_piece(0, p[2].first, 0, 2*p[1].second, p[2].second - 2*p[1].second);
+    add_piece(p[2].first, p[3].first, p[2].second, p[3].second - p[2].second, 0);
+    add_piece(p[3].first, 1, p[3].second, 2*p[4].second - 2*p[3].second,
+              p[3].second - 2*p[4].second + 1);
+    break;
+  case i_cbezier:
+    add_piece(0, 1, 0, 3*p[1].second, 3*p[2].second - 6*p[1].second,
+              3*p[1].second - 3*p[2].second + 1);
+    break;
+  }
 
-float Interpolation::CubicBezier(float t)
-{
-  float s = 1 - t;
-  return 3*s*s*t*points_.at(1).second + 3*t*t*s*points_.at(2).second
-    + t*t*t;
+  // linear for unknown id or degenerate points
+  if (pieces_ == 0)
+    add_piece(0, 1, 0, 1, 0);
 }
 
-void Interpolation::set_bezier_p(std::pair<float, float> p, int id)
+void Interpolation::set_bezier_p(std::pair<float, float> p, int)
 {
   points_.at(1) = p; 
 }
 
-void Interpolation::set_slowout_p(std::pair<float, float> p, int id)
+void Interpolation::set_slowout_p(std::pair<float, float> p, int)
 {
   points_.at(1) = p;
   if (points_.at(1).first > points_.at(1).second)
@@ -200,7 +228,7 @@ void Interpolation::set_slowout_p(std::pair<float, float> p, int id)
   points_.at(2) = {points_.at(1).first/points_.at(1).second, 1.0};
 }
 
-void Interpolation::set_slowin_p(std::pair<float, float> p, int id)
+void Interpolation::set_slowin_p(std::pair<float, float> p, int)
 {
   points_.at(2) = p;
   if (points_.at(2).first < points_.at(2).second)
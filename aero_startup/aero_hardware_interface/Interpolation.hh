@@ -1,10 +1,9 @@
 #ifndef AERO_INTERPOLATION_H_
 #define AERO_INTERPOLATION_H_
 
-#include <vector>
-#include <map>
-#include <functional>
-#include <memory>
+#include <array>
+#include <utility>
+#include <cstddef>
 
 namespace aero
 {
@@ -25,54 +24,78 @@ namespace aero
 
     static const int i_cbezier = 6;
 
+    /// @brief interpolation curve from (0, 0) to (1, 1),
+    ///   compiled into at most three polynomial pieces
+    ///   when it is created or its points are set
+    ///
+    /// Holds no pointer nor heap memory, copies are as cheap as a few floats
+    /// and evaluation is a search of the piece and a cubic polynomial.
     class Interpolation
     {
-    public: Interpolation(int id);
+    public: explicit Interpolation(int id);
 
     public: ~Interpolation();
 
-    public: bool is(const int id);
+    public: bool is(const int id) const;
 
-    public: std::function<float(float)> interpolate;
+      /// @brief value of curve at t, t in [0, 1]
+    public: float interpolate(float t) const;
 
-    public: std::function<void(std::pair<float, float>, int)> set_points;
+      /// @brief values of curve at t0, t0 + dt, ..., n values,
+      ///   e.g. all splits of a segment, pieces are walked in order
+      ///   instead of searched for each value
+    public: void interpolate(float t0, float dt, size_t n, float *values) const;
+
+    public: void set_points(std::pair<float, float> p, int at);
 
     private: void init(const int n);
 
+      /// @brief compute pieces from points_
+    private: void compile();
+
     private: void initConstant();
-    private: float Constant(float t);
-    private: void set_constant_p(std::pair<float, float> p, int at) {};
+    private: void set_constant_p(std::pair<float, float>, int) {};
 
     private: void initLinear();
-    private: float Linear(float t);
-    private: void set_linear_p(std::pair<float, float> p, int at) {};
+    private: void set_linear_p(std::pair<float, float>, int) {};
 
     private: void initBezier();
-    private: float Bezier(float t);
     private: void set_bezier_p(std::pair<float, float> p, int at=0);
 
     private: void initSlowIn();
-    private: float SlowIn(float t);
     private: void set_slowin_p(std::pair<float, float> p, int at=0);
 
     private: void initSlowOut();
-    private: float SlowOut(float t);
     private: void set_slowout_p(std::pair<float, float> p, int at=0);
 
     private: void initSigmoid();
-    private: float Sigmoid(float t);
     private: void set_sigmoid_p(std::pair<float, float> p, int at);
 
     private: void initCubicBezier();
-    private: float CubicBezier(float t);
     private: void set_cubicbezier_p(std::pair<float, float> p, int at);
 
+      /// @brief add piece of curve from begin to next piece,
+      ///   c0 + c1 u + c2 u^2 + c3 u^3 with u from 0 at begin to 1 at end
+    private: void add_piece(float begin, float end,
+                            float c0, float c1, float c2, float c3=0.0f);
+
     private: int id_;
 
-    private: std::vector<std::pair<float, float> > points_;
+    private: std::array<std::pair<float, float>, 6> points_;
+
+    private: static const int max_pieces = 3;
+
+    private: int pieces_;
+
+      /// @brief t where each piece begins
+    private: float begin_[max_pieces];
+
+      /// @brief 1 / length of each piece in t
+    private: float scale_[max_pieces];
+
+    private: float coefficients_[max_pieces][4];
     };
 
-    typedef std::shared_ptr<Interpolation> InterpolationPtr;
   }
 }
 
@@ -0,0 +1,129 @@
+#ifndef AERO_CONTROLLER_SEED_BUS_DIAGNOSTICS_H_
+#define AERO_CONTROLLER_SEED_BUS_DIAGNOSTICS_H_
+
+#include <string>
+
+#include <diagnostic_msgs/DiagnosticArray.h>
+#include <diagnostic_msgs/DiagnosticStatus.h>
+#include <diagnostic_msgs/KeyValue.h>
+
+#include "aero_hardware_interface/SEEDBusStats.hh"
+#include "aero_hardware_interface/TrajectoryExecutor.hh"
+
+namespace aero
+{
+  namespace controller
+  {
+    /// @brief append one counter to status
+    inline void add_bus_value_(diagnostic_msgs::DiagnosticStatus& _status,
+                               const std::string& _key, uint64_t _value)
+    {
+      diagnostic_msgs::KeyValue kv;
+      kv.key = _key;
+      kv.value = std::to_string(_value);
+      _status.values.push_back(kv);
+    }
+
+    /// @brief diagnostic status of one port
+    /// @param _name port name shown in diagnostics, e.g. "upper"
+    /// @param _stats counters of port
+    /// @param _last counters at previous call, level is WARN
+    ///   if errors increased since then
+    inline diagnostic_msgs::DiagnosticStatus bus_diagnostics(
+        const std::string& _name, const SEEDBusStats& _stats,
+        const SEEDBusStats& _last)
+    {
+      diagnostic_msgs::DiagnosticStatus status;
+      status.name = "aero bus: " + _name;
+      status.hardware_id = _name;
+      status.level = diagnostic_msgs::DiagnosticStatus::OK;
+      status.message = "OK";
+      if (_stats.disconnects > _stats.reconnects) {
+        status.level = diagnostic_msgs::DiagnosticStatus::ERROR;
+        status.message = "port lost, reconnecting";
+      } else if (_stats.frames_received == 0) {
+        status.level = diagnostic_msgs::DiagnosticStatus::STALE;
+        status.message = "no frame received";
+      } else if (_stats.reply_timeouts > _last.reply_timeouts ||
+                 _stats.read_timeouts > _last.read_timeouts ||
+                 _stats.short_reads > _last.short_reads ||
+                 _stats.checksum_errors > _last.checksum_errors ||
+                 _stats.resyncs > _last.resyncs) {
+        status.level = diagnostic_msgs::DiagnosticStatus::WARN;
+        status.message = "bus errors";
+      }
+
+      add_bus_value_(status, "frames sent", _stats.frames_sent);
+      add_bus_value_(status, "frames received", _stats.frames_received);
+      add_bus_value_(status, "bytes sent", _stats.bytes_sent);
+      add_bus_value_(status, "bytes received", _stats.bytes_received);
+      add_bus_value_(status, "checksum errors", _stats.checksum_errors);
+      add_bus_value_(status, "resyncs", _stats.resyncs);
+      add_bus_value_(status, "skipped bytes", _stats.skipped_bytes);
+      add_bus_value_(status, "short reads", _stats.short_reads);
+      add_bus_value_(status, "reply timeouts", _stats.reply_timeouts);
+      add_bus_value_(status, "read timeouts", _stats.read_timeouts);
+      add_bus_value_(status, "unmatched frames", _stats.unmatched_frames);
+      add_bus_value_(status, "ready time [us]", _stats.ready_time);
+      add_bus_value_(status, "disconnects", _stats.disconnects);
+      add_bus_value_(status, "reconnects", _stats.reconnects);
+      add_bus_value_(status, "downtime [us]", _stats.downtime);
+      add_bus_value_(status, "safety wait max [us]",
+                     _stats.lane_wait_max[SEED_LANE_SAFETY]);
+      add_bus_value_(status, "position wait max [us]",
+                     _stats.lane_wait_max[SEED_LANE_POSITION]);
+      add_bus_value_(status, "telemetry wait max [us]",
+                     _stats.lane_wait_max[SEED_LANE_TELEMETRY]);
+      add_bus_value_(status, "latency p50 [us]", _stats.latency_percentile(0.5));
+      add_bus_value_(status, "latency p99 [us]", _stats.latency_percentile(0.99));
+      add_bus_value_(status, "latency max [us]", _stats.latency_max);
+
+      return status;
+    }
+
+    /// @brief diagnostic status of trajectory executor of one board
+    /// @param _name board name shown in diagnostics, e.g. "upper"
+    /// @param _stats counters of executor
+    /// @param _period frame period in use[csec]
+    /// @param _bus_time mean time from frame sent to reply of board[ns],
+    ///   level is WARN if longer than frame period
+    inline diagnostic_msgs::DiagnosticStatus executor_diagnostics(
+        const std::string& _name, const HandoverStats& _stats,
+        float _period, int64_t _bus_time)
+    {
+      diagnostic_msgs::DiagnosticStatus status;
+      status.name = "aero executor: " + _name;
+      status.hardware_id = _name;
+      status.level = diagnostic_msgs::DiagnosticStatus::OK;
+      status.message = "OK";
+      if (_bus_time > _period * 1e7) {
+        status.level = diagnostic_msgs::DiagnosticStatus::WARN;
+        status.message = "frame period shorter than bus time";
+      }
+
+      add_bus_value_(status, "trajectories", _stats.trajectories);
+      add_bus_value_(status, "takeovers", _stats.takeovers);
+      add_bus_value_(status, "handover latency [us]", _stats.last_latency);
+      add_bus_value_(status, "handover latency max [us]", _stats.max_latency);
+      add_bus_value_(status, "handover latency mean [us]",
+                     _stats.trajectories > 0 ?
+                     _stats.total_latency / _stats.trajectories : 0);
+      add_bus_value_(status, "finished", _stats.finished);
+      diagnostic_msgs::KeyValue kv;
+      kv.key = "timing error [us]";
+      kv.value = std::to_string(_stats.last_timing_error);
+      status.values.push_back(kv);
+      add_bus_value_(status, "timing error max [us]", _stats.max_timing_error);
+      add_bus_value_(status, "frame period [us]",
+                     static_cast<uint64_t>(_period * 1e4));
+      add_bus_value_(status, "frame bus time [us]", _bus_time / 1000);
+      // highest frame rate the board keeps up with
+      add_bus_value_(status, "max frame rate [Hz]",
+                     _bus_time > 0 ? 1000000000 / _bus_time : 0);
+
+      return status;
+    }
+  }
+}
+
+#endif
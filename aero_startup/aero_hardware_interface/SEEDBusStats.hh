@@ -0,0 +1,123 @@
+#ifndef AERO_CONTROLLER_SEED_BUS_STATS_H_
+#define AERO_CONTROLLER_SEED_BUS_STATS_H_
+
+#include <stdint.h>
+#include <cstddef>
+
+#include "aero_hardware_interface/CommandList.hh"
+
+namespace aero
+{
+  namespace controller
+  {
+    // latency buckets, bucket i counts [2^i, 2^(i+1)) us, last is open
+    const static size_t SEED_LATENCY_BUCKETS = 20;
+
+    /// @brief health and throughput counters of one port
+    struct SEEDBusStats
+    {
+      SEEDBusStats() : frames_sent(0), frames_received(0),
+        bytes_sent(0), bytes_received(0), checksum_errors(0),
+        resyncs(0), skipped_bytes(0), short_reads(0),
+        reply_timeouts(0), read_timeouts(0), unmatched_frames(0),
+        ready_time(0),
+        disconnects(0), reconnects(0), downtime(0), latency_max(0)
+      {
+        for (size_t i = 0; i < SEED_LATENCY_BUCKETS; ++i)
+          latency_histogram[i] = 0;
+        for (size_t i = 0; i < SEED_LANES; ++i) {
+          lane_frames[i] = 0;
+          lane_wait_max[i] = 0;
+        }
+      }
+
+      uint64_t frames_sent;
+
+      uint64_t frames_received;
+
+      uint64_t bytes_sent;
+
+      uint64_t bytes_received;
+
+      /// @brief frames dropped by checksum
+      uint64_t checksum_errors;
+
+      /// @brief times the decoder searched for next header
+      uint64_t resyncs;
+
+      /// @brief bytes dropped while searching header
+      uint64_t skipped_bytes;
+
+      /// @brief read returned a frame of unexpected length
+      uint64_t short_reads;
+
+      /// @brief commands whose reply did not come in time
+      uint64_t reply_timeouts;
+
+      /// @brief read found no frame in time
+      uint64_t read_timeouts;
+
+      /// @brief frames not matched to any command
+      uint64_t unmatched_frames;
+
+      /// @brief time from opening port to first reply of board[us],
+      ///   last open or reconnect
+      uint64_t ready_time;
+
+      /// @brief times port was lost by read or write error
+      uint64_t disconnects;
+
+      /// @brief times lost port was reopened and board replied
+      uint64_t reconnects;
+
+      /// @brief total time from losing port to board reply[us]
+      uint64_t downtime;
+
+      /// @brief frames written from each SEEDLane
+      uint64_t lane_frames[SEED_LANES];
+
+      /// @brief longest time from queueing a command to end of its write
+      ///   for each SEEDLane[us]
+      uint64_t lane_wait_max[SEED_LANES];
+
+      /// @brief round trip from write of command to its reply
+      uint64_t latency_histogram[SEED_LATENCY_BUCKETS];
+
+      /// @brief longest round trip[us]
+      uint64_t latency_max;
+
+      /// @brief add a round trip to histogram
+      /// @param _usec latency[us]
+      void add_latency(uint64_t _usec)
+      {
+        if (_usec > latency_max) latency_max = _usec;
+        size_t i = 0;
+        while (_usec > 1 && i + 1 < SEED_LATENCY_BUCKETS) {
+          _usec >>= 1;
+          ++i;
+        }
+        ++latency_histogram[i];
+      }
+
+      /// @brief upper bound of bucket holding the given fraction of round trips
+      /// @param _p fraction, 0.5 for median
+      /// @return latency[us], 0 if no round trip
+      uint64_t latency_percentile(double _p) const
+      {
+        uint64_t total = 0;
+        for (size_t i = 0; i < SEED_LATENCY_BUCKETS; ++i)
+          total += latency_histogram[i];
+        if (total == 0) return 0;
+
+        uint64_t count = 0;
+        for (size_t i = 0; i < SEED_LATENCY_BUCKETS; ++i) {
+          count += latency_histogram[i];
+          if (count >= _p * total) return static_cast<uint64_t>(2) << i;
+        }
+        return static_cast<uint64_t>(2) << (SEED_LATENCY_BUCKETS - 1);
+      }
+    };
+  }
+}
+
+#endif
@@ -0,0 +1,194 @@
+#include "aero_hardware_interface/SEEDCapture.hh"
+
+#include <iostream>
+#include <algorithm>
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+using namespace aero;
+using namespace controller;
+
+static const char SEED_CAPTURE_MAGIC[8] = "SEEDCAP";
+
+//////////////////////////////////////////////////
+SEEDCapture::SEEDCapture() :
+  fd_(-1), map_size_(0), header_(NULL), records_(NULL)
+{
+}
+
+//////////////////////////////////////////////////
+SEEDCapture::~SEEDCapture()
+{
+  close();
+}
+
+//////////////////////////////////////////////////
+bool SEEDCapture::open(const std::string& _path, size_t _slots)
+{
+  close();
+  if (_slots == 0) return false;
+
+  fd_ = ::open(_path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+  if (fd_ < 0) {
+    std::cerr << "Capture: ERROR: could not create " << _path << std::endl;
+    return false;
+  }
+
+  // allocate whole file now, no block allocation while recording
+  map_size_ = sizeof(SEEDCaptureHeader) + _slots * sizeof(SEEDCaptureRecord);
+  if (::posix_fallocate(fd_, 0, map_size_) != 0 &&
+      ::ftruncate(fd_, map_size_) != 0) {
+    std::cerr << "Capture: ERROR: could not allocate " << _path << std::endl;
+    close();
+    return false;
+  }
+
+  void* map = ::mmap(NULL, map_size_, PROT_READ | PROT_WRITE, MAP_SHARED,
+                     fd_, 0);
+  if (map == MAP_FAILED) {
+    std::cerr << "Capture: ERROR: could not map " << _path << std::endl;
+    close();
+    return false;
+  }
+
+  header_ = static_cast<SEEDCaptureHeader*>(map);
+  records_ = reinterpret_cast<SEEDCaptureRecord*>(header_ + 1);
+
+  std::memset(header_, 0, sizeof(SEEDCaptureHeader));
+  std::memcpy(header_->magic, SEED_CAPTURE_MAGIC, sizeof(header_->magic));
+  header_->version = SEED_CAPTURE_VERSION;
+  header_->record_size = sizeof(SEEDCaptureRecord);
+  header_->slots = _slots;
+  header_->start_time =
+    std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+  start_ = std::chrono::steady_clock::now();
+
+  return true;
+}
+
+//////////////////////////////////////////////////
+void SEEDCapture::close()
+{
+  if (header_) {
+    ::msync(header_, map_size_, MS_ASYNC);
+    ::munmap(header_, map_size_);
+  }
+  if (fd_ >= 0) ::close(fd_);
+  header_ = NULL;
+  records_ = NULL;
+  fd_ = -1;
+  map_size_ = 0;
+}
+
+//////////////////////////////////////////////////
+void SEEDCapture::record(SEEDCaptureDirection _direction,
+                         const uint8_t* _data, size_t _length)
+{
+  if (!header_) return;
+
+  uint64_t count = header_->count;
+  SEEDCaptureRecord& record = records_[count % header_->slots];
+  record.stamp = std::chrono::duration_cast<std::chrono::nanoseconds>(
+      std::chrono::steady_clock::now() - start_).count();
+  record.direction = static_cast<uint8_t>(_direction);
+  record.length = static_cast<uint8_t>(std::min<size_t>(_length, RAW_DATA_LENGTH));
+  std::memcpy(record.data, _data, record.length);
+
+  // record is complete before a reader sees it
+  __atomic_store_n(&header_->count, count + 1, __ATOMIC_RELEASE);
+}
+
+//////////////////////////////////////////////////
+SEEDCaptureReader::SEEDCaptureReader() :
+  fd_(-1), map_size_(0), header_(NULL), records_(NULL)
+{
+}
+
+//////////////////////////////////////////////////
+SEEDCaptureReader::~SEEDCaptureReader()
+{
+  close();
+}
+
+//////////////////////////////////////////////////
+bool SEEDCaptureReader::open(const std::string& _path)
+{
+  close();
+
+  fd_ = ::open(_path.c_str(), O_RDONLY);
+  struct stat st;
+  if (fd_ < 0 || ::fstat(fd_, &st) != 0 ||
+      static_cast<size_t>(st.st_size) < sizeof(SEEDCaptureHeader)) {
+    std::cerr << "Capture: ERROR: could not read " << _path << std::endl;
+    close();
+    return false;
+  }
+
+  map_size_ = st.st_size;
+  void* map = ::mmap(NULL, map_size_, PROT_READ, MAP_SHARED, fd_, 0);
+  if (map == MAP_FAILED) {
+    std::cerr << "Capture: ERROR: could not map " << _path << std::endl;
+    close();
+    return false;
+  }
+  header_ = static_cast<const SEEDCaptureHeader*>(map);
+  records_ = reinterpret_cast<const SEEDCaptureRecord*>(header_ + 1);
+
+  if (std::memcmp(header_->magic, SEED_CAPTURE_MAGIC, sizeof(header_->magic)) != 0
+      || header_->version != SEED_CAPTURE_VERSION
+      || header_->record_size != sizeof(SEEDCaptureRecord)
+      || map_size_ < sizeof(SEEDCaptureHeader)
+                     + header_->slots * sizeof(SEEDCaptureRecord)) {
+    std::cerr << "Capture: ERROR: " << _path << " is not a capture" << std::endl;
+    close();
+    return false;
+  }
+
+  return true;
+}
+
+//////////////////////////////////////////////////
+void SEEDCaptureReader::close()
+{
+  if (header_)
+    ::munmap(const_cast<SEEDCaptureHeader*>(header_), map_size_);
+  if (fd_ >= 0) ::close(fd_);
+  header_ = NULL;
+  records_ = NULL;
+  fd_ = -1;
+  map_size_ = 0;
+}
+
+//////////////////////////////////////////////////
+size_t SEEDCaptureReader::size()
+{
+  if (!header_) return 0;
+  uint64_t count = __atomic_load_n(&header_->count, __ATOMIC_ACQUIRE);
+  return static_cast<size_t>(std::min<uint64_t>(count, header_->slots));
+}
+
+//////////////////////////////////////////////////
+uint64_t SEEDCaptureReader::dropped()
+{
+  if (!header_) return 0;
+  uint64_t count = __atomic_load_n(&header_->count, __ATOMIC_ACQUIRE);
+  return count > header_->slots ? count - header_->slots : 0;
+}
+
+//////////////////////////////////////////////////
+int64_t SEEDCaptureReader::start_time()
+{
+  return header_ ? header_->start_time : 0;
+}
+
+//////////////////////////////////////////////////
+const SEEDCaptureRecord& SEEDCaptureReader::at(size_t _i)
+{
+  uint64_t count = __atomic_load_n(&header_->count, __ATOMIC_ACQUIRE);
+  uint64_t first = count > header_->slots ? count - header_->slots : 0;
+  return records_[(first + _i) % header_->slots];
+}
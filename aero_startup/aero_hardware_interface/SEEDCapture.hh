@@ -0,0 +1,144 @@
+#ifndef AERO_CONTROLLER_SEED_CAPTURE_H_
+#define AERO_CONTROLLER_SEED_CAPTURE_H_
+
+#include <string>
+#include <chrono>
+#include <stdint.h>
+#include <cstddef>
+
+#include "aero_hardware_interface/SEEDFrame.hh"
+
+namespace aero
+{
+  namespace controller
+  {
+    // default number of frames kept in capture file, 5 MB
+    const static size_t SEED_CAPTURE_SLOTS = 65536;
+
+    const static uint32_t SEED_CAPTURE_VERSION = 1;
+
+    /// @brief direction of captured frame
+    enum SEEDCaptureDirection
+    {
+      SEED_CAPTURE_TX = 0,  // PC to board
+      SEED_CAPTURE_RX = 1   // board to PC
+    };
+
+    /// @brief head of capture file
+    struct SEEDCaptureHeader
+    {
+      /// @brief "SEEDCAP"
+      char magic[8];
+
+      uint32_t version;
+
+      /// @brief sizeof(SEEDCaptureRecord)
+      uint32_t record_size;
+
+      /// @brief number of records in ring
+      uint64_t slots;
+
+      /// @brief records ever written, ring wraps when larger than slots
+      uint64_t count;
+
+      /// @brief wall clock at start of capture[ns since epoch]
+      int64_t start_time;
+
+      uint8_t reserved[24];
+    };
+
+    /// @brief one frame in capture file
+    struct SEEDCaptureRecord
+    {
+      /// @brief time since start of capture[ns], steady clock
+      int64_t stamp;
+
+      /// @brief SEEDCaptureDirection
+      uint8_t direction;
+
+      /// @brief number of valid bytes in data
+      uint8_t length;
+
+      uint8_t reserved[6];
+
+      /// @brief raw bytes, header included
+      uint8_t data[RAW_DATA_LENGTH];
+    };
+
+    /// @brief writes frames to a preallocated memory mapped ring file
+    ///
+    /// The file is sized at open, so record() is a copy to mapped memory
+    /// without system call or allocation. When the ring is full
+    /// the oldest frames are overwritten.
+    /// Only one thread may call record().
+    class SEEDCapture
+    {
+     public: SEEDCapture();
+
+     public: ~SEEDCapture();
+
+      /// @brief create capture file, truncated if exists
+      /// @param _path file name
+      /// @param _slots frames kept in ring
+      /// @return false if file could not be created
+     public: bool open(const std::string& _path,
+                       size_t _slots=SEED_CAPTURE_SLOTS);
+
+     public: void close();
+
+     public: bool is_open() {return header_ != NULL;}
+
+      /// @brief append one frame
+      /// @param _direction SEEDCaptureDirection
+      /// @param _data frame bytes, longer frames are cut at RAW_DATA_LENGTH
+      /// @param _length number of bytes
+     public: void record(SEEDCaptureDirection _direction,
+                         const uint8_t* _data, size_t _length);
+
+     private: int fd_;
+
+     private: size_t map_size_;
+
+     private: SEEDCaptureHeader* header_;
+
+     private: SEEDCaptureRecord* records_;
+
+     private: std::chrono::steady_clock::time_point start_;
+    };
+
+    /// @brief reads a capture file, written one or still being written
+    class SEEDCaptureReader
+    {
+     public: SEEDCaptureReader();
+
+     public: ~SEEDCaptureReader();
+
+      /// @return false if file could not be read or is not a capture
+     public: bool open(const std::string& _path);
+
+     public: void close();
+
+      /// @brief number of frames available, at most slots
+     public: size_t size();
+
+      /// @brief frames overwritten because ring was full
+     public: uint64_t dropped();
+
+      /// @brief wall clock at start of capture[ns since epoch]
+     public: int64_t start_time();
+
+      /// @brief frame in time order, 0 is oldest
+     public: const SEEDCaptureRecord& at(size_t _i);
+
+     private: int fd_;
+
+     private: size_t map_size_;
+
+     private: const SEEDCaptureHeader* header_;
+
+     private: const SEEDCaptureRecord* records_;
+    };
+  }
+}
+
+#endif
@@ -0,0 +1,377 @@
+#include "aero_hardware_interface/SEEDEmulator.hh"
+
+#include <iostream>
+#include <cmath>
+#include <fcntl.h>
+#include <poll.h>
+#include <stdlib.h>
+#include <termios.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+using namespace aero;
+using namespace controller;
+
+//////////////////////////////////////////////////
+SEEDEmulator::SEEDEmulator(const SEEDEmulatorConfig& _config) :
+  config_(_config), master_(-1), slave_(-1), running_(false),
+  random_(_config.random_seed), servo_on_(_config.servo_on),
+  commands_received_(0), replies_sent_(0),
+  replies_dropped_(0), replies_corrupted_(0)
+{
+  boost::posix_time::ptime now =
+    boost::posix_time::microsec_clock::universal_time();
+  for (size_t i = 0; i < SEED_EMULATOR_AXES; ++i) {
+    Axis& axis = axes_[i];
+    axis.position = axis.start = axis.target = 0.0;
+    axis.start_time = now;
+    axis.duration = 0.0;
+    axis.step_out = false;
+  }
+  std::fill(scripts_, scripts_ + 256, 0);
+}
+
+//////////////////////////////////////////////////
+SEEDEmulator::~SEEDEmulator()
+{
+  close();
+}
+
+//////////////////////////////////////////////////
+bool SEEDEmulator::open(const std::string& _link)
+{
+  master_ = posix_openpt(O_RDWR | O_NOCTTY);
+  if (master_ < 0 || grantpt(master_) != 0 || unlockpt(master_) != 0) {
+    std::cerr << "Emulator: ERROR: could not open pty" << std::endl;
+    close();
+    return false;
+  }
+  port_name_ = ptsname(master_);
+
+  // raw mode before any client opens the slave, no echo
+  slave_ = ::open(port_name_.c_str(), O_RDWR | O_NOCTTY);
+  if (slave_ >= 0) {
+    struct termios tio;
+    ::tcgetattr(slave_, &tio);
+    ::cfmakeraw(&tio);
+    ::tcsetattr(slave_, TCSANOW, &tio);
+  }
+
+  if (_link != "") {
+    // replace only a stale link, never a real device
+    struct stat st;
+    if (::lstat(_link.c_str(), &st) == 0 && S_ISLNK(st.st_mode))
+      ::unlink(_link.c_str());
+    if (::symlink(port_name_.c_str(), _link.c_str()) != 0) {
+      std::cerr << "Emulator: ERROR: could not create " << _link << std::endl;
+    } else {
+      link_ = _link;
+    }
+  }
+
+  running_ = true;
+  thread_ = boost::thread(&SEEDEmulator::run_, this);
+  return true;
+}
+
+//////////////////////////////////////////////////
+void SEEDEmulator::close()
+{
+  running_ = false;
+  if (thread_.joinable()) thread_.join();
+
+  if (link_ != "") {
+    ::unlink(link_.c_str());
+    link_ = "";
+  }
+  if (slave_ >= 0) ::close(slave_);
+  if (master_ >= 0) ::close(master_);
+  slave_ = master_ = -1;
+}
+
+//////////////////////////////////////////////////
+int16_t SEEDEmulator::position(size_t _axis)
+{
+  boost::mutex::scoped_lock lock(mtx_);
+  update_(boost::posix_time::microsec_clock::universal_time());
+  return static_cast<int16_t>(std::lround(axes_[_axis].position));
+}
+
+//////////////////////////////////////////////////
+void SEEDEmulator::set_position(size_t _axis, int16_t _position)
+{
+  boost::mutex::scoped_lock lock(mtx_);
+  Axis& axis = axes_[_axis];
+  axis.position = axis.start = axis.target = _position;
+  axis.duration = 0.0;
+}
+
+//////////////////////////////////////////////////
+void SEEDEmulator::set_step_out(size_t _axis, bool _step_out)
+{
+  boost::mutex::scoped_lock lock(mtx_);
+  axes_[_axis].step_out = _step_out;
+}
+
+//////////////////////////////////////////////////
+uint8_t SEEDEmulator::script(size_t _sendnum)
+{
+  boost::mutex::scoped_lock lock(mtx_);
+  return scripts_[_sendnum & 0xff];
+}
+
+//////////////////////////////////////////////////
+size_t SEEDEmulator::commands_received()
+{
+  boost::mutex::scoped_lock lock(mtx_);
+  return commands_received_;
+}
+
+//////////////////////////////////////////////////
+size_t SEEDEmulator::replies_sent()
+{
+  boost::mutex::scoped_lock lock(mtx_);
+  return replies_sent_;
+}
+
+//////////////////////////////////////////////////
+size_t SEEDEmulator::replies_dropped()
+{
+  boost::mutex::scoped_lock lock(mtx_);
+  return replies_dropped_;
+}
+
+//////////////////////////////////////////////////
+size_t SEEDEmulator::replies_corrupted()
+{
+  boost::mutex::scoped_lock lock(mtx_);
+  return replies_corrupted_;
+}
+
+//////////////////////////////////////////////////
+size_t SEEDEmulator::checksum_errors()
+{
+  boost::mutex::scoped_lock lock(mtx_);
+  return decoder_.checksum_errors;
+}
+
+//////////////////////////////////////////////////
+void SEEDEmulator::run_()
+{
+  SEEDFrame command;
+  SEEDFrame reply;
+
+  while (running_) {
+    struct pollfd fd;
+    fd.fd = master_;
+    fd.events = POLLIN;
+    if (::poll(&fd, 1, 20) <= 0 || !(fd.revents & POLLIN)) continue;
+
+    // mtx_ is not held while blocking in read or write
+    boost::mutex::scoped_lock lock(mtx_);
+    size_t space;
+    uint8_t* at = decoder_.prepare(space);
+    lock.unlock();
+    ssize_t n = ::read(master_, at, space);
+    if (n <= 0) continue;
+    lock.lock();
+    decoder_.commit(at, n);
+
+    while (decoder_.next(command)) {
+      ++commands_received_;
+      update_(boost::posix_time::microsec_clock::universal_time());
+      handle_(command, reply);
+      lock.unlock();
+      // command itself takes time on the bus
+      if (config_.baud_rate > 0)
+        usleep(command.length * 10 * 1000000LL / config_.baud_rate);
+      if (reply.length > 0) write_(reply);
+      lock.lock();
+    }
+  }
+}
+
+//////////////////////////////////////////////////
+void SEEDEmulator::handle_(const SEEDFrame& _command, SEEDFrame& _reply)
+{
+  _reply.length = 0;
+  std::fill(_reply.data, _reply.data + RAW_DATA_LENGTH, 0);
+
+  uint8_t cmd = _command.cmd();
+  bool full = (_command.length == RAW_DATA_LENGTH);
+  const uint8_t* raw = _command.data + RAW_HEADER_OFFSET;
+  boost::posix_time::ptime now =
+    boost::posix_time::microsec_clock::universal_time();
+
+  switch (cmd) {
+  case CMD_MOVE_ABS_POS:
+  case CMD_MOVE_ABS_POS_RET:
+  case CMD_MOVE_SPD:
+    if (!full) {
+      // single command: axis from 1, position, no time and no reply
+      size_t axis = _command.data[4];
+      if (_command.length != RAW_SHORT_COMMAND_LENGTH
+          || axis < 1 || axis > SEED_EMULATOR_AXES) break;
+      if (servo_on_ && cmd != CMD_MOVE_SPD) {
+        Axis& a = axes_[axis - 1];
+        a.start = a.position;
+        a.target = static_cast<int16_t>(
+            (_command.data[5] << 8) | _command.data[6]);
+        a.start_time = now;
+        a.duration = 0.0;
+        a.position = a.target;
+      }
+      break;
+    } else if (servo_on_) {
+      // time is in 10ms
+      double duration =
+        ((_command.data[65] << 8) | _command.data[66]) * 0.01;
+      for (size_t i = 0; i < SEED_EMULATOR_AXES; ++i) {
+        int16_t target = static_cast<int16_t>((raw[i * 2] << 8) | raw[i * 2 + 1]);
+        if (target == 0x7fff || cmd == CMD_MOVE_SPD) continue;
+        Axis& axis = axes_[i];
+        axis.start = axis.position;
+        axis.target = target;
+        axis.start_time = now;
+        axis.duration = duration;
+        if (duration <= 0.0) axis.position = target;
+      }
+    }
+    if (cmd == CMD_MOVE_ABS_POS) break;  // no reply
+    // MOVE and TURN return current position
+    // fall through
+  case CMD_GET_POS:
+    for (size_t i = 0; i < SEED_EMULATOR_AXES; ++i) {
+      int16_t position = static_cast<int16_t>(std::lround(axes_[i].position));
+      _reply.data[RAW_HEADER_OFFSET + i * 2] = (position >> 8) & 0xff;
+      _reply.data[RAW_HEADER_OFFSET + i * 2 + 1] = position & 0xff;
+    }
+    finish_reply_(_reply, cmd, RAW_DATA_LENGTH);
+    break;
+  case CMD_GET_CUR:
+    for (size_t i = 0; i < SEED_EMULATOR_AXES; ++i) {
+      // moving actuators draw more current
+      const Axis& axis = axes_[i];
+      int16_t current = (axis.position != axis.target) ? 100 : 10;
+      _reply.data[RAW_HEADER_OFFSET + i * 2] = (current >> 8) & 0xff;
+      _reply.data[RAW_HEADER_OFFSET + i * 2 + 1] = current & 0xff;
+    }
+    finish_reply_(_reply, cmd, RAW_DATA_LENGTH);
+    break;
+  case CMD_GET_TMP_VOLT:
+    if (!full) {
+      // short command asks voltage
+      uint16_t voltage = static_cast<uint16_t>(config_.voltage * 10);
+      _reply.data[4] = _command.data[4];
+      _reply.data[RAW_HEADER_OFFSET] = (voltage >> 8) & 0xff;
+      _reply.data[RAW_HEADER_OFFSET + 1] = voltage & 0xff;
+      finish_reply_(_reply, cmd, 8);
+      break;
+    }
+    for (size_t i = 0; i < SEED_EMULATOR_AXES; ++i) {
+      _reply.data[RAW_HEADER_OFFSET + i * 2] = (config_.temperature >> 8) & 0xff;
+      _reply.data[RAW_HEADER_OFFSET + i * 2 + 1] = config_.temperature & 0xff;
+    }
+    finish_reply_(_reply, cmd, RAW_DATA_LENGTH);
+    break;
+  case CMD_WATCH_MISSTEP:
+    {
+      // sub command 0xff clears step out
+      if (full && _command.data[4] == 0xff)
+        for (size_t i = 0; i < SEED_EMULATOR_AXES; ++i)
+          axes_[i].step_out = false;
+      bool step_out = false;
+      for (size_t i = 0; i < SEED_EMULATOR_AXES; ++i) {
+        int16_t position = static_cast<int16_t>(std::lround(axes_[i].position));
+        _reply.data[RAW_HEADER_OFFSET + i * 2] = (position >> 8) & 0xff;
+        _reply.data[RAW_HEADER_OFFSET + i * 2 + 1] = position & 0xff;
+        step_out = step_out || axes_[i].step_out;
+      }
+      _reply.data[RAW_HEADER_OFFSET + 60] = step_out ? 0x20 : 0x00;
+      _reply.data[RAW_HEADER_OFFSET + 61] = step_out ? 0x20 : 0x00;
+      finish_reply_(_reply, cmd, RAW_DATA_LENGTH);
+    }
+    break;
+  case CMD_GET_VERSION:
+    std::copy(config_.version, config_.version + 5,
+              _reply.data + RAW_HEADER_OFFSET);
+    finish_reply_(_reply, cmd, RAW_HEADER_OFFSET + 5 + 1);
+    break;
+  case CMD_MOTOR_SRV:
+    // 68 bytes: per actuator, 8 bytes: data at 5, 6
+    if (full) {
+      bool on = false;
+      for (size_t i = 0; i < SEED_EMULATOR_AXES; ++i)
+        on = on || raw[i * 2 + 1] != 0;
+      servo_on_ = on;
+    } else if (_command.length >= 8) {
+      servo_on_ = (_command.data[6] != 0);
+    }
+    break;
+  case 0x22:  // execute script
+    if (_command.length >= 8)
+      scripts_[_command.data[4]] = _command.data[6];
+    break;
+  default:
+    // settings and unknown commands have no reply
+    break;
+  }
+}
+
+//////////////////////////////////////////////////
+void SEEDEmulator::update_(const boost::posix_time::ptime& _now)
+{
+  for (size_t i = 0; i < SEED_EMULATOR_AXES; ++i) {
+    Axis& axis = axes_[i];
+    if (axis.position == axis.target) continue;
+    double elapsed = (_now - axis.start_time).total_microseconds() * 1e-6;
+    if (elapsed >= axis.duration) {
+      axis.position = axis.target;
+    } else {
+      axis.position =
+        axis.start + (axis.target - axis.start) * elapsed / axis.duration;
+    }
+  }
+}
+
+//////////////////////////////////////////////////
+void SEEDEmulator::finish_reply_(SEEDFrame& _reply, uint8_t _cmd, size_t _length)
+{
+  _reply.data[0] = 0xFD;
+  _reply.data[1] = 0xDF;
+  _reply.data[2] = static_cast<uint8_t>(_length - SEED_FRAME_OVERHEAD);
+  _reply.data[3] = _cmd;
+  _reply.data[_length - 1] = seed_checksum(_reply.data, _length);
+  _reply.length = _length;
+}
+
+//////////////////////////////////////////////////
+void SEEDEmulator::write_(SEEDFrame& _reply)
+{
+  std::uniform_real_distribution<double> uniform(0.0, 1.0);
+
+  if (uniform(random_) < config_.drop_rate) {
+    boost::mutex::scoped_lock lock(mtx_);
+    ++replies_dropped_;
+    return;
+  }
+  if (uniform(random_) < config_.corrupt_rate) {
+    std::uniform_int_distribution<size_t> at(4, _reply.length - 1);
+    _reply.data[at(random_)] ^= 0x5a;
+    boost::mutex::scoped_lock lock(mtx_);
+    ++replies_corrupted_;
+  }
+
+  int64_t delay = config_.reply_latency_us;
+  if (config_.baud_rate > 0)
+    delay += _reply.length * 10 * 1000000LL / config_.baud_rate;
+  if (delay > 0) usleep(delay);
+
+  if (::write(master_, _reply.data, _reply.length)
+      != static_cast<ssize_t>(_reply.length)) {
+    std::cerr << "Emulator: ERROR: write" << std::endl;
+    return;
+  }
+  boost::mutex::scoped_lock lock(mtx_);
+  ++replies_sent_;
+}
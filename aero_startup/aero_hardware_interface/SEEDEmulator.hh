@@ -0,0 +1,174 @@
+#ifndef AERO_CONTROLLER_SEED_EMULATOR_H_
+#define AERO_CONTROLLER_SEED_EMULATOR_H_
+
+#include <string>
+#include <random>
+#include <stdint.h>
+
+#include <boost/thread.hpp>
+#include <boost/date_time/posix_time/posix_time.hpp>
+
+#include "aero_hardware_interface/SEEDFrame.hh"
+
+namespace aero
+{
+  namespace controller
+  {
+    // actuators in one 68 bytes frame
+    const static size_t SEED_EMULATOR_AXES = 30;
+
+    /// @brief behavior of emulated SEED board
+    struct SEEDEmulatorConfig
+    {
+      SEEDEmulatorConfig() :
+        reply_latency_us(200), baud_rate(1000000),
+        drop_rate(0.0), corrupt_rate(0.0), random_seed(0),
+        servo_on(true), voltage(24.0), temperature(30)
+      {
+        version[0] = 1; version[1] = 0; version[2] = 0;
+        version[3] = 0; version[4] = 0;
+      }
+
+      /// @brief time from end of command to start of reply[us]
+      int reply_latency_us;
+
+      /// @brief bytes are written no faster than this (10 bits per byte),
+      ///   0 for no limit
+      int baud_rate;
+
+      /// @brief probability of not replying to a command
+      double drop_rate;
+
+      /// @brief probability of flipping a byte of reply
+      double corrupt_rate;
+
+      uint32_t random_seed;
+
+      /// @brief servo state at start, actuators move only when on
+      bool servo_on;
+
+      /// @brief reply of CMD_GET_TMP_VOLT short command[V]
+      float voltage;
+
+      /// @brief reply of CMD_GET_TMP_VOLT[degC]
+      int16_t temperature;
+
+      /// @brief reply of CMD_GET_VERSION
+      uint8_t version[5];
+    };
+
+    /// @brief emulates a SEED board on a pseudo terminal
+    ///
+    /// Commands written to the slave side of pty are answered
+    /// like a real board, so SEED485Controller can open port_name()
+    /// (or the link given to open) and run its serial code path
+    /// without hardware.
+    /// Actuators move linearly toward their targets in commanded time.
+    class SEEDEmulator
+    {
+     public: explicit SEEDEmulator(
+         const SEEDEmulatorConfig& _config=SEEDEmulatorConfig());
+
+     public: ~SEEDEmulator();
+
+      /// @brief open pty and start answering commands
+      /// @param _link symbolic link to create for slave, empty for none
+      /// @return false if pty could not be opened
+     public: bool open(const std::string& _link="");
+
+      /// @brief stop answering, close pty and remove link
+     public: void close();
+
+      /// @brief name of slave device
+     public: std::string port_name() {return port_name_;}
+
+      /// @brief current position of actuator
+     public: int16_t position(size_t _axis);
+
+      /// @brief set initial position of actuator
+     public: void set_position(size_t _axis, int16_t _position);
+
+      /// @brief make actuator report step out
+     public: void set_step_out(size_t _axis, bool _step_out);
+
+      /// @brief servo state set by CMD_MOTOR_SRV
+     public: bool servo_on() {return servo_on_;}
+
+      /// @brief last script number executed by sendnum
+     public: uint8_t script(size_t _sendnum);
+
+     public: size_t commands_received();
+
+     public: size_t replies_sent();
+
+     public: size_t replies_dropped();
+
+     public: size_t replies_corrupted();
+
+     public: size_t checksum_errors();
+
+     private: void run_();
+
+      /// @brief handle one command, mtx_ locked
+      /// @param _reply reply frame, length 0 if no reply
+     private: void handle_(const SEEDFrame& _command, SEEDFrame& _reply);
+
+      /// @brief move actuators to where they are at _now, mtx_ locked
+     private: void update_(const boost::posix_time::ptime& _now);
+
+      /// @brief fill header and checksum of reply
+     private: void finish_reply_(SEEDFrame& _reply, uint8_t _cmd, size_t _length);
+
+      /// @brief write reply with latency and baud rate limit
+     private: void write_(SEEDFrame& _reply);
+
+     private: SEEDEmulatorConfig config_;
+
+     private: int master_;
+
+      /// @brief kept open so that pty stays alive between clients
+     private: int slave_;
+
+     private: std::string port_name_;
+
+     private: std::string link_;
+
+     private: boost::thread thread_;
+
+     private: boost::mutex mtx_;
+
+     private: volatile bool running_;
+
+     private: SEEDFrameDecoder decoder_;
+
+     private: std::mt19937 random_;
+
+     private: bool servo_on_;
+
+      /// @brief state of one actuator
+     private: struct Axis
+      {
+        double position;
+        double start;
+        double target;
+        boost::posix_time::ptime start_time;
+        double duration;  // [s]
+        bool step_out;
+      };
+
+     private: Axis axes_[SEED_EMULATOR_AXES];
+
+     private: uint8_t scripts_[256];
+
+     private: size_t commands_received_;
+
+     private: size_t replies_sent_;
+
+     private: size_t replies_dropped_;
+
+     private: size_t replies_corrupted_;
+    };
+  }
+}
+
+#endif
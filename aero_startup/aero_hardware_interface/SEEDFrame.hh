@@ -0,0 +1,173 @@
+#ifndef AERO_CONTROLLER_SEED_FRAME_H_
+#define AERO_CONTROLLER_SEED_FRAME_H_
+
+#include <stdint.h>
+#include <cstddef>
+#include <cstring>
+
+#include "aero_hardware_interface/CommandList.hh"
+
+namespace aero
+{
+  namespace controller
+  {
+    // frame = header(2) + length(1) + cmd(1) + ... + checksum(1)
+    const static size_t SEED_FRAME_MIN_LENGTH = 5;
+    // bytes not counted in the length field (header, length, checksum)
+    const static size_t SEED_FRAME_OVERHEAD = 4;
+    // receive buffer, a few full frames
+    const static size_t SEED_RX_BUFFER_LENGTH = 1024;
+    // complete frames kept until read
+    const static size_t SEED_RX_FRAME_QUEUE = 8;
+
+    /// @brief one complete frame read from SEED controller
+    struct SEEDFrame
+    {
+      /// @brief raw bytes, header included
+      uint8_t data[RAW_DATA_LENGTH];
+
+      /// @brief number of valid bytes in data
+      size_t length;
+
+      /// @brief command byte of frame
+      uint8_t cmd() const { return data[3]; }
+    };
+
+    /// @brief SEED checksum of a frame
+    /// @param _frame frame bytes starting from header
+    /// @param _length total length of frame including checksum
+    inline uint8_t seed_checksum(const uint8_t* _frame, size_t _length)
+    {
+      int32_t b_check_sum = 0;
+      for (size_t i = 2; i < _length - 1; ++i)
+        b_check_sum += _frame[i];
+      return static_cast<uint8_t>(~(b_check_sum & 0xff));
+    }
+
+    /// @brief splits a byte stream from SEED controller into frames
+    ///
+    /// Bytes are written in place with prepare() and commit(),
+    /// complete frames with a valid checksum are taken out with next().
+    /// Broken bytes are skipped up to the next header that starts
+    /// a frame with a valid checksum, frames behind them are kept.
+    /// No allocation is done after construction.
+    class SEEDFrameDecoder
+    {
+    public: SEEDFrameDecoder() : start_(0), end_(0),
+        checksum_errors(0), skipped_bytes(0), resyncs(0)
+      {
+      }
+
+      /// @brief writable region for new bytes
+      /// @param _space returns size of region
+    public: uint8_t* prepare(size_t& _space)
+      {
+        compact();
+        if (end_ == SEED_RX_BUFFER_LENGTH) {
+          // no frame fits, keep from the next header on
+          size_t i = 2;
+          while (i + 1 < end_ && !(buffer_[i] == 0xFD && buffer_[i + 1] == 0xDF))
+            ++i;
+          ++resyncs;
+          skipped_bytes += i;
+          start_ = i;
+          compact();
+        }
+        _space = SEED_RX_BUFFER_LENGTH - end_;
+        return buffer_ + end_;
+      }
+
+      /// @brief mark bytes written in prepare() region as received
+      /// @param _at region returned by prepare()
+      /// @param _n number of bytes written
+    public: void commit(const uint8_t* _at, size_t _n)
+      {
+        // buffer may have been cleared while bytes were written
+        if (_at != buffer_ + end_)
+          std::memmove(buffer_ + end_, _at, _n);
+        end_ += _n;
+      }
+
+      /// @brief take out next complete frame
+      /// @param _frame output frame
+      /// @return true if a frame was found
+    public: bool next(SEEDFrame& _frame)
+      {
+        while (true) {
+          // find header 0xFD 0xDF
+          size_t i = start_;
+          while (i + 1 < end_ && !(buffer_[i] == 0xFD && buffer_[i + 1] == 0xDF))
+            ++i;
+          if (i != start_) {
+            ++resyncs;
+            skipped_bytes += i - start_;
+            start_ = i;
+          }
+
+          if (end_ - start_ < 3)
+            return false;  // wait for length byte
+
+          size_t length = buffer_[start_ + 2] + SEED_FRAME_OVERHEAD;
+          if (length < SEED_FRAME_MIN_LENGTH || length > RAW_DATA_LENGTH) {
+            // not a frame header, skip it
+            ++resyncs;
+            skipped_bytes += 2;
+            start_ += 2;
+            continue;
+          }
+
+          if (end_ - start_ < length)
+            return false;  // incomplete frame
+
+          if (seed_checksum(buffer_ + start_, length)
+              != buffer_[start_ + length - 1]) {
+            // length may be broken too, the next frame can start
+            // inside, so only the header is dropped and search goes on
+            ++checksum_errors;
+            skipped_bytes += 2;
+            start_ += 2;
+            continue;
+          }
+
+          std::memcpy(_frame.data, buffer_ + start_, length);
+          _frame.length = length;
+          start_ += length;
+          return true;
+        }
+      }
+
+      /// @brief drop all received bytes
+    public: void clear()
+      {
+        start_ = end_ = 0;
+      }
+
+      /// @brief move unread bytes to the front of buffer
+    private: void compact()
+      {
+        if (start_ == 0) return;
+        std::memmove(buffer_, buffer_ + start_, end_ - start_);
+        end_ -= start_;
+        start_ = 0;
+      }
+
+    private: uint8_t buffer_[SEED_RX_BUFFER_LENGTH];
+
+    private: size_t start_;
+
+    private: size_t end_;
+
+      /// @brief number of headers dropped by checksum
+    public: size_t checksum_errors;
+
+      /// @brief number of bytes dropped while searching header
+    public: size_t skipped_bytes;
+
+      /// @brief number of times header was searched after broken bytes
+    public: size_t resyncs;
+    };
+
+  }
+}
+
+#endif
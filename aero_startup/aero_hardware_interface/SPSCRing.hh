@@ -0,0 +1,63 @@
+#ifndef AERO_CONTROLLER_SPSC_RING_H_
+#define AERO_CONTROLLER_SPSC_RING_H_
+
+#include <atomic>
+#include <cstddef>
+
+namespace aero
+{
+  namespace controller
+  {
+    /// @brief single producer, single consumer ring of N slots
+    ///
+    /// Slots are filled and read in place, nothing is allocated
+    /// and neither side blocks.
+    template <typename T, size_t N>
+    class SPSCRing
+    {
+     public: SPSCRing() : head_(0), tail_(0)
+      {
+      }
+
+      /// @brief free slot to fill, producer only
+      /// @return NULL if full
+     public: T* prepare()
+      {
+        size_t tail = tail_.load(std::memory_order_relaxed);
+        if (tail - head_.load(std::memory_order_acquire) >= N) return NULL;
+        return &slots_[tail % N];
+      }
+
+      /// @brief make prepared slot visible to consumer
+     public: void commit()
+      {
+        tail_.store(tail_.load(std::memory_order_relaxed) + 1,
+                    std::memory_order_release);
+      }
+
+      /// @brief oldest slot, consumer only
+      /// @return NULL if empty
+     public: T* front()
+      {
+        size_t head = head_.load(std::memory_order_relaxed);
+        if (head == tail_.load(std::memory_order_acquire)) return NULL;
+        return &slots_[head % N];
+      }
+
+      /// @brief release front slot to producer
+     public: void pop()
+      {
+        head_.store(head_.load(std::memory_order_relaxed) + 1,
+                    std::memory_order_release);
+      }
+
+     private: std::atomic<size_t> head_;
+
+     private: std::atomic<size_t> tail_;
+
+     private: T slots_[N];
+    };
+  }
+}
+
+#endif
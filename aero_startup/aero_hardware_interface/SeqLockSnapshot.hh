@@ -0,0 +1,54 @@
+#ifndef AERO_CONTROLLER_SEQ_LOCK_SNAPSHOT_H_
+#define AERO_CONTROLLER_SEQ_LOCK_SNAPSHOT_H_
+
+#include <atomic>
+#include <stdint.h>
+
+namespace aero
+{
+  namespace controller
+  {
+    /// @brief single writer, multi reader snapshot (sequence lock)
+    ///
+    /// Neither writer nor readers block,
+    /// readers retry while a write is in progress.
+    /// T must be trivially copyable.
+    template <typename T>
+    class SeqLockSnapshot
+    {
+     public: SeqLockSnapshot() : sequence_(0)
+      {
+      }
+
+      /// @brief publish new value, only one thread may call
+     public: void store(const T& _value)
+      {
+        uint32_t seq = sequence_.load(std::memory_order_relaxed);
+        sequence_.store(seq + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        value_ = _value;
+        sequence_.store(seq + 2, std::memory_order_release);
+      }
+
+      /// @brief read latest value
+     public: T load() const
+      {
+        T value;
+        uint32_t before, after;
+        do {
+          before = sequence_.load(std::memory_order_acquire);
+          value = value_;
+          std::atomic_thread_fence(std::memory_order_acquire);
+          after = sequence_.load(std::memory_order_relaxed);
+        } while ((before & 1) || before != after);
+        return value;
+      }
+
+     private: std::atomic<uint32_t> sequence_;
+
+     private: T value_;
+    };
+  }
+}
+
+#endif
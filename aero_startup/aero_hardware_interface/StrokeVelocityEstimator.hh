@@ -0,0 +1,94 @@
+#ifndef AERO_CONTROLLER_STROKE_VELOCITY_ESTIMATOR_H_
+#define AERO_CONTROLLER_STROKE_VELOCITY_ESTIMATOR_H_
+
+#include <stdint.h>
+#include <cmath>
+#include <vector>
+
+namespace aero
+{
+  namespace controller
+  {
+    /// @brief velocities of strokes from successive position readings
+    ///
+    /// Each stroke is differentiated between readings with different
+    /// stamps and low pass filtered with the actual time between them,
+    /// so readings of boards with different rates or dropped replies
+    /// are weighted correctly.
+    /// Memory is allocated by resize only, update never allocates.
+    class StrokeVelocityEstimator
+    {
+     public: StrokeVelocityEstimator() : cutoff_(5.0), timeout_(0.5)
+      {
+      }
+
+      /// @param _cutoff cutoff frequency of low pass filter[Hz],
+      ///   0 for raw differences
+      /// @param _timeout velocity is 0 after no reading for this long[s]
+     public: void configure(double _cutoff, double _timeout)
+      {
+        cutoff_ = _cutoff;
+        timeout_ = _timeout;
+      }
+
+      /// @brief number of strokes, estimates are reset
+     public: void resize(size_t _strokes)
+      {
+        strokes_.assign(_strokes, 0);
+        stamps_.assign(_strokes, 0);
+        velocities_.assign(_strokes, 0.0);
+      }
+
+      /// @param _strokes strokes as read, any unit
+      /// @param _stamps time of reading of each stroke[ns],
+      ///   0 if never read
+      /// @param _stamp current time[ns], same clock as _stamps
+     public: void update(const std::vector<int16_t>& _strokes,
+                         const std::vector<int64_t>& _stamps,
+                         int64_t _stamp)
+      {
+        for (size_t i = 0; i < velocities_.size(); ++i) {
+          if (_stamps[i] == 0) continue;
+
+          if (stamps_[i] == 0) {
+            // first reading, nothing to differentiate
+          } else if (_stamps[i] != stamps_[i]) {
+            double dt = (_stamps[i] - stamps_[i]) * 1e-9;
+            double raw = (_strokes[i] - strokes_[i]) / dt;
+            if (dt > timeout_)
+              velocities_[i] = 0.0;
+            else if (cutoff_ <= 0)
+              velocities_[i] = raw;
+            else
+              velocities_[i] += (raw - velocities_[i]) *
+                (dt / (dt + 1.0 / (2.0 * M_PI * cutoff_)));
+          }
+          strokes_[i] = _strokes[i];
+          stamps_[i] = _stamps[i];
+
+          // board stopped replying
+          if ((_stamp - _stamps[i]) * 1e-9 > timeout_)
+            velocities_[i] = 0.0;
+        }
+      }
+
+      /// @brief stroke units per second
+     public: const std::vector<double>& velocities() const
+      {
+        return velocities_;
+      }
+
+     private: double cutoff_;
+
+     private: double timeout_;
+
+     private: std::vector<int16_t> strokes_;
+
+     private: std::vector<int64_t> stamps_;
+
+     private: std::vector<double> velocities_;
+    };
+  }
+}
+
+#endif
@@ -0,0 +1,351 @@
+#include "aero_hardware_interface/TrajectoryExecutor.hh"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+
+using namespace aero;
+using namespace controller;
+
+//////////////////////////////////////////////////
+TrajectoryExecutor::TrajectoryExecutor() : next_id_(1), blend_(30), csec_(0),
+  stats_({0, 0, 0, 0, 0, 0, 0, 0})
+{
+}
+
+//////////////////////////////////////////////////
+void TrajectoryExecutor::resize(size_t _strokes)
+{
+  trajectories_.clear();
+  owners_.assign(_strokes, 0);
+  sent_.assign(_strokes, 0x7fff);
+  velocities_.assign(_strokes, 0.0f);
+  started_.reserve(8);
+  finished_.reserve(8);
+  finishing_.reserve(8);
+}
+
+//////////////////////////////////////////////////
+bool TrajectoryExecutor::precompute(
+    TrajectoryFrames& _frames, const StrokeTrajectory& _trajectory,
+    const std::vector<aero::interpolation::Interpolation>& _interpolation,
+    float _period, int64_t _stamp)
+{
+  if (_trajectory.size() < 2 || _period <= 0) return false;
+
+  _frames.width = _trajectory[0].first.size();
+  _frames.period = _period;
+  _frames.end = _trajectory.back().second;
+  _frames.start = _trajectory[0].first;
+  _frames.stamp = _stamp;
+
+  // slope of curve at start, same choice of curve as frames
+  float length = _trajectory[1].second - _trajectory[0].second;
+  float slope = 1.0f;
+  if (length >= _period && _interpolation.size() > 1 &&
+      !_interpolation[1].is(aero::interpolation::i_constant))
+    slope = _interpolation[1].interpolate(0.01f) / 0.01f;
+  _frames.start_rate = (length > 0) ? slope / length : 0.0f;
+  _frames.start_velocity.assign(_frames.width, 0.0f);
+  for (size_t i = 0; i < _frames.width; ++i) {
+    int16_t from = _trajectory[0].first[i];
+    int16_t to = _trajectory[1].first[i];
+    if (length > 0 && from != 0x7fff && to != 0x7fff)
+      _frames.start_velocity[i] = (to - from) / length * slope;
+  }
+
+  // frame k at k * period, last frame at end
+  size_t frames = static_cast<size_t>(std::ceil(_frames.end / _period - 1e-4f)) + 1;
+  _frames.strokes.assign(frames * _frames.width, 0x7fff);
+  _frames.start_weight.resize(frames);
+  std::vector<float> t_params;
+  size_t frame = 0;
+  for (size_t k = 1; k < _trajectory.size() && frame < frames; ++k) {
+    // frames before next point, all remaining in last segment
+    size_t first = frame;
+    while (frame < frames && (k + 1 == _trajectory.size() ||
+                              frame * _period < _trajectory[k].second))
+      ++frame;
+    size_t n = frame - first;
+    if (n == 0) continue;
+
+    float begin = _trajectory[k - 1].second;
+    float length = _trajectory[k].second - begin;
+    float s0 = (length > 0) ? (first * _period - begin) / length : 1.0f;
+    float ds = (length > 0) ? _period / length : 0.0f;
+
+    // all splits of segment in one call,
+    // any segment shorter than a frame will not interpolate = linear
+    t_params.resize(n);
+    if (length >= _period && k < _interpolation.size() &&
+        !_interpolation[k].is(aero::interpolation::i_constant))
+      _interpolation[k].interpolate(s0, ds, n, t_params.data());
+    else
+      for (size_t i = 0; i < n; ++i)
+        t_params[i] = s0 + i * ds;
+
+    for (size_t i = 0; i < n; ++i) {
+      // last frame is at end
+      float t_param = (s0 + i * ds >= 1.0f) ? 1.0f : t_params[i];
+      _frames.start_weight[first + i] = (k == 1) ? 1 - t_param : 0.0f;
+      sample_(_trajectory[k - 1].first, _trajectory[k].first, t_param,
+              _frames.strokes.data() + (first + i) * _frames.width);
+    }
+  }
+  return true;
+}
+
+//////////////////////////////////////////////////
+uint32_t TrajectoryExecutor::add(
+    const StrokeTrajectory& _trajectory,
+    const std::vector<aero::interpolation::Interpolation>& _interpolation,
+    int64_t _stamp, float _period)
+{
+  TrajectoryFrames frames;
+  if (!precompute(frames, _trajectory, _interpolation, _period, _stamp))
+    return 0;
+  return add(frames);
+}
+
+//////////////////////////////////////////////////
+uint32_t TrajectoryExecutor::add(TrajectoryFrames& _frames)
+{
+  if (_frames.size() == 0) return 0;
+
+  Trajectory trajectory;
+  for (size_t i = 0; i < owners_.size() && i < _frames.width; ++i)
+    if (_frames.start[i] != 0x7fff)
+      trajectory.strokes.push_back(i);
+  if (trajectory.strokes.size() == 0) return 0;
+
+  trajectory.id = next_id_++;
+  if (next_id_ == 0) next_id_ = 1; // 0 is no owner
+  trajectory.time = 0.0f;
+  trajectory.factor = 1.0f;
+  trajectory.start.assign(owners_.size(), 0.0f);
+  trajectory.blend.assign(owners_.size(), 0.0f);
+  trajectory.blend_time = std::min(static_cast<float>(blend_), _frames.end);
+  trajectory.started = false;
+  trajectory.moved = false;
+  trajectory.held = false;
+  trajectory.last_sent = 0;
+  trajectory.actual = 0;
+  trajectory.frame_time = 0.0f;
+
+  // take strokes from running trajectories
+  for (auto s = trajectory.strokes.begin(); s != trajectory.strokes.end(); ++s) {
+    uint32_t owner = owners_[*s];
+    owners_[*s] = trajectory.id;
+    if (owner == 0) continue;
+    ++stats_.takeovers;
+    // start from last stroke sent, which is reached at next frame boundary,
+    // with velocity of running trajectory
+    if (sent_[*s] != 0x7fff) {
+      trajectory.start[*s] = static_cast<float>(sent_[*s] - _frames.start[*s]);
+      if (trajectory.blend_time > 0)
+        trajectory.blend[*s] = velocities_[*s] - _frames.start_velocity[*s]
+          + trajectory.start[*s] * _frames.start_rate;
+    }
+    for (auto th = trajectories_.begin(); th != trajectories_.end(); ++th)
+      if (th->id == owner) {
+        th->strokes.erase(
+            std::remove(th->strokes.begin(), th->strokes.end(), *s),
+            th->strokes.end());
+        break;
+      }
+  }
+  // drop trajectories left without strokes
+  trajectories_.erase(
+      std::remove_if(trajectories_.begin(), trajectories_.end(),
+                     [](const Trajectory& _t) {return _t.strokes.empty();}),
+      trajectories_.end());
+
+  trajectory.frames = std::move(_frames);
+  trajectories_.push_back(std::move(trajectory));
+  return trajectories_.back().id;
+}
+
+//////////////////////////////////////////////////
+bool TrajectoryExecutor::step(std::vector<int16_t>& _strokes, float _csec)
+{
+  _strokes.assign(owners_.size(), 0x7fff);
+  started_.clear();
+  finishing_.clear();
+  csec_ = _csec;
+  if (trajectories_.empty()) {
+    std::fill(velocities_.begin(), velocities_.end(), 0.0f);
+    return false;
+  }
+
+  for (auto th = trajectories_.begin(); th != trajectories_.end(); ++th) {
+    if (th->factor == 0.0f) { // held, strokes are not sent
+      th->held = true;
+      continue;
+    }
+    th->time += _csec * th->factor;
+    read_(*th, _strokes);
+    if (!th->started) {
+      th->started = true;
+      started_.push_back(th->frames.stamp);
+      ++stats_.trajectories;
+    }
+    th->frame_time += _csec;
+    th->moved = true;
+  }
+
+  // velocity at end of frame, taken over by next trajectory
+  for (size_t i = 0; i < _strokes.size(); ++i) {
+    if (_strokes[i] == 0x7fff) {
+      velocities_[i] = 0.0f; // held
+      continue;
+    }
+    velocities_[i] = (sent_[i] == 0x7fff || _csec <= 0) ? 0.0f :
+      static_cast<float>(_strokes[i] - sent_[i]) / _csec;
+    sent_[i] = _strokes[i];
+  }
+
+  // release strokes of finished trajectories,
+  // their timing is complete when last frame is sent
+  for (auto th = trajectories_.begin(); th != trajectories_.end(); ++th) {
+    if (th->time < th->frames.end) continue;
+    for (auto s = th->strokes.begin(); s != th->strokes.end(); ++s)
+      owners_[*s] = 0;
+    finishing_.push_back(std::move(*th));
+  }
+  trajectories_.erase(
+      std::remove_if(trajectories_.begin(), trajectories_.end(),
+                     [](const Trajectory& _t) {
+                       return _t.time >= _t.frames.end;}),
+      trajectories_.end());
+
+  for (auto s = _strokes.begin(); s != _strokes.end(); ++s)
+    if (*s != 0x7fff) return true;
+  return false;
+}
+
+//////////////////////////////////////////////////
+float TrajectoryExecutor::period() const
+{
+  float period = 0.0f;
+  for (auto th = trajectories_.begin(); th != trajectories_.end(); ++th)
+    if (period == 0.0f || th->frames.period < period)
+      period = th->frames.period;
+  return period;
+}
+
+//////////////////////////////////////////////////
+void TrajectoryExecutor::sent(int64_t _stamp)
+{
+  for (auto it = started_.begin(); it != started_.end(); ++it) {
+    if (*it == 0 || _stamp < *it) continue;
+    uint64_t latency = static_cast<uint64_t>(_stamp - *it) / 1000;
+    stats_.last_latency = latency;
+    stats_.max_latency = std::max(stats_.max_latency, latency);
+    stats_.total_latency += latency;
+  }
+  started_.clear();
+
+  finished_.clear();
+  for (auto th = trajectories_.begin(); th != trajectories_.end(); ++th)
+    account_(*th, _stamp);
+  for (auto th = finishing_.begin(); th != finishing_.end(); ++th) {
+    account_(*th, _stamp);
+
+    // frames sent late or early add up to error of whole trajectory
+    TrajectoryTiming timing;
+    timing.id = th->id;
+    timing.commanded = static_cast<uint16_t>(th->frames.end);
+    timing.planned = std::llround(th->frame_time * 1e7);
+    timing.actual = th->actual;
+    finished_.push_back(timing);
+
+    int64_t error = (timing.actual - timing.planned) / 1000;
+    ++stats_.finished;
+    stats_.last_timing_error = error;
+    stats_.max_timing_error = std::max(stats_.max_timing_error,
+                                       static_cast<uint64_t>(std::abs(error)));
+  }
+  finishing_.clear();
+}
+
+//////////////////////////////////////////////////
+void TrajectoryExecutor::account_(Trajectory& _trajectory, int64_t _stamp)
+{
+  if (!_trajectory.moved) return;
+  _trajectory.moved = false;
+
+  // first frame, and first frame after a hold, count as planned,
+  // time spent held is not late
+  if (_trajectory.last_sent == 0 || _trajectory.held)
+    _trajectory.actual += std::llround(csec_ * 1e7);
+  else
+    _trajectory.actual += _stamp - _trajectory.last_sent;
+  _trajectory.held = false;
+  _trajectory.last_sent = _stamp;
+}
+
+//////////////////////////////////////////////////
+void TrajectoryExecutor::set_factor(float _factor)
+{
+  for (auto th = trajectories_.begin(); th != trajectories_.end(); ++th)
+    th->factor = _factor;
+}
+
+//////////////////////////////////////////////////
+void TrajectoryExecutor::clear()
+{
+  trajectories_.clear();
+  finishing_.clear();
+  started_.clear();
+  std::fill(owners_.begin(), owners_.end(), 0);
+  std::fill(velocities_.begin(), velocities_.end(), 0.0f);
+}
+
+//////////////////////////////////////////////////
+void TrajectoryExecutor::read_(const Trajectory& _trajectory,
+                               std::vector<int16_t>& _strokes)
+{
+  const TrajectoryFrames& frames = _trajectory.frames;
+  float time = std::min(_trajectory.time, frames.end);
+
+  // frames around time, exact when frame clock runs at trajectory period
+  size_t last = frames.size() - 1;
+  size_t k = std::min(static_cast<size_t>(time / frames.period), last);
+  size_t next = std::min(k + 1, last);
+  float begin = k * frames.period;
+  float length = std::min(next * frames.period, frames.end) - begin;
+  float w = (length > 0) ? std::min(1.0f, (time - begin) / length) : 0.0f;
+  const int16_t* a = frames.strokes.data() + k * frames.width;
+  const int16_t* b = frames.strokes.data() + next * frames.width;
+  float start = (1 - w) * frames.start_weight[k] + w * frames.start_weight[next];
+
+  // velocity difference at handover fades out as u(1-u)^2,
+  // which has slope 1 at start and no value nor slope at end
+  float u = (_trajectory.blend_time > 0) ? time / _trajectory.blend_time : 1.0f;
+  float fade = (u < 1.0f) ? _trajectory.blend_time * u * (1 - u) * (1 - u) : 0.0f;
+
+  for (auto i = _trajectory.strokes.begin(); i != _trajectory.strokes.end(); ++i) {
+    if (b[*i] == 0x7fff) continue; // cancelled, hold last target
+    float stroke = (a[*i] == 0x7fff) ? b[*i] : (1 - w) * a[*i] + w * b[*i];
+    stroke += _trajectory.start[*i] * start + _trajectory.blend[*i] * fade;
+    _strokes[*i] = static_cast<int16_t>(std::lround(
+        std::max(-32767.0f, std::min(32766.0f, stroke))));
+  }
+}
+
+//////////////////////////////////////////////////
+void TrajectoryExecutor::sample_(const std::vector<int16_t>& _from,
+                                 const std::vector<int16_t>& _to,
+                                 float _t_param, int16_t* _strokes)
+{
+  for (size_t i = 0; i < _from.size() && i < _to.size(); ++i) {
+    if (_to[i] == 0x7fff) continue; // cancelled, hold last target
+    if (_from[i] == 0x7fff) {
+      _strokes[i] = _to[i];
+      continue;
+    }
+    float stroke = (1 - _t_param) * _from[i] + _t_param * _to[i];
+    _strokes[i] = static_cast<int16_t>(std::lround(
+        std::max(-32767.0f, std::min(32766.0f, stroke))));
+  }
+}
@@ -0,0 +1,274 @@
+#ifndef AERO_CONTROLLER_TRAJECTORY_EXECUTOR_H_
+#define AERO_CONTROLLER_TRAJECTORY_EXECUTOR_H_
+
+#include <vector>
+#include <utility>
+#include <stdint.h>
+
+#include "aero_hardware_interface/Interpolation.hh"
+
+namespace aero
+{
+  namespace controller
+  {
+    /// @brief stroke vectors with time from start[csec],
+    ///   first point is the start (reference strokes),
+    ///   0x7fff for strokes not sent
+    typedef std::vector<std::pair<std::vector<int16_t>, uint16_t> >
+      StrokeTrajectory;
+
+    /// @brief counters of trajectories started by TrajectoryExecutor
+    struct HandoverStats
+    {
+      /// @brief trajectories sent at least one frame
+      uint64_t trajectories;
+
+      /// @brief strokes taken from running trajectories
+      uint64_t takeovers;
+
+      /// @brief time from add to first frame sent of last trajectory[us]
+      uint64_t last_latency;
+
+      uint64_t max_latency;
+
+      uint64_t total_latency;
+
+      /// @brief trajectories finished
+      uint64_t finished;
+
+      /// @brief timing error of last finished trajectory[us]
+      int64_t last_timing_error;
+
+      /// @brief max absolute timing error[us]
+      uint64_t max_timing_error;
+    };
+
+    /// @brief timing of a finished trajectory, measured on frames sent
+    struct TrajectoryTiming
+    {
+      uint32_t id;
+
+      /// @brief time of last point[csec], at speed 1.0
+      uint16_t commanded;
+
+      /// @brief frames the trajectory was moved in, by frame clock[ns]
+      int64_t planned;
+
+      /// @brief from first frame sent to end of last frame,
+      ///   by send completion of frames, time held excluded[ns]
+      int64_t actual;
+    };
+
+    /// @brief trajectory precomputed frame by frame,
+    ///   built on the command path without touching the executor
+    struct TrajectoryFrames
+    {
+      TrajectoryFrames() : width(0), period(0), end(0), start_rate(0),
+                           stamp(0) {}
+
+      /// @brief strokes of frame k at k * period (last at end),
+      ///   frame by frame, 0x7fff when not sent
+      std::vector<int16_t> strokes;
+
+      /// @brief strokes in a frame
+      size_t width;
+
+      /// @brief frame period[csec]
+      float period;
+
+      /// @brief time of last point[csec]
+      float end;
+
+      /// @brief weight of first point in each frame,
+      ///   a taken stroke moves from last stroke sent with it
+      std::vector<float> start_weight;
+
+      /// @brief first point, strokes not 0x7fff are owned
+      std::vector<int16_t> start;
+
+      /// @brief velocity of each stroke at start[stroke/csec]
+      std::vector<float> start_velocity;
+
+      /// @brief decrease of weight of first point at start[1/csec]
+      float start_rate;
+
+      /// @brief time trajectory was received[ns], for latency
+      int64_t stamp;
+
+      size_t size() const {return width > 0 ? strokes.size() / width : 0;}
+    };
+
+    /// @brief runs all accepted trajectories of one board
+    ///   on a shared frame clock
+    ///
+    /// Each stroke is owned by at most one trajectory, a new trajectory
+    /// takes the strokes it uses from running ones, which keep moving
+    /// their other strokes, and a trajectory left without strokes is dropped.
+    /// step() advances every trajectory by one frame and writes the
+    /// strokes at the end of the frame into one vector for the board,
+    /// read from frames precomputed when the trajectory was accepted
+    /// (interpolated between them when the frame clock is faster).
+    /// A taken stroke starts from the last stroke sent, at the frame boundary,
+    /// and the difference of its velocity before and after is faded out
+    /// in the blend time, so the velocity does not jump at the handover.
+    /// Not thread safe, commands and steps are serialized by the caller.
+    class TrajectoryExecutor
+    {
+     public: TrajectoryExecutor();
+
+      /// @brief number of strokes, running trajectories are dropped
+     public: void resize(size_t _strokes);
+
+      /// @brief compute strokes of every frame of a trajectory,
+      ///   segments shorter than a frame are linear
+      /// @param _frames precomputed trajectory
+      /// @param _trajectory strokes are owned when not 0x7fff in first point
+      /// @param _interpolation curve of each point, first is not used,
+      ///   linear when missing
+      /// @param _period frame period[csec]
+      /// @param _stamp time trajectory was received[ns], for latency
+      /// @return false when it has no point to move to
+     public: static bool precompute(
+         TrajectoryFrames& _frames, const StrokeTrajectory& _trajectory,
+         const std::vector<aero::interpolation::Interpolation>& _interpolation,
+         float _period, int64_t _stamp=0);
+
+      /// @brief accept a precomputed trajectory,
+      ///   its strokes are moved from next step
+      /// @param _frames moved into executor
+      /// @return id of trajectory, 0 when it has no stroke
+     public: uint32_t add(TrajectoryFrames& _frames);
+
+      /// @brief precompute and accept a trajectory
+     public: uint32_t add(const StrokeTrajectory& _trajectory,
+                          const std::vector<aero::interpolation::Interpolation>&
+                          _interpolation, int64_t _stamp=0, float _period=10);
+
+      /// @brief advance all trajectories by one frame,
+      ///   finished trajectories are dropped after their last point
+      /// @param _strokes strokes at end of frame, 0x7fff when not moved
+      /// @param _csec length of frame[csec]
+      /// @return true if any stroke is to be sent
+     public: bool step(std::vector<int16_t>& _strokes, float _csec);
+
+      /// @brief shortest frame period of running trajectories[csec],
+      ///   0 if none
+     public: float period() const;
+
+      /// @brief timing of trajectories finished by last step,
+      ///   set by sent
+     public: const std::vector<TrajectoryTiming>& finished() const
+      {return finished_;}
+
+      /// @brief record latency and timing of trajectories moved by last step
+      /// @param _stamp time board completed sending strokes[ns],
+      ///   same clock as add
+     public: void sent(int64_t _stamp);
+
+      /// @brief time velocity of taken strokes is blended in
+      /// @param _csec blend time[csec], 0 to start at velocity of new trajectory
+     public: void set_blend(uint16_t _csec) {blend_ = _csec;}
+
+      /// @brief set speed of all running trajectories
+      /// @param _factor 1.0 for commanded speed,
+      ///   0.0 to hold without sending strokes
+     public: void set_factor(float _factor);
+
+      /// @brief drop all trajectories
+     public: void clear();
+
+      /// @brief number of running trajectories
+     public: size_t size() const {return trajectories_.size();}
+
+      /// @brief id of trajectory owning stroke, 0 if none
+     public: uint32_t owner(size_t _stroke) const {return owners_.at(_stroke);}
+
+     public: HandoverStats stats() const {return stats_;}
+
+     private: struct Trajectory
+      {
+        uint32_t id;
+
+        TrajectoryFrames frames;
+
+        /// @brief owned strokes
+        std::vector<size_t> strokes;
+
+        /// @brief elapsed time[csec]
+        float time;
+
+        /// @brief speed overwrite
+        float factor;
+
+        /// @brief last stroke sent minus first point of each stroke[stroke]
+        std::vector<float> start;
+
+        /// @brief velocity difference of each stroke at start[stroke/csec]
+        std::vector<float> blend;
+
+        /// @brief blend time[csec]
+        float blend_time;
+
+        bool started;
+
+        /// @brief moved by last step, not sent yet
+        bool moved;
+
+        /// @brief held since last frame moved in
+        bool held;
+
+        /// @brief send completion of last frame moved in[ns]
+        int64_t last_sent;
+
+        /// @brief time of frames sent, time held excluded[ns]
+        int64_t actual;
+
+        /// @brief frames moved in, by frame clock[csec]
+        float frame_time;
+      };
+
+      /// @brief strokes between two points of trajectory
+      /// @param _t_param curve parameter, 0 at _from, 1 at _to
+     private: static void sample_(const std::vector<int16_t>& _from,
+                                  const std::vector<int16_t>& _to,
+                                  float _t_param, int16_t* _strokes);
+
+      /// @brief add frame sent at stamp to actual time of trajectory
+     private: void account_(Trajectory& _trajectory, int64_t _stamp);
+
+      /// @brief write strokes of trajectory at its time
+     private: void read_(const Trajectory& _trajectory,
+                        std::vector<int16_t>& _strokes);
+
+     private: std::vector<Trajectory> trajectories_;
+
+      /// @brief id of owning trajectory of each stroke
+     private: std::vector<uint32_t> owners_;
+
+     private: uint32_t next_id_;
+
+      /// @brief last stroke sent, 0x7fff if none
+     private: std::vector<int16_t> sent_;
+
+      /// @brief velocity of last frame[stroke/csec]
+     private: std::vector<float> velocities_;
+
+     private: uint16_t blend_;
+
+      /// @brief stamps of trajectories started by last step
+     private: std::vector<int64_t> started_;
+
+     private: std::vector<TrajectoryTiming> finished_;
+
+      /// @brief trajectories finished by last step, until sent
+     private: std::vector<Trajectory> finishing_;
+
+      /// @brief length of last frame[csec]
+     private: float csec_;
+
+     private: HandoverStats stats_;
+    };
+  }
+}
+
+#endif
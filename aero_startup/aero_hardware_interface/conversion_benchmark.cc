@@ -0,0 +1,160 @@
+#include <chrono>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <string>
+#include <vector>
+#include <stdlib.h>
+
+#include "aero_hardware_interface/ConversionRoundTrip.hh"
+
+using namespace aero;
+using namespace common;
+
+typedef std::chrono::steady_clock bench_clock;
+
+/// @brief round trip and speed of one csv, or of a coupled pair
+struct BenchResult
+{
+  std::string name;
+  RoundTrip round_trip;
+  double a2s_ns;  // per Angle2Stroke conversion
+  double s2a_ns;  // per Stroke2Angle conversion
+};
+
+// keeps conversions from being optimized out
+static volatile float sink;
+
+//////////////////////////////////////////////////
+static double time_ns(size_t _repeats, size_t _conversions,
+                      const std::function<float()>& _op)
+{
+  sink = _op();  // warm up
+  bench_clock::time_point start = bench_clock::now();
+  float sum = 0;
+  for (size_t r = 0; r < _repeats; ++r)
+    sum += _op();
+  sink = sum;
+  return std::chrono::duration<double, std::nano>(
+      bench_clock::now() - start).count() / (_repeats * _conversions);
+}
+
+//////////////////////////////////////////////////
+static BenchResult run(const ConversionPair& _pair, float _step,
+                       float _tolerance, size_t _repeats)
+{
+  BenchResult result;
+  result.name = _pair.name;
+  result.round_trip = SingleRoundTrip(_pair, _step, _tolerance);
+
+  // whole range in sweep order, as a trajectory would convert
+  std::vector<float> angles(result.round_trip.conversions);
+  std::vector<float> strokes(angles.size());
+  for (size_t i = 0; i < angles.size(); ++i) {
+    angles[i] = PairMinAngle(_pair) + i * _step;
+    strokes[i] = QuantizeStroke(PairStroke(_pair, angles[i]));
+  }
+
+  result.a2s_ns = time_ns(_repeats, angles.size(), [&]() {
+      float sum = 0;
+      for (size_t i = 0; i < angles.size(); ++i)
+        sum += PairStroke(_pair, angles[i]);
+      return sum;
+    });
+  result.s2a_ns = time_ns(_repeats, strokes.size(), [&]() {
+      float sum = 0;
+      for (size_t i = 0; i < strokes.size(); ++i)
+        sum += PairAngle(_pair, strokes[i]);
+      return sum;
+    });
+  return result;
+}
+
+//////////////////////////////////////////////////
+static void write_json(std::ostream& _os,
+                       const std::vector<BenchResult>& _results,
+                       float _step, float _coupled_step, float _tolerance)
+{
+  _os << "{\n"
+      << "  \"step_deg\": " << _step << ",\n"
+      << "  \"coupled_step_deg\": " << _coupled_step << ",\n"
+      << "  \"tolerance_deg\": " << _tolerance << ",\n"
+      << "  \"results\": [\n";
+  for (size_t i = 0; i < _results.size(); ++i) {
+    const BenchResult& r = _results[i];
+    _os << "    {\"name\": \"" << r.name << "\""
+        << ", \"conversions\": " << r.round_trip.conversions
+        << ", \"max_error_deg\": " << r.round_trip.max_error
+        << ", \"max_error_at_deg\": " << r.round_trip.angle
+        << ", \"failures\": " << r.round_trip.failures;
+    if (r.a2s_ns > 0)
+      _os << ", \"a2s_ns\": " << r.a2s_ns << ", \"s2a_ns\": " << r.s2a_ns;
+    else
+      _os << ", \"coupled_at_deg\": " << r.round_trip.coupled_angle;
+    _os << "}" << (i + 1 < _results.size() ? "," : "") << "\n";
+  }
+  _os << "  ]\n}\n";
+}
+
+//////////////////////////////////////////////////
+static void usage()
+{
+  std::cerr
+    << "usage: conversion_benchmark [options]\n"
+    << "  --step DEG          angle step of single joints (0.01)\n"
+    << "  --coupled-step DEG  angle step of coupled joints (0.1)\n"
+    << "  --tolerance DEG     error counted as failure (0.2)\n"
+    << "  --repeats N         timed sweeps of each table (100)\n"
+    << "  --output FILE       write results as JSON (stdout)\n";
+}
+
+//////////////////////////////////////////////////
+int main(int argc, char** argv)
+{
+  float step = 0.01f;
+  float coupled_step = 0.1f;
+  float tolerance = 0.2f;
+  size_t repeats = 100;
+  std::string output;
+
+  for (int i = 1; i < argc; ++i) {
+    std::string opt(argv[i]);
+    if (i + 1 >= argc) {
+      usage();
+      return 1;
+    }
+    const char* val = argv[++i];
+    if (opt == "--step") step = atof(val);
+    else if (opt == "--coupled-step") coupled_step = atof(val);
+    else if (opt == "--tolerance") tolerance = atof(val);
+    else if (opt == "--repeats") repeats = atoi(val);
+    else if (opt == "--output") output = val;
+    else {
+      usage();
+      return 1;
+    }
+  }
+
+  std::vector<BenchResult> results;
+  for (const ConversionPair& pair : ConversionPairs)
+    results.push_back(run(pair, step, tolerance, repeats));
+
+  // coupled pairs have no timing of their own, see single tables
+  for (const ConversionPair& one : ConversionPairs) {
+    if (one.coupled < 0) continue;
+    const ConversionPair& two = ConversionPairs[one.coupled];
+    BenchResult result;
+    result.name = std::string(one.name) + " + " + two.name;
+    result.round_trip = CoupledRoundTrip(one, two, coupled_step, tolerance);
+    result.a2s_ns = result.s2a_ns = 0;
+    results.push_back(result);
+  }
+
+  if (output == "") {
+    write_json(std::cout, results, step, coupled_step, tolerance);
+  } else {
+    std::ofstream ofs(output.c_str());
+    write_json(ofs, results, step, coupled_step, tolerance);
+  }
+  return 0;
+}
@@ -0,0 +1,297 @@
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <string>
+#include <vector>
+#include <stdlib.h>
+
+#include "aero_hardware_interface/AeroControllers.hh"
+#include "aero_hardware_interface/SEEDEmulator.hh"
+
+using namespace aero;
+using namespace controller;
+
+typedef std::chrono::steady_clock bench_clock;
+
+/// @brief exposes frame helpers of controller
+class BenchController : public AeroUpperController
+{
+ public: explicit BenchController(const std::string& _port) :
+  AeroUpperController(_port)
+  {
+  }
+
+ public: void stroke_to_raw(std::vector<int16_t>& _stroke,
+                            std::vector<uint8_t>& _raw)
+  {
+    stroke_to_raw_(_stroke, _raw);
+  }
+
+ public: void get_command(uint8_t _cmd, std::vector<int16_t>& _stroke_vector)
+  {
+    AeroControllerProto::get_command(_cmd, _stroke_vector);
+  }
+};
+
+/// @brief result of one benchmark
+struct BenchResult
+{
+  std::string name;
+  bool reply;
+  size_t iterations;
+  size_t bytes_per_op;  // command + reply on the bus
+  std::vector<double> latency_us;
+  double total_s;
+  size_t batch;  // ops timed together
+};
+
+//////////////////////////////////////////////////
+static double percentile(const std::vector<double>& _sorted, double _p)
+{
+  if (_sorted.empty()) return 0.0;
+  size_t i = static_cast<size_t>(_p * (_sorted.size() - 1) + 0.5);
+  return _sorted[i];
+}
+
+//////////////////////////////////////////////////
+static BenchResult run(const std::string& _name, bool _reply,
+                       size_t _bytes_per_op, size_t _iterations,
+                       std::function<void()> _op, size_t _batch=1,
+                       std::function<void()> _drain=std::function<void()>())
+{
+  BenchResult result;
+  result.name = _name;
+  result.reply = _reply;
+  result.iterations = _iterations;
+  result.bytes_per_op = _bytes_per_op;
+  result.latency_us.reserve(_iterations);
+  result.batch = _batch;
+
+  // warm up
+  for (size_t i = 0; i < std::min<size_t>(_iterations / 10 + 1, 100); ++i)
+    _op();
+
+  bench_clock::time_point start = bench_clock::now();
+  for (size_t i = 0; i < _iterations; ++i) {
+    bench_clock::time_point t0 = bench_clock::now();
+    for (size_t j = 0; j < _batch; ++j)
+      _op();
+    result.latency_us.push_back(
+        std::chrono::duration<double, std::micro>(bench_clock::now() - t0).count()
+        / _batch);
+  }
+  // commands without reply are counted when they reach the board
+  if (_drain) _drain();
+  result.total_s =
+    std::chrono::duration<double>(bench_clock::now() - start).count();
+
+  std::sort(result.latency_us.begin(), result.latency_us.end());
+  return result;
+}
+
+//////////////////////////////////////////////////
+static void write_json(std::ostream& _os, const std::vector<BenchResult>& _results,
+                       const SEEDEmulatorConfig& _config, bool _emulated,
+                       const SEEDBusStats& _stats, uint64_t _safety_bound)
+{
+  _os << "{\n"
+      << "  \"emulator\": " << (_emulated ? "true" : "false") << ",\n"
+      << "  \"reply_latency_us\": " << _config.reply_latency_us << ",\n"
+      << "  \"baud_rate\": " << _config.baud_rate << ",\n"
+      << "  \"safety_wait_max_us\": "
+      << _stats.lane_wait_max[SEED_LANE_SAFETY] << ",\n"
+      << "  \"position_wait_max_us\": "
+      << _stats.lane_wait_max[SEED_LANE_POSITION] << ",\n"
+      << "  \"safety_latency_bound_us\": " << _safety_bound << ",\n"
+      << "  \"results\": [\n";
+  for (size_t i = 0; i < _results.size(); ++i) {
+    const BenchResult& r = _results[i];
+    double rate = r.iterations * r.batch / r.total_s;
+    _os << "    {\"name\": \"" << r.name << "\""
+        << ", \"reply\": " << (r.reply ? "true" : "false")
+        << ", \"iterations\": " << r.iterations
+        << ", \"p50_us\": " << percentile(r.latency_us, 0.5)
+        << ", \"p90_us\": " << percentile(r.latency_us, 0.9)
+        << ", \"p99_us\": " << percentile(r.latency_us, 0.99)
+        << ", \"max_us\": " << r.latency_us.back()
+        << ", \"ops_per_s\": " << rate
+        << ", \"bytes_per_s\": " << rate * r.bytes_per_op
+        << "}" << (i + 1 < _results.size() ? "," : "") << "\n";
+  }
+  _os << "  ]\n}\n";
+}
+
+//////////////////////////////////////////////////
+static void usage()
+{
+  std::cerr
+    << "usage: seed_benchmark [options]\n"
+    << "  --iterations N  commands per benchmark (1000)\n"
+    << "  --latency US    reply latency of emulator [us] (200)\n"
+    << "  --baud N        baud rate limit of emulator, 0 for none (1000000)\n"
+    << "  --port PORT     use running emulator or loopback at PORT,\n"
+    << "                  never a real board (settings are written)\n"
+    << "  --output FILE   write results as JSON (stdout)\n";
+}
+
+int main(int argc, char** argv)
+{
+  size_t iterations = 1000;
+  std::string port, output;
+  SEEDEmulatorConfig config;
+
+  for (int i = 1; i < argc; ++i) {
+    std::string opt(argv[i]);
+    if (i + 1 >= argc) {
+      usage();
+      return 1;
+    }
+    const char* val = argv[++i];
+    if (opt == "--iterations") iterations = atoi(val);
+    else if (opt == "--latency") config.reply_latency_us = atoi(val);
+    else if (opt == "--baud") config.baud_rate = atoi(val);
+    else if (opt == "--port") port = val;
+    else if (opt == "--output") output = val;
+    else {
+      usage();
+      return 1;
+    }
+  }
+
+  SEEDEmulator emulator(config);
+  bool emulated = (port == "");
+  if (emulated) {
+    if (!emulator.open()) return 1;
+    port = emulator.port_name();
+  }
+
+  BenchController controller(port);
+  if (controller.get_version() == "") {
+    std::cerr << "no reply from " << port << std::endl;
+    return 1;
+  }
+
+  std::vector<int16_t> strokes = controller.get_actual_stroke_vector();
+  std::vector<int16_t> values(AERO_DOF_UPPER, 0);
+  std::vector<uint8_t> raw(RAW_DATA_LENGTH);
+  const size_t full = RAW_DATA_LENGTH;  // 68 bytes frame
+  std::vector<BenchResult> results;
+
+  // round trips
+  results.push_back(run("get_version", true, 6 + 11, iterations,
+                        [&]() { controller.get_version(); }));
+  results.push_back(run("get_voltage", true, 6 + 8, iterations,
+                        [&]() { controller.get_voltage(); }));
+  results.push_back(run("update_position", true, full * 2, iterations,
+                        [&]() { controller.update_position(); }));
+  results.push_back(run("get_command(CMD_GET_POS)", true, full * 2, iterations,
+                        [&]() { controller.get_command(CMD_GET_POS, values); }));
+  results.push_back(run("update_position_async", true, full * 2, iterations,
+                        [&]() { controller.update_position_async().wait(); }));
+  results.push_back(run("update_status", true, full * 2, iterations,
+                        [&]() { controller.update_status(); }));
+  results.push_back(run("update_status_async", true, full * 2, iterations,
+                        [&]() { controller.update_status_async().wait(); }));
+  results.push_back(run("reset_status", true, full * 2, iterations,
+                        [&]() { controller.reset_status(); }));
+  results.push_back(run("get_current", true, full * 2, iterations,
+                        [&]() { controller.get_current(values); }));
+  results.push_back(run("get_temperature", true, full * 2, iterations,
+                        [&]() { controller.get_temperature(values); }));
+  results.push_back(run("set_position", true, full * 2, iterations,
+                        [&]() { controller.set_position(strokes, 10); }));
+
+  // position command and status poll in one bus cycle
+  results.push_back(run("set_position_async+update_status_async", true,
+                        full * 4, iterations, [&]() {
+      std::shared_future<bool> pos = controller.set_position_async(strokes, 10);
+      controller.update_status_async().wait();
+      pos.wait();
+    }));
+
+  // commands without reply, latency is time to queue,
+  // rate is until the board has received all of them
+  size_t sent = 0;
+  size_t received = 0;
+  std::function<void()> drain = [&]() {
+    if (emulated) {
+      while (emulator.commands_received() < received + sent) usleep(100);
+    } else {
+      controller.get_version();
+    }
+  };
+  std::function<std::function<void()>(std::function<void()>)> counted =
+    [&](std::function<void()> _op) {
+    sent = 0;
+    received = emulator.commands_received();
+    return std::function<void()>([&, _op]() { _op(); ++sent; });
+  };
+  results.push_back(run("set_position_no_wait", false, full, iterations,
+                        counted([&]() {
+                            controller.set_position_no_wait(strokes, 10); }),
+                        1, drain));
+  results.push_back(run("servo_on", false, full, iterations,
+                        counted([&]() { controller.servo_on(); }), 1, drain));
+  results.push_back(run("servo_off", false, full, iterations,
+                        counted([&]() { controller.servo_off(); }), 1, drain));
+  controller.servo_on();
+  std::vector<int16_t> currents(AERO_DOF_UPPER, 100);
+  results.push_back(run("set_max_current", false, full, iterations,
+                        counted([&]() { controller.set_max_current(currents); }),
+                        1, drain));
+  results.push_back(run("set_max_single_current", false, 8, iterations,
+                        counted([&]() {
+                            controller.set_max_single_current(0, 100); }),
+                        1, drain));
+  std::vector<int16_t> rates(AERO_DOF_UPPER, 10);
+  results.push_back(run("set_accel_rate", false, full, iterations,
+                        counted([&]() { controller.set_accel_rate(rates); }),
+                        1, drain));
+  std::vector<int16_t> gains(AERO_DOF_UPPER, 50);
+  results.push_back(run("set_motor_gain", false, full, iterations,
+                        counted([&]() { controller.set_motor_gain(gains); }),
+                        1, drain));
+  results.push_back(run("set_command", false, 8, iterations,
+                        counted([&]() {
+                            controller.set_command(CMD_MOTOR_CUR, 0, 100); }),
+                        1, drain));
+
+  // servo command queued behind a burst of position commands,
+  // wait of safety lane is read from bus stats
+  results.push_back(run("servo_on behind set_position_no_wait x8", false,
+                        full * 9, iterations, counted([&]() {
+      for (size_t j = 0; j < 8; ++j)
+        controller.set_position_no_wait(strokes, 10);
+      controller.servo_on();
+    }), 1, drain));
+  uint64_t safety_bound = controller.get_safety_latency_bound();
+
+  // frame helpers and status of last poll, no bus,
+  // timed in batches as one call is too short
+  const size_t batch = 1000;
+  volatile bool status = false;
+  results.push_back(run("get_status", false, 0, iterations,
+                        [&]() { status = controller.get_status(); }, batch));
+  results.push_back(run("stroke_to_raw_", false, 0, iterations,
+                        [&]() { controller.stroke_to_raw(strokes, raw); },
+                        batch));
+  volatile int16_t sink = 0;
+  results.push_back(run("decode_short_", false, 0, iterations,
+                        [&]() { sink = decode_short_(&raw[RAW_HEADER_OFFSET]); },
+                        batch));
+  results.push_back(run("encode_short_", false, 0, iterations,
+                        [&]() { encode_short_(sink, &raw[RAW_HEADER_OFFSET]); },
+                        batch));
+
+  SEEDBusStats stats = controller.get_bus_stats();
+  if (output == "") {
+    write_json(std::cout, results, config, emulated, stats, safety_bound);
+  } else {
+    std::ofstream ofs(output.c_str());
+    write_json(ofs, results, config, emulated, stats, safety_bound);
+  }
+
+  return 0;
+}
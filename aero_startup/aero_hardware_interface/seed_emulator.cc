@@ -0,0 +1,86 @@
+#include <iostream>
+#include <string>
+#include <vector>
+#include <signal.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include "aero_hardware_interface/SEEDEmulator.hh"
+
+using namespace aero;
+using namespace controller;
+
+static volatile sig_atomic_t running = 1;
+
+static void stop(int)
+{
+  running = 0;
+}
+
+static void usage()
+{
+  std::cerr
+    << "usage: seed_emulator LINK [options]\n"
+    << "  emulates a SEED board on a pty linked from LINK (e.g. /tmp/aero_upper)\n"
+    << "  --latency US    reply latency [us] (200)\n"
+    << "  --baud N        baud rate limit, 0 for none (1000000)\n"
+    << "  --drop P        probability of dropping a reply (0)\n"
+    << "  --corrupt P     probability of corrupting a reply (0)\n"
+    << "  --seed N        random seed (0)\n"
+    << "  --step-out AXIS actuator reporting step out\n"
+    << "  --servo-off     start with servo off\n";
+}
+
+int main(int argc, char** argv)
+{
+  if (argc < 2 || argv[1][0] == '-') {
+    usage();
+    return 1;
+  }
+
+  std::string link(argv[1]);
+  SEEDEmulatorConfig config;
+  std::vector<int> step_out;
+
+  for (int i = 2; i < argc; ++i) {
+    std::string opt(argv[i]);
+    if (opt == "--servo-off") {
+      config.servo_on = false;
+      continue;
+    }
+    if (i + 1 >= argc) {
+      usage();
+      return 1;
+    }
+    const char* val = argv[++i];
+    if (opt == "--latency") config.reply_latency_us = atoi(val);
+    else if (opt == "--baud") config.baud_rate = atoi(val);
+    else if (opt == "--drop") config.drop_rate = atof(val);
+    else if (opt == "--corrupt") config.corrupt_rate = atof(val);
+    else if (opt == "--seed") config.random_seed = atoi(val);
+    else if (opt == "--step-out") step_out.push_back(atoi(val));
+    else {
+      usage();
+      return 1;
+    }
+  }
+
+  SEEDEmulator emulator(config);
+  if (!emulator.open(link)) return 1;
+  for (size_t i = 0; i < step_out.size(); ++i)
+    emulator.set_step_out(step_out[i], true);
+
+  std::cout << link << " -> " << emulator.port_name() << std::endl;
+
+  signal(SIGINT, stop);
+  signal(SIGTERM, stop);
+  while (running) usleep(100 * 1000);
+
+  std::cout << "commands: " << emulator.commands_received()
+            << ", replies: " << emulator.replies_sent()
+            << ", dropped: " << emulator.replies_dropped()
+            << ", corrupted: " << emulator.replies_corrupted()
+            << ", checksum errors: " << emulator.checksum_errors()
+            << std::endl;
+  return 0;
+}
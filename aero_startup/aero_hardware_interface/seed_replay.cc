@@ -0,0 +1,247 @@
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <stdlib.h>
+#include <termios.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#include "aero_hardware_interface/SEEDCapture.hh"
+
+using namespace aero;
+using namespace controller;
+
+typedef std::chrono::steady_clock replay_clock;
+
+static volatile sig_atomic_t running = 1;
+
+static void stop(int)
+{
+  running = 0;
+}
+
+static void usage()
+{
+  std::cerr
+    << "usage: seed_replay CAPTURE --dump\n"
+    << "       seed_replay CAPTURE LINK [options]\n"
+    << "  plays the board side of CAPTURE on a pty linked from LINK,\n"
+    << "  commands from the controller are compared with captured ones\n"
+    << "  and captured replies are written with captured delays\n"
+    << "  --speed S       delays are divided by S, 0 for no delay (1)\n"
+    << "  --timeout MS    wait for each command at most MS [ms] (1000)\n";
+}
+
+//////////////////////////////////////////////////
+static void dump(SEEDCaptureReader& _capture)
+{
+  std::cout << "# start " << _capture.start_time()
+            << " ns, frames " << _capture.size()
+            << ", dropped " << _capture.dropped() << "\n";
+  for (size_t i = 0; i < _capture.size(); ++i) {
+    const SEEDCaptureRecord& r = _capture.at(i);
+    std::cout << std::dec << std::setw(12) << std::setfill(' ')
+              << r.stamp / 1000
+              << (r.direction == SEED_CAPTURE_TX ? " send " : " recv ");
+    for (size_t j = 0; j < r.length; ++j)
+      std::cout << std::uppercase << std::hex
+                << std::setw(2) << std::setfill('0')
+                << static_cast<int32_t>(r.data[j]);
+    std::cout << "\n";
+  }
+}
+
+//////////////////////////////////////////////////
+static int open_pty(const std::string& _link, int& _slave)
+{
+  int master = posix_openpt(O_RDWR | O_NOCTTY);
+  if (master < 0 || grantpt(master) != 0 || unlockpt(master) != 0) {
+    std::cerr << "Replay: ERROR: could not open pty" << std::endl;
+    if (master >= 0) ::close(master);
+    return -1;
+  }
+  std::string port(ptsname(master));
+
+  // raw mode before controller opens the slave, no echo
+  _slave = ::open(port.c_str(), O_RDWR | O_NOCTTY);
+  if (_slave >= 0) {
+    struct termios tio;
+    ::tcgetattr(_slave, &tio);
+    ::cfmakeraw(&tio);
+    ::tcsetattr(_slave, TCSANOW, &tio);
+  }
+
+  // replace only a stale link, never a real device
+  struct stat st;
+  if (::lstat(_link.c_str(), &st) == 0 && S_ISLNK(st.st_mode))
+    ::unlink(_link.c_str());
+  if (::symlink(port.c_str(), _link.c_str()) != 0) {
+    std::cerr << "Replay: ERROR: could not create " << _link << std::endl;
+    ::close(master);
+    if (_slave >= 0) ::close(_slave);
+    return -1;
+  }
+  std::cout << _link << " -> " << port << std::endl;
+  return master;
+}
+
+//////////////////////////////////////////////////
+static bool read_frame(int _fd, SEEDFrameDecoder& _decoder, SEEDFrame& _frame,
+                       int _timeout_ms)
+{
+  replay_clock::time_point deadline =
+    replay_clock::now() + std::chrono::milliseconds(_timeout_ms);
+  while (running && !_decoder.next(_frame)) {
+    int remain = std::chrono::duration_cast<std::chrono::milliseconds>(
+        deadline - replay_clock::now()).count();
+    if (remain <= 0) return false;
+    struct pollfd pfd = {_fd, POLLIN, 0};
+    if (::poll(&pfd, 1, std::min(remain, 100)) <= 0) continue;
+    size_t space;
+    uint8_t* at = _decoder.prepare(space);
+    ssize_t n = ::read(_fd, at, space);
+    if (n > 0) _decoder.commit(at, n);
+  }
+  return running;
+}
+
+//////////////////////////////////////////////////
+static double percentile(std::vector<double>& _values, double _p)
+{
+  if (_values.empty()) return 0.0;
+  std::sort(_values.begin(), _values.end());
+  return _values[static_cast<size_t>(_p * (_values.size() - 1) + 0.5)];
+}
+
+int main(int argc, char** argv)
+{
+  if (argc < 3 || argv[1][0] == '-') {
+    usage();
+    return 1;
+  }
+
+  SEEDCaptureReader capture;
+  if (!capture.open(argv[1])) return 1;
+
+  if (std::string(argv[2]) == "--dump") {
+    dump(capture);
+    return 0;
+  }
+
+  std::string link(argv[2]);
+  double speed = 1.0;
+  int timeout_ms = 1000;
+  for (int i = 3; i < argc; ++i) {
+    std::string opt(argv[i]);
+    if (i + 1 >= argc) {
+      usage();
+      return 1;
+    }
+    const char* val = argv[++i];
+    if (opt == "--speed") speed = atof(val);
+    else if (opt == "--timeout") timeout_ms = atoi(val);
+    else {
+      usage();
+      return 1;
+    }
+  }
+
+  int slave = -1;
+  int master = open_pty(link, slave);
+  if (master < 0) return 1;
+
+  signal(SIGINT, stop);
+  signal(SIGTERM, stop);
+
+  SEEDFrameDecoder decoder;
+  SEEDFrame frame;
+  size_t matched = 0, mismatched = 0, missing = 0, replies = 0;
+  // arrival of command minus captured time, after first command [us]
+  std::vector<double> lateness;
+  // captured and replayed time of last command, replies are timed from it
+  int64_t anchor_stamp = 0;
+  replay_clock::time_point anchor_time;
+  replay_clock::time_point first_time;
+  int64_t first_stamp = -1;
+
+  for (size_t i = 0; i < capture.size() && running; ++i) {
+    const SEEDCaptureRecord& r = capture.at(i);
+
+    if (r.direction == SEED_CAPTURE_TX) {
+      // first command may take long, controller is starting
+      int wait_ms = (first_stamp < 0 ? 60 * 1000 : timeout_ms);
+      if (!read_frame(master, decoder, frame, wait_ms)) {
+        ++missing;
+        continue;
+      }
+      replay_clock::time_point now = replay_clock::now();
+      if (frame.length == r.length
+          && std::memcmp(frame.data, r.data, r.length) == 0) {
+        ++matched;
+      } else {
+        ++mismatched;
+        std::cerr << "Replay: command " << i << " differs, expected 0x"
+                  << std::hex << static_cast<int>(r.data[3])
+                  << " got 0x" << static_cast<int>(frame.cmd())
+                  << std::dec << std::endl;
+      }
+
+      if (first_stamp < 0) {
+        first_stamp = r.stamp;
+        first_time = now;
+      } else if (speed > 0.0) {
+        double expected = (r.stamp - first_stamp) * 1e-3 / speed;
+        double actual = std::chrono::duration<double, std::micro>(
+            now - first_time).count();
+        lateness.push_back(actual - expected);
+      }
+      anchor_stamp = r.stamp;
+      anchor_time = now;
+      continue;
+    }
+
+    // reply, keep captured delay from its command
+    if (speed > 0.0 && first_stamp >= 0) {
+      std::this_thread::sleep_until(
+          anchor_time + std::chrono::nanoseconds(
+              static_cast<int64_t>((r.stamp - anchor_stamp) / speed)));
+    }
+    if (::write(master, r.data, r.length) == static_cast<ssize_t>(r.length))
+      ++replies;
+  }
+
+  double total = first_stamp < 0 ? 0.0 : std::chrono::duration<double>(
+      replay_clock::now() - first_time).count();
+  double captured = capture.size() > 0 ?
+    (capture.at(capture.size() - 1).stamp - std::max<int64_t>(first_stamp, 0))
+    * 1e-9 : 0.0;
+
+  std::cout << "frames: " << capture.size()
+            << ", dropped in capture: " << capture.dropped() << "\n"
+            << "commands matched: " << matched
+            << ", differ: " << mismatched
+            << ", missing: " << missing
+            << ", replies: " << replies << "\n"
+            << "time: " << total << " s, captured: " << captured << " s\n";
+  if (!lateness.empty()) {
+    double p50 = percentile(lateness, 0.5);
+    double p99 = percentile(lateness, 0.99);
+    std::cout << "command lateness [us] p50: " << p50
+              << ", p99: " << p99
+              << ", max: " << lateness.back() << std::endl;
+  }
+
+  ::unlink(link.c_str());
+  if (slave >= 0) ::close(slave);
+  ::close(master);
+
+  return (mismatched == 0 && missing == 0) ? 0 : 2;
+}
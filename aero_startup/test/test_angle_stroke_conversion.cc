@@ -0,0 +1,129 @@
+/// Angle2Stroke -> Stroke2Angle round trip of the generated functions
+/// of the robot in use (aero_description/setup.sh {my_robot})
+
+#include <gtest/gtest.h>
+
+#include <cmath>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+#include "aero_hardware_interface/Constants.hh"
+#include "aero_hardware_interface/AngleJointNames.hh"
+#include "aero_hardware_interface/Angle2Stroke.hh"
+#include "aero_hardware_interface/Stroke2Angle.hh"
+
+using namespace aero;
+using namespace common;
+
+// more than joints of any robot, AngleJointNames does not resize
+static const size_t MAX_JOINTS = 64;
+
+// joints are searched for the end of their tables up to this[deg]
+static const int MAX_ANGLE = 180;
+
+// sweep step[deg]
+static const double STEP = 0.01;
+
+// positions of other joints in their ranges while one is swept
+static const double POSES[] = {0.0, 0.25, 0.5, 0.75, 1.0};
+
+// a stroke truncated to 0.01 mm is off by up to 0.12 deg
+// where a table is flattest (wrist-r), coupled joints included
+static const double TOLERANCE = 0.2;
+
+static const double DEG = M_PI / 180.0;
+
+/// @brief joint of ros_order converted by tables, and its range[deg]
+struct StrokeJoint
+{
+  size_t index;
+  std::string name;
+  int min;
+  int max;
+};
+
+//////////////////////////////////////////////////
+static std::vector<int16_t> Strokes(const std::vector<double>& _angles)
+{
+  std::vector<int16_t> strokes(controller::AERO_DOF);
+  Angle2Stroke(strokes, _angles);
+  return strokes;
+}
+
+//////////////////////////////////////////////////
+/// @brief joints changing strokes, up to where their tables end
+/// @param _joints number of joints in ros_order
+static std::vector<StrokeJoint> StrokeJoints(size_t& _joints)
+{
+  std::vector<std::string> names(MAX_JOINTS);
+  AngleJointNames(names);
+  size_t joints = 0;
+  while (joints < names.size() && !names[joints].empty())
+    ++joints;
+  _joints = joints;
+
+  std::vector<StrokeJoint> result;
+  std::vector<double> angles(joints, 0.0);
+  for (size_t j = 0; j < joints; ++j) {
+    StrokeJoint joint = {j, names[j], 0, 0};
+    // the last angle changing strokes, beyond it they are clamped
+    for (int sign = -1; sign <= 1; sign += 2) {
+      std::vector<int16_t> previous = Strokes(angles);
+      for (int angle = sign; std::abs(angle) <= MAX_ANGLE; angle += sign) {
+        angles[j] = angle * DEG;
+        std::vector<int16_t> strokes = Strokes(angles);
+        if (strokes == previous) break;
+        (sign < 0 ? joint.min : joint.max) = angle;
+        previous = strokes;
+      }
+      angles[j] = 0.0;
+    }
+    if (joint.min < joint.max)
+      result.push_back(joint);
+  }
+  return result;
+}
+
+//////////////////////////////////////////////////
+TEST(AngleStrokeConversion, RoundTrip)
+{
+  size_t size;
+  std::vector<StrokeJoint> joints = StrokeJoints(size);
+  ASSERT_LT(size, MAX_JOINTS);
+  ASSERT_FALSE(joints.empty());
+  std::vector<double> angles(size);
+  std::vector<double> back(size);
+  std::vector<int16_t> strokes(controller::AERO_DOF);
+
+  for (size_t pose = 0; pose < sizeof(POSES) / sizeof(POSES[0]); ++pose) {
+    for (size_t k = 0; k < joints.size(); ++k)
+      angles[joints[k].index] = DEG *
+        (joints[k].min + POSES[pose] * (joints[k].max - joints[k].min));
+
+    for (size_t j = 0; j < joints.size(); ++j) {
+      const StrokeJoint& swept = joints[j];
+      double rest = angles[swept.index];
+      int steps = static_cast<int>((swept.max - swept.min) / STEP + 0.5);
+      for (int i = 0; i <= steps; ++i) {
+        angles[swept.index] = DEG * (swept.min + i * STEP);
+        Angle2Stroke(strokes, angles);
+        Stroke2Angle(back, strokes);
+        // coupled joints are checked too
+        for (size_t k = 0; k < joints.size(); ++k) {
+          size_t index = joints[k].index;
+          ASSERT_NEAR(back[index] / DEG, angles[index] / DEG, TOLERANCE)
+            << joints[k].name << " with " << swept.name
+            << " at " << angles[swept.index] / DEG << " deg, pose " << pose;
+        }
+      }
+      angles[swept.index] = rest;
+    }
+  }
+}
+
+int main(int argc, char **argv)
+{
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,143 @@
+/// Angle2Stroke -> Stroke2Angle round trip of every csv of a robot,
+/// built once per robot type with tables of
+/// make_conversion_tables.py {robot_dir} --pairs,
+/// whole body conversions are in test_angle_stroke_conversion
+
+#include <gtest/gtest.h>
+
+#include "aero_hardware_interface/ConversionRoundTrip.hh"
+
+using namespace aero;
+using namespace common;
+
+// step of sweeps[deg]
+static const float SINGLE_STEP = 0.01f;
+
+// a stroke quantized to 0.01 mm is off by up to 0.12 deg
+// where a table is flattest (wrist-r)
+static const float TOLERANCE = 0.2f;
+
+// splines of both directions through the same csv points
+static const float SPLINE_ERROR = 0.02f;
+static const float JACOBIAN_ERROR = 0.1f;
+
+// positions are read from tables and rates from splines,
+// they differ by up to 0.02 mm and 0.06 deg (shoulder-p, wrist-p)
+static const float SPLINE_STROKE_ERROR = 0.05f;
+static const float SPLINE_ANGLE_ERROR = 0.1f;
+
+// rounding of the last interval of a spline
+static const float SPLINE_END_ERROR = 1e-4f;
+
+static const size_t PAIRS = sizeof(ConversionPairs) / sizeof(ConversionPair);
+
+//////////////////////////////////////////////////
+TEST(ConversionTables, Tables)
+{
+  ASSERT_GT(PAIRS, 0u);
+  for (size_t i = 0; i < PAIRS; ++i) {
+    const ConversionPair& pair = ConversionPairs[i];
+    EXPECT_GT(pair.map_size, 1) << pair.name;
+    EXPECT_GT(pair.buckets_size, 0) << pair.name;
+    EXPECT_LT(pair.coupled, static_cast<int>(PAIRS)) << pair.name;
+  }
+}
+
+//////////////////////////////////////////////////
+TEST(ConversionTables, SingleRoundTrip)
+{
+  for (size_t i = 0; i < PAIRS; ++i) {
+    const ConversionPair& pair = ConversionPairs[i];
+    RoundTrip result = SingleRoundTrip(pair, SINGLE_STEP, TOLERANCE);
+    EXPECT_GT(result.conversions, 0u) << pair.name;
+    EXPECT_LT(result.max_error, TOLERANCE)
+      << pair.name << " at " << result.angle;
+  }
+}
+
+//////////////////////////////////////////////////
+TEST(ConversionTables, Splines)
+{
+  for (size_t i = 0; i < PAIRS; ++i) {
+    const ConversionPair& pair = ConversionPairs[i];
+    ASSERT_GT(pair.spline_size, 1) << pair.name;
+    ASSERT_GT(pair.inverse_spline_size, 1) << pair.name;
+
+    // between knots, where tables and splines differ most
+    for (float angle = PairMinAngle(pair) + 0.005f;
+         angle < PairMaxAngle(pair); angle += SINGLE_STEP) {
+      float stroke_rate, angle_rate;
+      float stroke =
+        SplineEval(pair.spline, pair.spline_size, angle, stroke_rate);
+      float back = SplineEval(pair.inverse_spline, pair.inverse_spline_size,
+                              stroke, angle_rate);
+      ASSERT_NEAR(back, angle, SPLINE_ERROR) << pair.name;
+      ASSERT_NEAR(stroke_rate * angle_rate, 1.0f, JACOBIAN_ERROR)
+        << pair.name << " at " << angle;
+
+      // same direction as table
+      float table_rate =
+        PairStroke(pair, angle + 0.5f) - PairStroke(pair, angle - 0.5f);
+      ASSERT_GT(stroke_rate * table_rate, 0) << pair.name << " at " << angle;
+    }
+  }
+}
+
+//////////////////////////////////////////////////
+TEST(ConversionTables, SplinesMatchTables)
+{
+  for (size_t i = 0; i < PAIRS; ++i) {
+    const ConversionPair& pair = ConversionPairs[i];
+    for (float angle = PairMinAngle(pair);
+         angle <= PairMaxAngle(pair); angle += SINGLE_STEP) {
+      float rate;
+      float stroke = PairStroke(pair, angle);
+      ASSERT_NEAR(SplineEval(pair.spline, pair.spline_size, angle, rate),
+                  stroke, SPLINE_STROKE_ERROR)
+        << pair.name << " at " << angle;
+      ASSERT_NEAR(SplineEval(pair.inverse_spline, pair.inverse_spline_size,
+                             stroke, rate),
+                  PairAngle(pair, stroke), SPLINE_ANGLE_ERROR)
+        << pair.name << " at " << angle;
+    }
+  }
+}
+
+//////////////////////////////////////////////////
+TEST(ConversionTables, SplineEnds)
+{
+  for (size_t i = 0; i < PAIRS; ++i) {
+    const ConversionPair& pair = ConversionPairs[i];
+    const SplineKnot* knots[] = {pair.spline, pair.inverse_spline};
+    int sizes[] = {pair.spline_size, pair.inverse_spline_size};
+    for (int k = 0; k < 2; ++k) {
+      const SplineKnot& first = knots[k][0];
+      const SplineKnot& last = knots[k][sizes[k] - 1];
+      float rate;
+
+      // slopes of end knots, e.g. at home pose
+      EXPECT_EQ(SplineEval(knots[k], sizes[k], first.x, rate), first.y)
+        << pair.name;
+      EXPECT_EQ(rate, first.slope) << pair.name;
+      EXPECT_NE(rate, 0) << pair.name;
+      EXPECT_NEAR(SplineEval(knots[k], sizes[k], last.x, rate), last.y,
+                  SPLINE_END_ERROR) << pair.name;
+      EXPECT_NEAR(rate, last.slope, SPLINE_END_ERROR) << pair.name;
+      EXPECT_NE(rate, 0) << pair.name;
+
+      // clamped out of spline
+      EXPECT_EQ(SplineEval(knots[k], sizes[k], first.x - 1, rate), first.y)
+        << pair.name;
+      EXPECT_EQ(rate, 0) << pair.name;
+      EXPECT_EQ(SplineEval(knots[k], sizes[k], last.x + 1, rate), last.y)
+        << pair.name;
+      EXPECT_EQ(rate, 0) << pair.name;
+    }
+  }
+}
+
+int main(int argc, char **argv)
+{
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
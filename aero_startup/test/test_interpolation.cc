@@ -0,0 +1,133 @@
+/// Interpolation pieces against the bezier curves they are compiled from
+
+#include <functional>
+
+#include <gtest/gtest.h>
+
+#include "aero_hardware_interface/Interpolation.hh"
+
+using namespace aero;
+using namespace interpolation;
+
+// float rounding of expanded polynomials
+static const float TOLERANCE = 2e-5f;
+
+//////////////////////////////////////////////////
+static void ExpectCurve(const Interpolation& _curve,
+                        const std::function<float(float)>& _bezier)
+{
+  for (int i = 1; i <= 100; ++i) {
+    float t = i / 100.0f;
+    EXPECT_NEAR(_curve.interpolate(t), _bezier(t), TOLERANCE) << "t " << t;
+  }
+
+  // batch walks pieces in order, same values as one by one
+  const size_t n = 70;
+  float values[n];
+  _curve.interpolate(0.05f, 0.0123f, n, values);
+  for (size_t i = 0; i < n; ++i)
+    EXPECT_FLOAT_EQ(values[i], _curve.interpolate(0.05f + i * 0.0123f));
+}
+
+//////////////////////////////////////////////////
+static float Quadratic(float _t, float _y0, float _y1, float _y2)
+{
+  float s = 1 - _t;
+  return s*s*_y0 + 2*s*_t*_y1 + _t*_t*_y2;
+}
+
+//////////////////////////////////////////////////
+TEST(Interpolation, Defaults)
+{
+  ExpectCurve(Interpolation(i_constant), [](float) {return 0.0f;});
+  ExpectCurve(Interpolation(i_linear), [](float t) {return t;});
+  ExpectCurve(Interpolation(i_bezier),
+              [](float t) {return Quadratic(t, 0, 1, 1);});
+  // p1 (0.5, 0.8), p2 y 1
+  ExpectCurve(Interpolation(i_slowout), [](float t) {
+      return t <= 0.5f ? t / 0.5f * 0.8f :
+        Quadratic((t - 0.5f) / 0.5f, 0.8f, 1, 1);});
+  // p1 y 0, p2 (0.5, 0.2)
+  ExpectCurve(Interpolation(i_slowin), [](float t) {
+      return t <= 0.5f ? Quadratic(t / 0.5f, 0, 0, 0.2f) :
+        (1 - (t - 0.5f) / 0.5f) * 0.2f + (t - 0.5f) / 0.5f;});
+  // p2 (0.3, 0.2), p3 (0.7, 0.8)
+  ExpectCurve(Interpolation(i_sigmoid), [](float t) {
+      return t <= 0.3f ? Quadratic(t / 0.3f, 0, 0, 0.2f) :
+        t <= 0.7f ? 0.2f + (t - 0.3f) / 0.4f * 0.6f :
+        Quadratic((t - 0.7f) / 0.3f, 0.8f, 1, 1);});
+  ExpectCurve(Interpolation(i_cbezier), [](float t) {
+      float s = 1 - t;
+      return 3*s*s*t*0.5f + 3*t*t*s*0.5f + t*t*t;});
+}
+
+//////////////////////////////////////////////////
+TEST(Interpolation, SetPoints)
+{
+  Interpolation bezier(i_bezier);
+  bezier.set_points({0.3f, 0.1f}, 1);
+  ExpectCurve(bezier, [](float t) {return Quadratic(t, 0, 0.1f, 1);});
+
+  Interpolation slowout(i_slowout);
+  slowout.set_points({0.4f, 0.6f}, 1);
+  ExpectCurve(slowout, [](float t) {
+      return t <= 0.4f ? t / 0.4f * 0.6f :
+        Quadratic((t - 0.4f) / 0.6f, 0.6f, 1, 1);});
+
+  Interpolation slowin(i_slowin);
+  slowin.set_points({0.6f, 0.3f}, 2);
+  ExpectCurve(slowin, [](float t) {
+      return t <= 0.6f ? Quadratic(t / 0.6f, 0, 0, 0.3f) :
+        (1 - (t - 0.6f) / 0.4f) * 0.3f + (t - 0.6f) / 0.4f;});
+
+  Interpolation sigmoid(i_sigmoid);
+  sigmoid.set_points({0.2f, 0.1f}, 2);
+  sigmoid.set_points({0.6f, 0.9f}, 3);
+  ExpectCurve(sigmoid, [](float t) {
+      return t <= 0.2f ? Quadratic(t / 0.2f, 0, 0, 0.1f) :
+        t <= 0.6f ? 0.1f + (t - 0.2f) / 0.4f * 0.8f :
+        Quadratic((t - 0.6f) / 0.4f, 0.9f, 1, 1);});
+
+  Interpolation cbezier(i_cbezier);
+  cbezier.set_points({0.2f, 0.9f}, 1);
+  cbezier.set_points({0.7f, 0.1f}, 2);
+  ExpectCurve(cbezier, [](float t) {
+      float s = 1 - t;
+      return 3*s*s*t*0.9f + 3*t*t*s*0.1f + t*t*t;});
+
+  // points of other curves are ignored
+  Interpolation linear(i_linear);
+  linear.set_points({0.2f, 0.9f}, 1);
+  ExpectCurve(linear, [](float t) {return t;});
+}
+
+//////////////////////////////////////////////////
+TEST(Interpolation, Degenerate)
+{
+  // first piece has no length
+  Interpolation slowout(i_slowout);
+  slowout.set_points({0.0f, 0.5f}, 1);
+  ExpectCurve(slowout, [](float t) {return Quadratic(t, 0.5f, 1, 1);});
+
+  // last piece has no length
+  Interpolation slowin(i_slowin);
+  slowin.set_points({1.0f, 0.5f}, 2);
+  ExpectCurve(slowin, [](float t) {return Quadratic(t, 0, 0, 0.5f);});
+
+  // middle piece has no length
+  Interpolation sigmoid(i_sigmoid);
+  sigmoid.set_points({0.5f, 0.5f}, 2);
+  sigmoid.set_points({0.5f, 0.5f}, 3);
+  ExpectCurve(sigmoid, [](float t) {
+      return t <= 0.5f ? Quadratic(t / 0.5f, 0, 0, 0.5f) :
+        Quadratic((t - 0.5f) / 0.5f, 0.5f, 1, 1);});
+
+  // unknown id is linear
+  ExpectCurve(Interpolation(99), [](float t) {return t;});
+}
+
+int main(int argc, char **argv)
+{
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
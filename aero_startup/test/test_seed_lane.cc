@@ -0,0 +1,43 @@
+/// lanes of commands queued to SEED controller
+
+#include <gtest/gtest.h>
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "aero_hardware_interface/CommandList.hh"
+
+using namespace aero;
+using namespace controller;
+
+//////////////////////////////////////////////////
+TEST(SEEDLane, ResetStatusIsSafety)
+{
+  EXPECT_EQ(SEED_LANE_SAFETY, seed_lane(CMD_WATCH_MISSTEP, SUB_RESET_STATUS));
+  EXPECT_EQ(SEED_LANE_SAFETY, seed_lane(CMD_MOTOR_SRV, 0x00));
+}
+
+//////////////////////////////////////////////////
+TEST(SEEDLane, PollsAreTelemetry)
+{
+  EXPECT_EQ(SEED_LANE_TELEMETRY, seed_lane(CMD_WATCH_MISSTEP, 0x00));
+  EXPECT_EQ(SEED_LANE_TELEMETRY, seed_lane(CMD_GET_CUR, 0x00));
+  EXPECT_EQ(SEED_LANE_TELEMETRY, seed_lane(CMD_GET_TMP_VOLT, 0x00));
+  EXPECT_EQ(SEED_LANE_TELEMETRY, seed_lane(CMD_GET_VERSION, 0x00));
+}
+
+//////////////////////////////////////////////////
+TEST(SEEDLane, MovesArePosition)
+{
+  EXPECT_EQ(SEED_LANE_POSITION, seed_lane(CMD_MOVE_ABS_POS, 0x00));
+  EXPECT_EQ(SEED_LANE_POSITION, seed_lane(CMD_MOVE_ABS_POS_RET, 0x00));
+  EXPECT_EQ(SEED_LANE_POSITION, seed_lane(CMD_GET_POS, 0x00));
+  // sub of a move is an axis, 0xff is not a reset there
+  EXPECT_EQ(SEED_LANE_POSITION, seed_lane(CMD_MOVE_ABS_POS, 0xff));
+}
+
+int main(int argc, char **argv)
+{
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,65 @@
+/// StrokeVelocityEstimator with readings of two boards
+
+#include <gtest/gtest.h>
+
+#include "aero_hardware_interface/StrokeVelocityEstimator.hh"
+
+using namespace aero;
+using namespace controller;
+
+// 50 Hz readings [ns]
+static const int64_t PERIOD = 20000000;
+
+//////////////////////////////////////////////////
+TEST(StrokeVelocityEstimator, Ramp)
+{
+  StrokeVelocityEstimator estimator;
+  estimator.configure(5.0, 0.5);
+  estimator.resize(2);
+  std::vector<int16_t> strokes(2);
+  std::vector<int64_t> stamps(2);
+
+  for (int k = 1; k <= 50; ++k) {
+    strokes[0] = k * 20;
+    stamps[0] = k * PERIOD;
+    // second board read at half rate
+    if (k % 2 == 0) {
+      strokes[1] = -k * 10;
+      stamps[1] = k * PERIOD;
+    }
+    estimator.update(strokes, stamps, k * PERIOD);
+  }
+  EXPECT_NEAR(estimator.velocities()[0], 1000.0, 1.0);
+  EXPECT_NEAR(estimator.velocities()[1], -500.0, 1.0);
+}
+
+//////////////////////////////////////////////////
+TEST(StrokeVelocityEstimator, Timeout)
+{
+  StrokeVelocityEstimator estimator;
+  estimator.configure(0.0, 0.5);
+  estimator.resize(1);
+  std::vector<int16_t> strokes(1, 0);
+  std::vector<int64_t> stamps(1, 0);
+
+  // never read
+  estimator.update(strokes, stamps, PERIOD);
+  EXPECT_EQ(estimator.velocities()[0], 0.0);
+
+  stamps[0] = PERIOD;
+  estimator.update(strokes, stamps, PERIOD);
+  strokes[0] = 100;
+  stamps[0] = 2 * PERIOD;
+  estimator.update(strokes, stamps, 2 * PERIOD);
+  EXPECT_DOUBLE_EQ(estimator.velocities()[0], 5000.0);
+
+  // board stopped replying
+  estimator.update(strokes, stamps, 2 * PERIOD + 600000000);
+  EXPECT_EQ(estimator.velocities()[0], 0.0);
+}
+
+int main(int argc, char **argv)
+{
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,263 @@
+/// TrajectoryExecutor with overlapping trajectories of one board
+
+#include <gtest/gtest.h>
+
+#include "aero_hardware_interface/TrajectoryExecutor.hh"
+
+using namespace aero;
+using namespace controller;
+
+// 10 fps [csec]
+static const uint16_t FRAME = 10;
+
+//////////////////////////////////////////////////
+static StrokeTrajectory Line(const std::vector<int16_t>& _from,
+                             const std::vector<int16_t>& _to,
+                             uint16_t _csec)
+{
+  return {{_from, 0}, {_to, _csec}};
+}
+
+//////////////////////////////////////////////////
+TEST(TrajectoryExecutor, Linear)
+{
+  TrajectoryExecutor executor;
+  executor.resize(2);
+  std::vector<int16_t> strokes;
+
+  EXPECT_NE(executor.add(Line({0, 0x7fff}, {1000, 0x7fff}, 100), {}), 0u);
+  EXPECT_EQ(executor.owner(1), 0u);
+  for (int k = 1; k <= 10; ++k) {
+    ASSERT_TRUE(executor.step(strokes, FRAME));
+    EXPECT_EQ(strokes[0], 100 * k);
+    EXPECT_EQ(strokes[1], 0x7fff);
+  }
+  EXPECT_EQ(executor.size(), 0u);
+  EXPECT_EQ(executor.owner(0), 0u);
+  EXPECT_FALSE(executor.step(strokes, FRAME));
+}
+
+//////////////////////////////////////////////////
+TEST(TrajectoryExecutor, Takeover)
+{
+  TrajectoryExecutor executor;
+  executor.resize(3);
+  executor.set_blend(0);
+  std::vector<int16_t> strokes;
+
+  uint32_t first = executor.add(Line({0, 0, 0x7fff}, {1000, 1000, 0x7fff}, 100), {});
+  executor.step(strokes, FRAME);
+
+  // second takes stroke 1, first keeps moving stroke 0
+  uint32_t second = executor.add(Line({0x7fff, 100, 0}, {0x7fff, 0, 500}, 50), {});
+  EXPECT_EQ(executor.owner(0), first);
+  EXPECT_EQ(executor.owner(1), second);
+  EXPECT_EQ(executor.owner(2), second);
+  executor.step(strokes, FRAME);
+  EXPECT_EQ(strokes[0], 200);
+  EXPECT_EQ(strokes[1], 80);
+  EXPECT_EQ(strokes[2], 100);
+  EXPECT_EQ(executor.size(), 2u);
+
+  // third takes all strokes of first, which is dropped
+  uint32_t third = executor.add(Line({200, 0x7fff, 0x7fff}, {0, 0x7fff, 0x7fff}, 20), {});
+  EXPECT_EQ(executor.owner(0), third);
+  EXPECT_EQ(executor.size(), 2u);
+  executor.step(strokes, FRAME);
+  EXPECT_EQ(strokes[0], 100);
+  EXPECT_EQ(strokes[1], 60);
+}
+
+//////////////////////////////////////////////////
+TEST(TrajectoryExecutor, Blend)
+{
+  TrajectoryExecutor executor;
+  executor.resize(1);
+  std::vector<int16_t> strokes;
+
+  // same velocity before and after handover, start is replaced
+  // by last stroke sent
+  executor.add(Line({0}, {1000}, 100), {});
+  executor.step(strokes, FRAME);
+  executor.step(strokes, FRAME);
+  executor.add(Line({150}, {1000}, 80), {}, 1000000);
+  executor.step(strokes, FRAME);
+  EXPECT_EQ(strokes[0], 300);
+  executor.sent(3000000);
+  EXPECT_EQ(executor.stats().takeovers, 1u);
+  EXPECT_EQ(executor.stats().trajectories, 2u);
+  EXPECT_EQ(executor.stats().last_latency, 2000u);
+
+  // stop at 300, velocity fades out in 30 csec
+  executor.add(Line({300}, {300}, 100), {});
+  executor.step(strokes, FRAME);
+  EXPECT_GT(strokes[0], 300);
+  EXPECT_LT(strokes[0], 400);
+  executor.step(strokes, FRAME);
+  executor.step(strokes, FRAME);
+  EXPECT_EQ(strokes[0], 300);
+}
+
+//////////////////////////////////////////////////
+TEST(TrajectoryExecutor, Timing)
+{
+  TrajectoryExecutor executor;
+  executor.resize(1);
+  std::vector<int16_t> strokes;
+  const int64_t frame_ns = FRAME * 10000000LL;
+
+  executor.add(Line({0}, {1000}, 50), {});
+  int64_t stamp = 1000000000;
+  for (int k = 1; k <= 5; ++k) {
+    executor.step(strokes, FRAME);
+    // third frame completes 30 ms late
+    executor.sent(stamp + (k >= 3 ? 30000000 : 0));
+    stamp += frame_ns;
+    if (k < 5) {
+      EXPECT_TRUE(executor.finished().empty());
+    }
+  }
+  ASSERT_EQ(executor.finished().size(), 1u);
+  EXPECT_EQ(executor.finished()[0].commanded, 50);
+  EXPECT_EQ(executor.finished()[0].planned, 5 * frame_ns);
+  EXPECT_EQ(executor.finished()[0].actual, 5 * frame_ns + 30000000);
+  EXPECT_EQ(executor.stats().last_timing_error, 30000);
+  executor.step(strokes, FRAME);
+  executor.sent(stamp);
+  EXPECT_TRUE(executor.finished().empty());
+}
+
+//////////////////////////////////////////////////
+TEST(TrajectoryExecutor, HeldTiming)
+{
+  TrajectoryExecutor executor;
+  executor.resize(1);
+  std::vector<int16_t> strokes;
+  const int64_t frame_ns = FRAME * 10000000LL;
+
+  executor.add(Line({0}, {1000}, 30), {});
+  int64_t stamp = 1000000000;
+  for (int k = 1; k <= 8; ++k) {
+    // held for 5 frames after first frame
+    executor.set_factor((k >= 2 && k <= 6) ? 0.0f : 1.0f);
+    executor.step(strokes, FRAME);
+    executor.sent(stamp);
+    stamp += frame_ns;
+  }
+  ASSERT_EQ(executor.finished().size(), 1u);
+  EXPECT_EQ(executor.finished()[0].planned, 3 * frame_ns);
+  EXPECT_EQ(executor.finished()[0].actual, 3 * frame_ns);
+  EXPECT_EQ(executor.stats().last_timing_error, 0);
+}
+
+//////////////////////////////////////////////////
+TEST(TrajectoryExecutor, Cancel)
+{
+  TrajectoryExecutor executor;
+  executor.resize(2);
+  std::vector<int16_t> strokes;
+
+  executor.add(Line({0, 0}, {1000, 1000}, 100), {});
+  executor.step(strokes, FRAME);
+
+  // 0x7fff after start cancels stroke 1, which is held
+  uint32_t cancel = executor.add(Line({0x7fff, 100}, {0x7fff, 0x7fff}, 100), {});
+  EXPECT_EQ(executor.owner(1), cancel);
+  executor.step(strokes, FRAME);
+  EXPECT_EQ(strokes[0], 200);
+  EXPECT_EQ(strokes[1], 0x7fff);
+}
+
+//////////////////////////////////////////////////
+TEST(TrajectoryExecutor, Factor)
+{
+  TrajectoryExecutor executor;
+  executor.resize(1);
+  std::vector<int16_t> strokes;
+
+  executor.add(Line({0}, {1000}, 100), {});
+  executor.step(strokes, FRAME);
+  executor.set_factor(0.0f);
+  EXPECT_FALSE(executor.step(strokes, FRAME));
+  EXPECT_EQ(executor.size(), 1u);
+  executor.set_factor(0.5f);
+  executor.step(strokes, FRAME);
+  EXPECT_EQ(strokes[0], 150);
+}
+
+//////////////////////////////////////////////////
+TEST(TrajectoryExecutor, Interpolation)
+{
+  TrajectoryExecutor executor;
+  executor.resize(1);
+  std::vector<int16_t> strokes;
+
+  std::vector<aero::interpolation::Interpolation> interpolation;
+  interpolation.push_back(
+      aero::interpolation::Interpolation(aero::interpolation::i_constant));
+  interpolation.push_back(
+      aero::interpolation::Interpolation(aero::interpolation::i_bezier));
+  executor.add(Line({0}, {1000}, 100), interpolation);
+  executor.step(strokes, FRAME);
+  EXPECT_EQ(strokes[0], static_cast<int16_t>(
+      1000 * interpolation[1].interpolate(0.1f) + 0.5f));
+  for (int k = 2; k <= 10; ++k)
+    executor.step(strokes, FRAME);
+  EXPECT_EQ(strokes[0], 1000);
+}
+
+//////////////////////////////////////////////////
+TEST(TrajectoryExecutor, Period)
+{
+  TrajectoryExecutor executor;
+  executor.resize(2);
+  std::vector<int16_t> strokes;
+
+  // 20 fps
+  executor.add(Line({0, 0x7fff}, {1000, 0x7fff}, 100), {}, 0, 5);
+  EXPECT_FLOAT_EQ(executor.period(), 5);
+  // 10 fps trajectory read between its frames
+  executor.add(Line({0x7fff, 0}, {0x7fff, 500}, 50), {}, 0, 10);
+  EXPECT_FLOAT_EQ(executor.period(), 5);
+  for (int k = 1; k <= 10; ++k) {
+    executor.step(strokes, executor.period());
+    EXPECT_EQ(strokes[0], 50 * k);
+    EXPECT_EQ(strokes[1], 50 * k);
+  }
+  EXPECT_EQ(executor.size(), 1u);
+  EXPECT_FLOAT_EQ(executor.period(), 5);
+}
+
+//////////////////////////////////////////////////
+TEST(TrajectoryExecutor, Precompute)
+{
+  std::vector<aero::interpolation::Interpolation> interpolation;
+  interpolation.push_back(
+      aero::interpolation::Interpolation(aero::interpolation::i_constant));
+  interpolation.push_back(
+      aero::interpolation::Interpolation(aero::interpolation::i_bezier));
+
+  // 30 fps, last frame at end
+  TrajectoryFrames frames;
+  ASSERT_TRUE(TrajectoryExecutor::precompute(
+      frames, Line({0}, {1000}, 100), interpolation, 10.0f / 3));
+  ASSERT_EQ(frames.size(), 31u);
+  for (size_t k = 0; k < frames.size(); ++k)
+    EXPECT_EQ(frames.strokes[k], static_cast<int16_t>(
+        1000 * interpolation[1].interpolate(k / 30.0f) + 0.5f));
+
+  // 0x7fff as first point owns no stroke
+  EXPECT_FALSE(TrajectoryExecutor::precompute(
+      frames, {{{0}, 0}}, interpolation, 10));
+  EXPECT_TRUE(TrajectoryExecutor::precompute(
+      frames, Line({0x7fff}, {0}, 10), {}, 10));
+  TrajectoryExecutor executor;
+  executor.resize(1);
+  EXPECT_EQ(executor.add(frames), 0u);
+}
+
+int main(int argc, char **argv)
+{
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}